@@ -0,0 +1,122 @@
+// compares a socketpair ping-pong driven by async::reactor callbacks with the same ping-pong
+// written as coroutines over async::async_fd
+//
+// usage: coroutine_bench [round trips] [message size]
+
+#include <chrono>
+#include <om/om.h>
+
+using namespace om;
+
+static void report(const char* name_, unsigned long rounds_, std::chrono::steady_clock::duration d_)
+{
+	double s = std::chrono::duration<double>(d_).count();
+	std::cout << std::left << std::setw(12) << name_ << std::right << std::fixed << std::setprecision(0)
+		<< std::setw(12) << rounds_ / s << " round trips/s" << std::setprecision(1)
+		<< std::setw(10) << s * 1e9 / rounds_ << " ns/round trip" << std::endl;
+}
+
+//! both ends read a message and write it back, the client counts the round trips
+static void callbacks(int a_, int b_, unsigned long rounds_, std::size_t size_)
+{
+	async::reactor reactor;
+	std::vector<char> buf(size_);
+	unsigned long done = 0;
+
+	auto pong = [&](int fd_, uint32_t) {
+		ssize_t n = ::read(fd_, buf.data(), buf.size());
+
+		if (n > 0 && ::write(fd_, buf.data(), n) != n)
+			throw std::runtime_error("short write");
+	};
+
+	auto ping = [&](int fd_, uint32_t) {
+		ssize_t n = ::read(fd_, buf.data(), buf.size());
+
+		if (n <= 0)
+			return;
+
+		if (++done == rounds_)
+			reactor.stop();
+		else if (::write(fd_, buf.data(), n) != n)
+			throw std::runtime_error("short write");
+	};
+
+	reactor.add(b_, async::reactor::in, pong);
+	reactor.add(a_, async::reactor::in, ping);
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (::write(a_, buf.data(), size_) != (ssize_t) size_)
+		throw std::runtime_error("short write");
+
+	reactor.run();
+	report("callbacks", rounds_, std::chrono::steady_clock::now() - start);
+	reactor.remove(a_);
+	reactor.remove(b_);
+}
+
+static async::task<void> pong(async::async_fd& fd_, std::size_t size_, bool& done_)
+{
+	std::vector<char> buf(size_);
+
+	for (;;) {
+		auto r = co_await fd_.read(buf.data(), buf.size());
+
+		if (!r.ok() || r.eof()) {
+			done_ = true;
+			co_return;
+		}
+
+		co_await fd_.write(buf.data(), r.value());
+	}
+}
+
+static async::task<void> ping(async::async_fd& fd_, unsigned long rounds_, std::size_t size_)
+{
+	std::vector<char> buf(size_);
+
+	for (unsigned long i = 0; i < rounds_; i++) {
+		co_await fd_.write(buf.data(), buf.size());
+		co_await fd_.read(buf.data(), buf.size());
+	}
+}
+
+static void coroutines(int a_, int b_, unsigned long rounds_, std::size_t size_)
+{
+	async::reactor reactor;
+	async::async_fd a(reactor, a_);
+	async::async_fd b(reactor, b_);
+	bool done = false;
+
+	async::spawn(pong(b, size_, done));
+
+	auto start = std::chrono::steady_clock::now();
+	async::block_on(reactor, ping(a, rounds_, size_));
+	report("coroutines", rounds_, std::chrono::steady_clock::now() - start);
+
+	// let the pong coroutine see the end of the stream and finish
+	::shutdown(a_, SHUT_WR);
+
+	while (!done)
+		reactor.run_once(-1);
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long rounds = argc_ > 1 ? std::stoul(argv_[1]) : 200000;
+	std::size_t size     = argc_ > 2 ? std::stoul(argv_[2]) : 64;
+
+	for (auto run : { callbacks, coroutines }) {
+		int fds[2];
+
+		if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds))
+			throw std::runtime_error("could not create socketpair: errno: " + std::to_string(errno));
+
+		run(fds[0], fds[1], rounds, size);
+		::close(fds[0]);
+		::close(fds[1]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+// compares registration and dispatch cost of async::poll and async::reactor with many
+// registered fds of which only a few are active at a time
+//
+// usage: reactor_bench [fds] [active fds per round] [rounds]
+
+#include <random>
+#include <sys/resource.h>
+#include <om/om.h>
+
+using namespace om;
+
+struct workload
+{
+	std::vector<int> fds;
+	std::mt19937 rng { 42 };
+	unsigned active;
+	unsigned long rounds;
+	unsigned long events = 0;
+
+	workload(unsigned count_, unsigned active_, unsigned long rounds_)
+		: active(active_), rounds(rounds_)
+	{
+		for (unsigned i = 0; i < count_; i++) {
+			int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+			if (fd == -1)
+				throw std::runtime_error("could not create eventfd: errno: " + std::to_string(errno));
+
+			fds.push_back(fd);
+		}
+	}
+
+	//! signals active randomly chosen fds
+	void signal()
+	{
+		uint64_t one = 1;
+
+		for (unsigned i = 0; i < active; i++)
+			if (::write(fds[rng() % fds.size()], &one, sizeof(one)) != sizeof(one))
+				throw std::runtime_error("could not signal");
+	}
+
+	//! consumes an event, signals the next round once all events of a round are handled,
+	//! returns false after the last round
+	bool handle(int fd_)
+	{
+		uint64_t val;
+
+		if (::read(fd_, &val, sizeof(val)) != sizeof(val))
+			return true; // signalled twice in one round
+
+		events += val;
+
+		if (events % active == 0) {
+			if (events / active >= rounds)
+				return false;
+
+			signal();
+		}
+
+		return true;
+	}
+
+	~workload()
+	{
+		for (int fd : fds)
+			::close(fd);
+	}
+};
+
+static void print(const std::string& name_, double add_s_, double remove_s_, double run_s_,
+	const workload& w_)
+{
+	std::cout << std::left << std::setw(8) << name_ << std::right << std::fixed
+			  << std::setprecision(1)
+			  << " add: " << std::setw(8) << add_s_ * 1e9 / w_.fds.size() << " ns/fd"
+			  << "  remove: " << std::setw(8) << remove_s_ * 1e9 / w_.fds.size() << " ns/fd"
+			  << "  dispatch: " << std::setw(10) << std::setprecision(0) << w_.events / run_s_
+			  << " events/s" << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned count        = argc_ > 1 ? (unsigned) std::stoul(argv_[1]) : 10000;
+	unsigned active       = argc_ > 2 ? (unsigned) std::stoul(argv_[2]) : 16;
+	unsigned long rounds  = argc_ > 3 ? std::stoul(argv_[3]) : 2000;
+
+	struct rlimit rl {};
+	::getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max;
+	::setrlimit(RLIMIT_NOFILE, &rl);
+
+	{
+		workload w(count, active, rounds);
+		async::poll poll;
+
+		double add_s = etc::runtime([&]() {
+			for (int fd : w.fds)
+				poll.add_fd(fd, [&](int fd_, async::poll::event) {
+					if (!w.handle(fd_)) poll.stop();
+				});
+		});
+
+		w.signal();
+		double run_s = etc::runtime([&]() { poll.block(); });
+		double remove_s = etc::runtime([&]() {
+			for (int fd : w.fds)
+				poll.remove_fd(fd);
+		});
+
+		print("poll", add_s, remove_s, run_s, w);
+	}
+
+	{
+		workload w(count, active, rounds * 50);
+		async::reactor reactor;
+
+		double add_s = etc::runtime([&]() {
+			for (int fd : w.fds)
+				reactor.add(fd, async::reactor::in, [&](int fd_, uint32_t) {
+					if (!w.handle(fd_)) reactor.stop();
+				});
+		});
+
+		w.signal();
+		double run_s = etc::runtime([&]() { reactor.run(); });
+		double remove_s = etc::runtime([&]() {
+			for (int fd : w.fds)
+				reactor.remove(fd);
+		});
+
+		print("reactor", add_s, remove_s, run_s, w);
+	}
+
+	return 0;
+}
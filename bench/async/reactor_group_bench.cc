@@ -0,0 +1,124 @@
+// measures loopback tcp echo throughput of a reactor_group for increasing numbers of loops
+//
+// usage: reactor_group_bench [connections] [seconds per run] [client threads] [message size]
+
+#include <om/om.h>
+
+using namespace om;
+
+static void serve(async::reactor_group& group_, net::tcp_listener& listener_)
+{
+	group_.post(0, [&group_, &listener_]() {
+		group_.at(0).add(listener_.fd(), async::reactor::in, [&group_, &listener_](int, uint32_t) {
+			std::vector<net::tcp_stream> streams;
+			listener_.accept_batch(streams);
+
+			for (auto& s : streams) {
+				auto stream = std::make_shared<net::tcp_stream>(std::move(s));
+				stream->set_nodelay();
+				unsigned index = group_.select(stream->fd());
+
+				group_.post(index, [&group_, index, stream]() {
+					async::reactor& loop = group_.at(index);
+
+					loop.add(stream->fd(), async::reactor::in, [&loop, stream](int fd_, uint32_t) {
+						unsigned char buf[16384];
+
+						for (;;) {
+							auto r = stream->read(buf, sizeof(buf));
+
+							if (r.would_block())
+								return;
+
+							if (!r || r.eof()) {
+								loop.remove(fd_);
+								stream->close();
+								return;
+							}
+
+							// echo messages are small, the send buffer never fills up here
+							stream->write(buf, r.value());
+						}
+					});
+				});
+			}
+		});
+	});
+}
+
+static void run(unsigned size_, unsigned connections_, double seconds_, unsigned clients_,
+	unsigned message_size_)
+{
+	async::reactor_group::config cfg;
+	cfg.size = size_;
+
+	async::reactor_group group(cfg);
+	net::tcp_listener listener(net::endpoint::from_string("127.0.0.1", 0));
+	auto server = net::endpoint::from_string("127.0.0.1", listener.port());
+
+	serve(group, listener);
+	group.start();
+
+	std::atomic<unsigned long> round_trips { 0 };
+	std::atomic<bool> done { false };
+	std::vector<std::thread> threads;
+
+	for (unsigned c = 0; c < clients_; c++) {
+		threads.emplace_back([&, c]() {
+			std::vector<std::unique_ptr<net::socket>> socks;
+
+			for (unsigned i = c; i < connections_; i += clients_) {
+				socks.emplace_back(new net::socket(net::socket::type::stream));
+				socks.back()->connect(server);
+				int one = 1;
+				::setsockopt(socks.back()->fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			}
+
+			std::vector<unsigned char> msg(message_size_, 0x42), reply(message_size_);
+			unsigned long local = 0;
+
+			while (!done) {
+				// one message in flight on every connection
+				for (auto& s : socks)
+					s->send(msg.data(), message_size_);
+
+				for (auto& s : socks)
+					for (unsigned got = 0; got < message_size_; )
+						got += s->receive(reply.data() + got, message_size_ - got);
+
+				local += socks.size();
+			}
+
+			round_trips += local;
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds_));
+	done = true;
+
+	for (auto& t : threads)
+		t.join();
+
+	group.stop();
+
+	std::cout << "loops: " << std::setw(3) << size_ << std::fixed << std::setprecision(0)
+			  << "  echo: " << std::setw(10) << round_trips / seconds_ << " msg/s" << std::endl;
+
+	for (unsigned i = 0; i < group.size(); i++)
+		if (group.at(i).contains(listener.fd()))
+			group.at(i).remove(listener.fd());
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned connections = argc_ > 1 ? (unsigned) std::stoul(argv_[1]) : 64;
+	double seconds       = argc_ > 2 ? std::stod(argv_[2]) : 2;
+	unsigned clients     = argc_ > 3 ? (unsigned) std::stoul(argv_[3]) : 4;
+	unsigned size        = argc_ > 4 ? (unsigned) std::stoul(argv_[4]) : 64;
+	unsigned cpus        = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned loops = 1; loops <= std::max(2u, cpus); loops *= 2)
+		run(loops, connections, seconds, clients, size);
+
+	return 0;
+}
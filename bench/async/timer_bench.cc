@@ -0,0 +1,98 @@
+// measures schedule, reschedule, cancel and expiry throughput of async::timer_wheel with many
+// active timers, compared to an ordered std::multimap of deadlines
+//
+// usage: timer_bench [timers] [max delay in ms]
+
+#include <random>
+#include <om/om.h>
+
+using namespace om;
+
+static void print(const std::string& name_, double seconds_, unsigned long ops_)
+{
+	std::cout << std::left << std::setw(24) << name_ << std::right << std::fixed
+			  << std::setprecision(1) << std::setw(8) << seconds_ * 1e9 / ops_ << " ns/op"
+			  << std::setprecision(0) << std::setw(12) << ops_ / seconds_ << " ops/s" << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long count = argc_ > 1 ? std::stoul(argv_[1]) : 1000000;
+	uint64_t max_delay  = argc_ > 2 ? std::stoul(argv_[2]) : 60000;
+
+	std::mt19937_64 rng(42);
+	std::vector<uint64_t> delays(count), delays2(count);
+
+	for (unsigned long i = 0; i < count; i++) {
+		delays[i]  = 1 + rng() % max_delay;
+		delays2[i] = 1 + rng() % max_delay;
+	}
+
+	{
+		async::timer_wheel wheel(1, 1 << 16);
+		std::vector<async::timer> timers(count);
+		unsigned long fired = 0;
+		uint64_t start = wheel.current();
+
+		for (auto& t : timers)
+			t.set_callback([&fired](async::timer&) { fired++; });
+
+		print("wheel schedule", etc::runtime([&]() {
+			for (unsigned long i = 0; i < count; i++)
+				wheel.schedule(timers[i], delays[i]);
+		}), count);
+
+		print("wheel reschedule", etc::runtime([&]() {
+			for (unsigned long i = 0; i < count; i++)
+				wheel.schedule(timers[i], delays2[i]);
+		}), count);
+
+		print("wheel cancel half", etc::runtime([&]() {
+			for (unsigned long i = 0; i < count; i += 2)
+				wheel.cancel(timers[i]);
+		}), count / 2);
+
+		double expire_s = etc::runtime([&]() {
+			for (uint64_t tick = start + 1; tick <= start + max_delay; tick++)
+				wheel.advance_to(tick);
+		});
+
+		print("wheel expire", expire_s, fired);
+	}
+
+	{
+		std::multimap<uint64_t, unsigned long> deadlines;
+		std::vector<std::multimap<uint64_t, unsigned long>::iterator> handles(count);
+		unsigned long fired = 0;
+
+		print("multimap schedule", etc::runtime([&]() {
+			for (unsigned long i = 0; i < count; i++)
+				handles[i] = deadlines.emplace(delays[i], i);
+		}), count);
+
+		print("multimap reschedule", etc::runtime([&]() {
+			for (unsigned long i = 0; i < count; i++) {
+				deadlines.erase(handles[i]);
+				handles[i] = deadlines.emplace(delays2[i], i);
+			}
+		}), count);
+
+		print("multimap cancel half", etc::runtime([&]() {
+			for (unsigned long i = 0; i < count; i += 2)
+				deadlines.erase(handles[i]);
+		}), count / 2);
+
+		double expire_s = etc::runtime([&]() {
+			for (uint64_t tick = 1; tick <= max_delay; tick++) {
+				while (!deadlines.empty() && deadlines.begin()->first <= tick) {
+					deadlines.erase(deadlines.begin());
+					fired++;
+				}
+			}
+		});
+
+		print("multimap expire", expire_s, fired);
+	}
+
+	return 0;
+}
@@ -0,0 +1,200 @@
+
+// compares receiving on many udp sockets with poll, epoll and io_uring, and reading a file with
+// pread and io_uring
+//
+// usage: uring_bench [sockets] [rounds] [file size in MiB]
+
+#include <memory>
+#include <sys/epoll.h>
+#include <om/om.h>
+
+using namespace om;
+
+static const unsigned short BASE_PORT = 47200;
+
+struct sockets
+{
+	std::vector<std::unique_ptr<net::socket>> rx;
+	net::socket tx { net::socket::type::dgram };
+	net::datagram_batch batch;
+
+	explicit sockets(unsigned count_) : batch(count_, 64)
+	{
+		unsigned char payload[64] = { 0 };
+		auto dst = net::ip4_addr::from_string("127.0.0.1");
+
+		for (unsigned i = 0; i < count_; i++) {
+			rx.emplace_back(new net::socket(net::socket::type::dgram));
+			rx.back()->bind("0.0.0.0", (unsigned short) (BASE_PORT + i));
+			rx.back()->set_nonblocking();
+			batch.push(payload, sizeof(payload), dst, (uint16_t) (BASE_PORT + i));
+		}
+	}
+
+	//! sends one datagram to every socket
+	void send_round()
+	{
+		tx.send_batch(batch);
+	}
+};
+
+static void print(const std::string& name_, unsigned long ops_, double seconds_)
+{
+	std::cout << std::left << std::setw(16) << name_ << std::right << std::fixed
+			  << std::setprecision(0) << std::setw(12) << ops_ / seconds_ << " ops/s" << std::endl;
+}
+
+static void bench_poll(unsigned count_, unsigned rounds_)
+{
+	sockets s(count_);
+	std::vector<struct pollfd> fds;
+
+	for (auto& r : s.rx)
+		fds.push_back({ r->fd(), POLLIN, 0 });
+
+	unsigned char buf[64];
+
+	double t = etc::runtime([&]() {
+		for (unsigned round = 0; round < rounds_; round++) {
+			s.send_round();
+
+			for (unsigned received = 0; received < count_; ) {
+				::poll(fds.data(), fds.size(), -1);
+
+				for (auto& pfd : fds)
+					if (pfd.revents & POLLIN)
+						while (::recv(pfd.fd, buf, sizeof(buf), 0) > 0)
+							received++;
+			}
+		}
+	});
+
+	print("poll", (unsigned long) count_ * rounds_, t);
+}
+
+static void bench_epoll(unsigned count_, unsigned rounds_)
+{
+	sockets s(count_);
+	int ep = ::epoll_create1(0);
+
+	for (auto& r : s.rx) {
+		struct epoll_event ev {};
+		ev.events  = EPOLLIN;
+		ev.data.fd = r->fd();
+		::epoll_ctl(ep, EPOLL_CTL_ADD, r->fd(), &ev);
+	}
+
+	std::vector<struct epoll_event> events(count_);
+	unsigned char buf[64];
+
+	double t = etc::runtime([&]() {
+		for (unsigned round = 0; round < rounds_; round++) {
+			s.send_round();
+
+			for (unsigned received = 0; received < count_; ) {
+				int n = ::epoll_wait(ep, events.data(), (int) events.size(), -1);
+
+				for (int i = 0; i < n; i++)
+					while (::recv(events[i].data.fd, buf, sizeof(buf), 0) > 0)
+						received++;
+			}
+		}
+	});
+
+	::close(ep);
+	print("epoll", (unsigned long) count_ * rounds_, t);
+}
+
+static void bench_uring(unsigned count_, unsigned rounds_)
+{
+	sockets s(count_);
+	async::uring ring(count_ * 2);
+	std::vector<unsigned char> bufs((std::size_t) count_ * 64);
+
+	auto arm = [&](unsigned i_) {
+		if (!ring.prep_recv(s.rx[i_]->fd(), &bufs[(std::size_t) i_ * 64], 64, i_)) {
+			ring.submit();
+			ring.prep_recv(s.rx[i_]->fd(), &bufs[(std::size_t) i_ * 64], 64, i_);
+		}
+	};
+
+	for (unsigned i = 0; i < count_; i++)
+		arm(i);
+
+	ring.submit();
+
+	double t = etc::runtime([&]() {
+		for (unsigned round = 0; round < rounds_; round++) {
+			s.send_round();
+
+			for (unsigned received = 0; received < count_; )
+				ring.wait([&](const async::uring::completion& c_) {
+					if (c_.res > 0)
+						received++;
+
+					arm((unsigned) c_.user_data);
+				});
+		}
+	});
+
+	print("uring", (unsigned long) count_ * rounds_, t);
+}
+
+static void bench_file(const std::string& file_name_, std::size_t size_)
+{
+	const unsigned block = 4096, depth = 32;
+
+	{
+		std::vector<char> data(size_, 'x');
+		std::ofstream f(file_name_, std::ios::binary | std::ios::trunc);
+		f.write(data.data(), data.size());
+	}
+
+	int fd = ::open(file_name_.c_str(), O_RDONLY);
+	std::vector<unsigned char> buf((std::size_t) block * depth);
+	unsigned long blocks = size_ / block;
+
+	double t = etc::runtime([&]() {
+		for (unsigned long i = 0; i < blocks; i++)
+			::pread(fd, buf.data(), block, (off_t) (i * block));
+	});
+
+	print("pread", blocks, t);
+
+	async::uring ring(depth);
+	struct iovec iov { buf.data(), buf.size() };
+	ring.register_buffers(&iov, 1);
+	ring.register_files(&fd, 1);
+
+	t = etc::runtime([&]() {
+		for (unsigned long i = 0; i < blocks; ) {
+			unsigned n = 0;
+
+			for (; n < depth && i < blocks; n++, i++) {
+				ring.prep_read_fixed(0, &buf[(std::size_t) n * block], block, i * block, 0, i);
+				ring.set_flags(IOSQE_FIXED_FILE);
+			}
+
+			for (unsigned done = 0; done < n; )
+				done += ring.wait([](const async::uring::completion&) { }, n - done);
+		}
+	});
+
+	print("uring read", blocks, t);
+
+	::close(fd);
+	std::remove(file_name_.c_str());
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned count  = argc_ > 1 ? (unsigned) std::stoul(argv_[1]) : 256;
+	unsigned rounds = argc_ > 2 ? (unsigned) std::stoul(argv_[2]) : 1000;
+	std::size_t mib = argc_ > 3 ? std::stoul(argv_[3]) : 64;
+
+	bench_poll(count, rounds);
+	bench_epoll(count, rounds);
+	bench_uring(count, rounds);
+	bench_file("/dev/shm/libom2_uring_bench.bin", mib << 20);
+	return 0;
+}
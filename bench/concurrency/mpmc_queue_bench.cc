@@ -0,0 +1,114 @@
+// measures concurrency::queue and concurrency::mpmc_queue under contention with equal numbers
+// of producer and consumer threads, and thread_pool throughput with either as task queue
+//
+// usage: mpmc_queue_bench [items per producer] [max threads] [capacity]
+
+#include <chrono>
+#include <om/om.h>
+
+using namespace om;
+
+static void report(const std::string& name_, unsigned threads_, unsigned long items_,
+	std::chrono::steady_clock::duration d_)
+{
+	double s = std::chrono::duration<double>(d_).count();
+	std::cout << std::left << std::setw(20) << name_ << std::right << std::setw(4) << threads_
+		<< " threads" << std::fixed << std::setprecision(2) << std::setw(10) << items_ / s / 1e6
+		<< " M items/s" << std::endl;
+}
+
+//! runs producers_ producer and as many consumer threads, returns the elapsed time
+template<typename Queue, typename Dequeue>
+static std::chrono::steady_clock::duration run(Queue& queue_, unsigned producers_,
+	unsigned long per_producer_, Dequeue dequeue_)
+{
+	std::atomic<unsigned long> consumed { 0 };
+	unsigned long total = producers_ * per_producer_;
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned t = 0; t < producers_; t++) {
+		threads.emplace_back([&queue_, per_producer_]() {
+			for (unsigned long i = 0; i < per_producer_; i++)
+				queue_.enqueue(i);
+		});
+
+		threads.emplace_back([&queue_, &consumed, total, dequeue_]() {
+			unsigned long item;
+
+			while (consumed.load(std::memory_order_relaxed) < total)
+				if (dequeue_(queue_, item))
+					consumed.fetch_add(1, std::memory_order_relaxed);
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	return std::chrono::steady_clock::now() - start;
+}
+
+//! submits tasks tasks from submitters_ threads and waits until all have run
+template<typename Pool>
+static std::chrono::steady_clock::duration run_pool(unsigned workers_, unsigned submitters_,
+	unsigned long tasks_)
+{
+	std::atomic<unsigned long> done { 0 };
+	auto start = std::chrono::steady_clock::now();
+	{
+		Pool pool(workers_);
+		std::vector<std::thread> threads;
+
+		for (unsigned t = 0; t < submitters_; t++)
+			threads.emplace_back([&pool, &done, tasks_, submitters_]() {
+				for (unsigned long i = 0; i < tasks_ / submitters_; i++)
+					pool.submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+			});
+
+		for (auto& t : threads)
+			t.join();
+
+		while (done < tasks_ / submitters_ * submitters_)
+			std::this_thread::yield();
+	}
+
+	return std::chrono::steady_clock::now() - start;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long per_producer = argc_ > 1 ? std::stoul(argv_[1]) : 200000;
+	unsigned max_threads       = argc_ > 2 ? std::stoul(argv_[2]) : 64;
+	std::size_t capacity       = argc_ > 3 ? std::stoul(argv_[3]) : 4096;
+
+	for (unsigned threads = 2; threads <= max_threads; threads *= 2) {
+		unsigned producers = threads / 2;
+		unsigned long total = producers * per_producer;
+
+		concurrency::queue<unsigned long> locked;
+		report("queue", threads, total, run(locked, producers, per_producer,
+			[](concurrency::queue<unsigned long>& q_, unsigned long& item_) {
+				return q_.dequeue(item_);
+			}));
+
+		concurrency::mpmc_queue<unsigned long> lock_free(capacity);
+		report("mpmc_queue", threads, total, run(lock_free, producers, per_producer,
+			[](concurrency::mpmc_queue<unsigned long>& q_, unsigned long& item_) {
+				// sleeps when empty instead of spinning, which matters once threads exceed cores
+				return q_.dequeue_wait(item_, 1);
+			}));
+	}
+
+	unsigned workers = std::max(2u, std::thread::hardware_concurrency());
+	unsigned long tasks = per_producer * 4;
+
+	for (unsigned submitters = 1; submitters <= max_threads; submitters *= 4) {
+		report("thread_pool queue", submitters, tasks,
+			run_pool<concurrency::thread_pool>(workers, submitters, tasks));
+		report("thread_pool mpmc", submitters, tasks,
+			run_pool<concurrency::basic_thread_pool<concurrency::mpmc_queue<concurrency::task>>>(
+				workers, submitters, tasks));
+	}
+
+	return 0;
+}
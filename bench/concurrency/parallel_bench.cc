@@ -0,0 +1,85 @@
+// compares the parallel algorithms on top of thread_pool with their serial std counterparts
+//
+// usage: parallel_bench [threads] [elements]
+
+#include <chrono>
+#include <numeric>
+#include <om/om.h>
+
+using namespace om;
+
+using clock_type = std::chrono::steady_clock;
+
+template<typename Fx>
+static double measure(Fx f_)
+{
+	auto start = clock_type::now();
+	f_();
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static void report(const char* name_, double serial_, double parallel_)
+{
+	std::cout << std::left << std::setw(20) << name_ << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(10) << serial_ * 1e3 << " ms serial" << std::setw(10) << parallel_ * 1e3
+		<< " ms parallel" << std::setprecision(2) << std::setw(8) << serial_ / parallel_ << "x" << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned threads = argc_ > 1 ? std::stoul(argv_[1]) : std::thread::hardware_concurrency();
+	std::size_t n    = argc_ > 2 ? std::stoul(argv_[2]) : 20000000;
+
+	concurrency::thread_pool pool(threads);
+	std::cout << pool.size() << " threads, " << n << " elements" << std::endl;
+
+	std::vector<uint64_t> in(n), out(n);
+	uint64_t x = 0x9e3779b97f4a7c15ULL;
+
+	for (auto& v : in) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		v = x;
+	}
+
+	auto mix = [](uint64_t v_) {
+		for (int i = 0; i < 8; i++)
+			v_ = (v_ ^ (v_ >> 31)) * 0xbf58476d1ce4e5b9ULL;
+
+		return v_;
+	};
+
+	report("transform",
+		measure([&]() { std::transform(in.begin(), in.end(), out.begin(), mix); }),
+		measure([&]() { concurrency::parallel_transform(pool, in.begin(), in.end(), out.begin(), mix); }));
+
+	uint64_t serial_sum = 0, parallel_sum = 0;
+	auto add = [](uint64_t a_, uint64_t b_) { return a_ + b_; };
+
+	report("reduce",
+		measure([&]() { serial_sum = std::accumulate(out.begin(), out.end(), uint64_t(0), add); }),
+		measure([&]() { parallel_sum = concurrency::parallel_reduce(pool, out.begin(), out.end(), uint64_t(0), add); }));
+
+	// flow aggregation style: a map step per index feeding the reduction
+	uint64_t serial_hits = 0, parallel_hits = 0;
+	auto hit = [&in, &mix](std::size_t i_) { return (uint64_t) (mix(in[i_]) % 7 == 0); };
+
+	report("map/reduce",
+		measure([&]() {
+			for (std::size_t i = 0; i < n; i++)
+				serial_hits += hit(i);
+		}),
+		measure([&]() { parallel_hits = concurrency::parallel_reduce(pool, std::size_t(0), n, uint64_t(0), hit, add); }));
+
+	std::vector<uint64_t> sorted = in;
+
+	report("sort",
+		measure([&]() { std::sort(sorted.begin(), sorted.end()); }),
+		measure([&]() { concurrency::parallel_sort(pool, in.begin(), in.end()); }));
+
+	if (serial_sum != parallel_sum || serial_hits != parallel_hits || sorted != in)
+		throw std::runtime_error("parallel_bench: results differ");
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+// compares message passing between two processes through a shared-memory ring and through a
+// loopback udp socket: throughput when flooding and one-way latency percentiles when paced
+//
+// usage: shm_ring_bench [messages] [message size] [pacing interval in us]
+
+#include <om/om.h>
+#include <sys/wait.h>
+
+using namespace om;
+
+static uint64_t now_ns()
+{
+	struct timespec ts {};
+	::clock_gettime(CLOCK_MONOTONIC, &ts); // the same clock in every process
+	return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+static void pace(uint64_t& next_, unsigned interval_us_)
+{
+	if (interval_us_ == 0)
+		return;
+
+	next_ += interval_us_ * 1000ULL;
+
+	while (now_ns() < next_)
+		;
+}
+
+//! prints throughput and latency percentiles measured by the receiving process
+static void report(const std::string& name_, unsigned long count_, std::vector<uint64_t>& latencies_,
+	double seconds_)
+{
+	std::sort(latencies_.begin(), latencies_.end());
+
+	auto pct = [&latencies_](double p_) {
+		return latencies_.empty() ? 0.0
+			: latencies_[(std::size_t) (p_ * (latencies_.size() - 1))] / 1000.0;
+	};
+
+	std::cout << std::left << std::setw(16) << name_ << std::right << std::fixed
+			  << std::setprecision(0) << std::setw(10) << latencies_.size() / seconds_ << " msg/s"
+			  << "  received: " << latencies_.size() << "/" << count_ << std::setprecision(1)
+			  << "  latency us p50: " << pct(0.5) << " p99: " << pct(0.99)
+			  << " p99.9: " << pct(0.999) << std::endl;
+}
+
+static void run_shm(unsigned long count_, unsigned size_, unsigned interval_us_)
+{
+	concurrency::shm_ring ring("shm_ring_bench", 1 << 20);
+	pid_t pid = ::fork();
+
+	if (pid == 0) {
+		concurrency::shm_ring producer(ring.fd());
+		std::vector<unsigned char> msg(size_);
+		uint64_t next = now_ns();
+
+		for (unsigned long i = 0; i < count_; i++) {
+			pace(next, interval_us_);
+			uint64_t ts = now_ns();
+			std::memcpy(msg.data(), &ts, sizeof(ts));
+			producer.send(msg.data(), size_);
+		}
+
+		::_exit(0);
+	}
+
+	std::vector<uint64_t> latencies;
+	latencies.reserve(count_);
+	uint64_t start = 0;
+
+	while (latencies.size() < count_) {
+		unsigned n = ring.receive([&](const unsigned char* data_, uint32_t) {
+			uint64_t ts;
+			std::memcpy(&ts, data_, sizeof(ts));
+			uint64_t now = now_ns();
+
+			if (start == 0)
+				start = ts;
+
+			latencies.push_back(now - ts);
+		}, 1000);
+
+		if (n == 0)
+			break;
+	}
+
+	double seconds = (now_ns() - start) / 1e9;
+	::waitpid(pid, nullptr, 0);
+	report(interval_us_ ? "shm_ring paced" : "shm_ring", count_, latencies, seconds);
+}
+
+static void run_udp(unsigned long count_, unsigned size_, unsigned interval_us_)
+{
+	net::socket rx(net::socket::type::dgram);
+	rx.bind(net::endpoint::from_string("127.0.0.1", 0));
+	auto dst = rx.local_endpoint();
+
+	int rcvbuf = 8 << 20;
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	struct timeval tv { 0, 200000 };
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	pid_t pid = ::fork();
+
+	if (pid == 0) {
+		net::socket tx(net::socket::type::dgram);
+		tx.connect(dst);
+		std::vector<unsigned char> msg(size_);
+		uint64_t next = now_ns();
+
+		for (unsigned long i = 0; i < count_; i++) {
+			pace(next, interval_us_);
+			uint64_t ts = now_ns();
+			std::memcpy(msg.data(), &ts, sizeof(ts));
+			tx.send(msg.data(), size_);
+		}
+
+		::_exit(0);
+	}
+
+	std::vector<uint64_t> latencies;
+	latencies.reserve(count_);
+	std::vector<unsigned char> buf(std::max(size_, 2048u));
+	uint64_t start = 0;
+
+	while (latencies.size() < count_) {
+		try {
+			rx.receive(buf.data(), (unsigned) buf.size());
+		} catch (const std::runtime_error&) {
+			break; // receive timeout, the sender is done and the rest was dropped
+		}
+
+		uint64_t ts;
+		std::memcpy(&ts, buf.data(), sizeof(ts));
+
+		if (start == 0)
+			start = ts;
+
+		latencies.push_back(now_ns() - ts);
+	}
+
+	double seconds = (now_ns() - start) / 1e9;
+	::waitpid(pid, nullptr, 0);
+	report(interval_us_ ? "udp paced" : "udp", count_, latencies, seconds);
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long count = argc_ > 1 ? std::stoul(argv_[1]) : 1000000;
+	unsigned size       = argc_ > 2 ? std::max(8u, (unsigned) std::stoul(argv_[2])) : 64;
+	unsigned interval   = argc_ > 3 ? (unsigned) std::stoul(argv_[3]) : 10;
+
+	run_shm(count, size, 0);
+	run_udp(count, size, 0);
+	run_shm(count / 10, size, interval);
+	run_udp(count / 10, size, interval);
+	return 0;
+}
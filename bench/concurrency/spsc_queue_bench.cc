@@ -0,0 +1,158 @@
+// compares handing items from one producer thread to one consumer thread through
+// concurrency::queue and concurrency::spsc_queue (single items, bursts and blocking waits)
+//
+// usage: spsc_queue_bench [items] [capacity] [burst]
+
+#include <chrono>
+#include <om/om.h>
+
+using namespace om;
+
+static void report(const char* name_, unsigned long items_, std::chrono::steady_clock::duration d_)
+{
+	double s = std::chrono::duration<double>(d_).count();
+	std::cout << std::left << std::setw(20) << name_ << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(10) << items_ / s / 1e6 << " M items/s" << std::setprecision(1)
+		<< std::setw(10) << s * 1e9 / items_ << " ns/item" << std::endl;
+}
+
+//! runs producer_ and consumer_ on two threads, checks the sum of the consumed items
+template<typename Producer, typename Consumer>
+static void run(const char* name_, unsigned long items_, Producer producer_, Consumer consumer_)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::thread producer(producer_);
+	uint64_t sum = consumer_();
+	producer.join();
+	report(name_, items_, std::chrono::steady_clock::now() - start);
+
+	if (sum != (uint64_t) items_ * (items_ - 1) / 2)
+		throw std::runtime_error(std::string(name_) + ": lost items");
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long items = argc_ > 1 ? std::stoul(argv_[1]) : 10000000;
+	std::size_t capacity = argc_ > 2 ? std::stoul(argv_[2]) : 4096;
+	std::size_t burst    = argc_ > 3 ? std::stoul(argv_[3]) : 32;
+
+	{
+		concurrency::queue<uint64_t> queue;
+		run("queue", items, [&]() {
+			for (uint64_t i = 0; i < items; i++)
+				queue.enqueue(i);
+		}, [&]() {
+			uint64_t sum = 0, item;
+
+			for (unsigned long n = 0; n < items; n++) {
+				queue.dequeue_wait(item);
+				sum += item;
+			}
+
+			return sum;
+		});
+	}
+
+	{
+		concurrency::queue<uint64_t> queue;
+		run("queue bulk", items, [&]() {
+			std::vector<uint64_t> buf(burst);
+
+			for (uint64_t i = 0; i < items; ) {
+				std::size_t n = std::min<uint64_t>(burst, items - i);
+
+				for (std::size_t j = 0; j < n; j++)
+					buf[j] = i + j;
+
+				queue.enqueue_bulk(buf.begin(), buf.begin() + n);
+				i += n;
+			}
+		}, [&]() {
+			std::vector<uint64_t> buf(burst);
+			uint64_t sum = 0;
+
+			for (unsigned long n = 0; n < items; ) {
+				std::size_t got = queue.dequeue_wait_bulk(buf.begin(), burst);
+
+				for (std::size_t j = 0; j < got; j++)
+					sum += buf[j];
+
+				n += got;
+			}
+
+			return sum;
+		});
+	}
+
+	{
+		concurrency::spsc_queue<uint64_t> queue(capacity);
+		run("spsc_queue", items, [&]() {
+			for (uint64_t i = 0; i < items; i++)
+				while (!queue.try_push(i))
+					std::this_thread::yield();
+		}, [&]() {
+			uint64_t sum = 0, item;
+
+			for (unsigned long n = 0; n < items; ) {
+				if (queue.try_pop(item)) {
+					sum += item;
+					n++;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+
+			return sum;
+		});
+	}
+
+	{
+		concurrency::spsc_queue<uint64_t> queue(capacity);
+		run("spsc_queue bulk", items, [&]() {
+			std::vector<uint64_t> buf(burst);
+
+			for (uint64_t i = 0; i < items; ) {
+				std::size_t n = std::min<uint64_t>(burst, items - i);
+
+				for (std::size_t j = 0; j < n; j++)
+					buf[j] = i + j;
+
+				queue.push_bulk(buf.begin(), n);
+				i += n;
+			}
+		}, [&]() {
+			std::vector<uint64_t> buf(burst);
+			uint64_t sum = 0;
+
+			for (unsigned long n = 0; n < items; ) {
+				std::size_t got = queue.pop_bulk(buf.begin(), burst);
+
+				for (std::size_t j = 0; j < got; j++)
+					sum += buf[j];
+
+				n += got;
+			}
+
+			return sum;
+		});
+	}
+
+	{
+		concurrency::spsc_queue<uint64_t> queue(capacity);
+		run("spsc_queue blocking", items, [&]() {
+			for (uint64_t i = 0; i < items; i++)
+				queue.push(i);
+		}, [&]() {
+			uint64_t sum = 0, item;
+
+			for (unsigned long n = 0; n < items; n++) {
+				queue.pop(item);
+				sum += item;
+			}
+
+			return sum;
+		});
+	}
+
+	return 0;
+}
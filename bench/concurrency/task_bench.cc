@@ -0,0 +1,121 @@
+// counts heap allocations per submitted task for std::function and concurrency::task, and per
+// thread_pool submit with different task queues and from inside the pool
+//
+// usage: task_bench [tasks]
+
+#include <chrono>
+#include <new>
+#include <om/om.h>
+
+using namespace om;
+
+static std::atomic<unsigned long> allocations { 0 };
+
+void* operator new(std::size_t size_)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* p = std::malloc(size_ ? size_ : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p_) noexcept
+{
+	std::free(p_);
+}
+
+void operator delete(void* p_, std::size_t) noexcept
+{
+	std::free(p_);
+}
+
+static void report(const std::string& name_, unsigned long tasks_, unsigned long allocations_,
+	std::chrono::steady_clock::duration d_)
+{
+	double s = std::chrono::duration<double>(d_).count();
+	std::cout << std::left << std::setw(28) << name_ << std::right << std::fixed << std::setprecision(3)
+		<< std::setw(8) << (double) allocations_ / tasks_ << " allocations/task" << std::setprecision(2)
+		<< std::setw(9) << tasks_ / s / 1e6 << " M tasks/s" << std::endl;
+}
+
+//! constructs, moves and runs tasks_ functors with 48 bytes of captures as F
+template<typename F>
+static void construct(const std::string& name_, unsigned long tasks_)
+{
+	uint64_t a = 1, b = 2, c = 3, d = 4, e = 5, sum = 0;
+	uint64_t* out = &sum;
+	auto before = allocations.load();
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned long i = 0; i < tasks_; i++) {
+		F f([a, b, c, d, e, out]() { *out += a + b + c + d + e; });
+		F g(std::move(f));
+		g();
+	}
+
+	report(name_, tasks_, allocations - before, std::chrono::steady_clock::now() - start);
+
+	if (sum != tasks_ * 15)
+		throw std::runtime_error("wrong sum");
+}
+
+//! submits tasks_ tiny tasks, from the calling thread or, as fork/join code does, in rounds
+//! from a worker that helps until each round is done
+template<typename Pool>
+static void submit(const std::string& name_, unsigned long tasks_, bool from_worker_)
+{
+	Pool pool(2);
+	std::atomic<unsigned long> done { 0 };
+	uint64_t a = 1, b = 2, c = 3, d = 4;
+
+	auto spawn = [&pool, &done, a, b, c, d](unsigned long count_) {
+		for (unsigned long i = 0; i < count_; i++)
+			pool.submit([&done, a, b, c, d]() { done.fetch_add((a + b + c + d) / 10); });
+	};
+
+	auto fork_join = [&pool, &done, spawn](unsigned long count_) {
+		for (unsigned long i = 0; i < count_; i += 256) {
+			spawn(std::min(256ul, count_ - i));
+
+			while (done < std::min(i + 256, count_))
+				pool.try_run_one();
+		}
+	};
+
+	auto run = [&](unsigned long count_) {
+		done = 0;
+
+		if (from_worker_)
+			pool.submit([fork_join, count_]() { fork_join(count_); });
+		else
+			spawn(count_);
+
+		while (done < count_)
+			std::this_thread::yield();
+	};
+
+	// warm up the queues and node caches
+	run(10000);
+
+	auto before = allocations.load();
+	auto start  = std::chrono::steady_clock::now();
+	run(tasks_);
+	report(name_, tasks_, allocations - before, std::chrono::steady_clock::now() - start);
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long tasks = argc_ > 1 ? std::stoul(argv_[1]) : 1000000;
+
+	construct<std::function<void()>>("std::function", tasks);
+	construct<concurrency::task>("concurrency::task", tasks);
+
+	submit<concurrency::thread_pool>("thread_pool external", tasks, false);
+	submit<concurrency::basic_thread_pool<concurrency::mpmc_queue<concurrency::task>>>(
+		"mpmc thread_pool external", tasks, false);
+	submit<concurrency::thread_pool>("thread_pool internal", tasks, true);
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+// measures the work-stealing thread_pool with fork/join recursion (helping while waiting) and
+// with many tiny tasks submitted from outside the pool and from inside its workers, and the cpu
+// time the idle pool burns afterwards
+//
+// usage: thread_pool_bench [threads] [fib n] [tiny tasks]
+
+#include <chrono>
+#include <ctime>
+#include <om/om.h>
+
+using namespace om;
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point start_)
+{
+	return std::chrono::duration<double>(clock_type::now() - start_).count();
+}
+
+static unsigned long fib_seq(unsigned n_)
+{
+	return n_ < 2 ? n_ : fib_seq(n_ - 1) + fib_seq(n_ - 2);
+}
+
+template<typename Pool>
+static unsigned long fib(Pool& pool_, unsigned n_)
+{
+	if (n_ < 20)
+		return fib_seq(n_);
+
+	auto child = pool_.async([&pool_, n_]() { return fib(pool_, n_ - 2); });
+	unsigned long a = fib(pool_, n_ - 1);
+
+	// help instead of blocking the worker, the child is most likely still in our own deque
+	while (!child.ready())
+		if (!pool_.try_run_one())
+			std::this_thread::yield();
+
+	return a + child.get();
+}
+
+template<typename Pool>
+static void run(const std::string& name_, unsigned threads_, unsigned fib_n_, unsigned long tasks_)
+{
+	Pool pool(threads_);
+
+	auto start = clock_type::now();
+	unsigned long result = pool.async([&pool, fib_n_]() { return fib(pool, fib_n_); }).get();
+	double fork_join = seconds_since(start);
+
+	if (result != fib_seq(fib_n_))
+		throw std::runtime_error("wrong result");
+
+	// tiny tasks from outside, they all go through the shared queue
+	std::atomic<unsigned long> done { 0 };
+	start = clock_type::now();
+
+	for (unsigned long i = 0; i < tasks_; i++)
+		pool.submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+
+	while (done < tasks_)
+		std::this_thread::yield();
+
+	double external = seconds_since(start);
+
+	// tiny tasks from inside, they go to the workers' deques and are spread by stealing
+	done = 0;
+	start = clock_type::now();
+	unsigned long per_spawner = tasks_ / 64;
+
+	for (unsigned s = 0; s < 64; s++)
+		pool.submit([&pool, &done, per_spawner]() {
+			for (unsigned long i = 0; i < per_spawner; i++)
+				pool.submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+		});
+
+	while (done < per_spawner * 64)
+		std::this_thread::yield();
+
+	double internal = seconds_since(start);
+
+	// parked workers should not use any cpu
+	std::clock_t cpu = std::clock();
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	double idle_cpu = (double) (std::clock() - cpu) / CLOCKS_PER_SEC / 0.5;
+	auto m = pool.statistics();
+
+	std::cout << std::left << std::setw(16) << name_ << std::right << std::fixed << std::setprecision(3)
+		<< " fib(" << fib_n_ << ") " << std::setw(8) << fork_join << " s"
+		<< std::setprecision(2) << "  external " << std::setw(7) << tasks_ / external / 1e6 << " M tasks/s"
+		<< "  internal " << std::setw(7) << per_spawner * 64 / internal / 1e6 << " M tasks/s"
+		<< "  idle cpu " << std::setw(5) << idle_cpu * 100 << " %" << std::endl
+		<< std::setw(16) << "" << " stolen " << m.stolen << "  parks " << m.parks
+		<< "  wakes " << m.wakes << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned threads     = argc_ > 1 ? std::stoul(argv_[1]) : std::thread::hardware_concurrency();
+	unsigned fib_n       = argc_ > 2 ? std::stoul(argv_[2]) : 32;
+	unsigned long tasks  = argc_ > 3 ? std::stoul(argv_[3]) : 1000000;
+
+	auto start = clock_type::now();
+	volatile unsigned long result = fib_seq(fib_n);
+	(void) result;
+	std::cout << "sequential       fib(" << fib_n << ") " << std::fixed << std::setprecision(3)
+		<< std::setw(8) << seconds_since(start) << " s" << std::endl;
+
+	run<concurrency::thread_pool>("thread_pool", threads, fib_n, tasks);
+	run<concurrency::basic_thread_pool<concurrency::mpmc_queue<concurrency::task>>>(
+		"mpmc thread_pool", threads, fib_n, tasks);
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+
+// measures udp receive throughput of a listener_group over loopback for increasing group sizes
+//
+// usage: listener_group_bench [datagrams per run] [sender threads] [cpu steering 0/1]
+
+#include <om/om.h>
+
+using namespace om;
+
+static void run(unsigned size_, unsigned long count_, unsigned senders_, bool steering_)
+{
+	net::listener_group::config cfg;
+	cfg.size = size_;
+	cfg.cpu_steering = steering_;
+	cfg.poll_timeout = 10;
+
+	net::listener_group group(net::ip4_addr::from_string("127.0.0.1"), 0, cfg);
+
+	for (unsigned i = 0; i < group.size(); i++) {
+		int rcvbuf = 4 << 20;
+		::setsockopt(group.at(i).fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	}
+
+	std::atomic<unsigned long> received { 0 };
+	group.start([&received](unsigned, const net::datagram_batch& batch_) {
+		received.fetch_add(batch_.size(), std::memory_order_relaxed);
+	});
+
+	auto start = etc::now();
+	std::vector<std::thread> threads;
+
+	for (unsigned s = 0; s < senders_; s++) {
+		threads.emplace_back([&group, count_, senders_]() {
+			// many source ports so that flows hash to all sockets
+			std::vector<std::unique_ptr<net::socket>> socks;
+
+			for (unsigned i = 0; i < 16; i++)
+				socks.emplace_back(new net::socket(net::socket::type::dgram));
+
+			unsigned char payload[64] = { 0 };
+			auto dst = net::ip4_addr::from_string("127.0.0.1");
+
+			for (unsigned long i = 0; i < count_ / senders_; ) {
+				auto& sock = *socks[i % socks.size()];
+				net::datagram_batch batch(32, sizeof(payload));
+
+				for (unsigned j = 0; j < 32 && i < count_ / senders_; j++, i++)
+					batch.push(payload, sizeof(payload), dst, group.port());
+
+				sock.send_batch(batch);
+			}
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	// wait for the receivers to drain their queues
+	unsigned long last = ~0UL;
+
+	while (received != last) {
+		last = received;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+
+	double seconds = etc::seconds_since(start) - 0.05;
+	group.stop();
+
+	std::cout << "sockets: " << std::setw(3) << size_ << std::fixed << std::setprecision(0)
+			  << "  rx: " << std::setw(10) << received / seconds << " pps"
+			  << "  received: " << received << "/" << count_ << "  per socket:";
+
+	for (unsigned i = 0; i < group.size(); i++)
+		std::cout << " " << group.received(i);
+
+	std::cout << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long count = argc_ > 1 ? std::stoul(argv_[1]) : 2000000;
+	unsigned senders    = argc_ > 2 ? (unsigned) std::stoul(argv_[2]) : 2;
+	bool steering       = argc_ > 3 && std::stoul(argv_[3]) != 0;
+	unsigned cpus       = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned size = 1; size <= cpus; size *= 2)
+		run(size, count, senders, steering);
+
+	return 0;
+}
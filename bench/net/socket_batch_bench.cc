@@ -0,0 +1,128 @@
+
+// compares single-datagram and batched (recvmmsg/sendmmsg) udp throughput over loopback
+//
+// usage: socket_batch_bench [datagrams] [datagram size] [batch size]
+
+#include <om/om.h>
+
+using namespace om;
+
+static const unsigned short PORT = 47100;
+
+struct result
+{
+	double tx_pps = 0;
+	double rx_pps = 0;
+	unsigned long received = 0;
+	uint64_t drops = 0;
+};
+
+template <typename Sender, typename Receiver>
+static result run(unsigned long count_, Sender sender_, Receiver receiver_)
+{
+	net::socket rx(net::socket::type::dgram);
+	rx.bind("0.0.0.0", PORT);
+
+	int rcvbuf = 8 << 20;
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	struct timeval tv { 0, 200000 };
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	rx.enable_drop_counter();
+
+	result res;
+	std::chrono::time_point<std::chrono::high_resolution_clock> rx_start, rx_end;
+
+	std::thread receiver([&]() {
+		bool first = true;
+
+		for (;;) {
+			unsigned n = 0;
+
+			try {
+				n = receiver_(rx);
+			} catch (const std::runtime_error&) {
+				break; // receive timeout, the sender is done
+			}
+
+			if (first) {
+				rx_start = etc::now();
+				first = false;
+			}
+
+			rx_end = etc::now();
+			res.received += n;
+		}
+	});
+
+	net::socket tx(net::socket::type::dgram);
+	double tx_seconds = etc::runtime([&]() { sender_(tx, count_); });
+
+	receiver.join();
+	res.drops = rx.statistics().drops;
+
+	auto rx_seconds = std::chrono::duration<double>(rx_end - rx_start).count();
+	res.tx_pps = count_ / tx_seconds;
+	res.rx_pps = rx_seconds > 0 ? res.received / rx_seconds : 0;
+	return res;
+}
+
+static void print(const std::string& name_, unsigned long count_, const result& r_)
+{
+	std::cout << std::left << std::setw(10) << name_ << std::right << std::fixed
+			  << std::setprecision(0)
+			  << " tx: " << std::setw(10) << r_.tx_pps << " pps"
+			  << "  rx: " << std::setw(10) << r_.rx_pps << " pps"
+			  << "  received: " << r_.received << "/" << count_
+			  << "  dropped by kernel: " << r_.drops << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long count = argc_ > 1 ? std::stoul(argv_[1]) : 1000000;
+	unsigned size       = argc_ > 2 ? (unsigned) std::stoul(argv_[2]) : 64;
+	unsigned batch_size = argc_ > 3 ? (unsigned) std::stoul(argv_[3]) : 64;
+
+	std::vector<unsigned char> payload(size, 0xab);
+
+	auto single = run(count,
+		[&payload](net::socket& tx_, unsigned long n_) {
+			for (unsigned long i = 0; i < n_; i++)
+				tx_.send_to("127.0.0.1", PORT, payload.data(), (unsigned) payload.size());
+		},
+		[&payload](net::socket& rx_) {
+			unsigned char buf[65536];
+			net::endpoint from;
+			rx_.receive_from(buf, sizeof(buf), from);
+			return 1u;
+		});
+
+	print("single", count, single);
+
+	net::datagram_batch rx_batch(batch_size, std::max(size, 64u));
+
+	auto batched = run(count,
+		[&payload, batch_size, size](net::socket& tx_, unsigned long n_) {
+			net::datagram_batch batch(batch_size, size);
+			auto dst = net::ip4_addr::from_string("127.0.0.1");
+
+			for (unsigned long i = 0; i < n_; ) {
+				batch.clear();
+
+				for (; i < n_ && batch.push(payload.data(), size, dst, PORT); i++)
+					;
+
+				tx_.send_batch(batch);
+			}
+		},
+		[&rx_batch](net::socket& rx_) {
+			unsigned n = rx_.receive_batch(rx_batch);
+
+			if (n == 0)
+				throw std::runtime_error("timeout");
+
+			return n;
+		});
+
+	print("batched", count, batched);
+	return 0;
+}
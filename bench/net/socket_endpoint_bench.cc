@@ -0,0 +1,56 @@
+// compares small-datagram send rates for string addresses, preresolved endpoints and connected
+// sockets over loopback
+//
+// usage: socket_endpoint_bench [datagrams] [datagram size]
+
+#include <om/om.h>
+
+using namespace om;
+
+template <typename Sender>
+static void run(const std::string& name_, unsigned long count_, Sender sender_)
+{
+	net::socket rx(net::socket::type::dgram);
+	rx.bind(net::endpoint::from_string("127.0.0.1", 0));
+
+	net::socket tx(net::socket::type::dgram);
+	auto dst = rx.local_endpoint();
+
+	// datagrams are dropped once the receive buffer is full, which does not affect the sender
+	double seconds = etc::runtime([&]() { sender_(tx, dst, count_); });
+
+	std::cout << std::left << std::setw(12) << name_ << std::right << std::fixed
+			  << std::setprecision(0) << " tx: " << std::setw(10) << count_ / seconds << " pps"
+			  << std::setprecision(1) << "  " << std::setw(6) << seconds * 1e9 / count_
+			  << " ns/send" << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long count = argc_ > 1 ? std::stoul(argv_[1]) : 1000000;
+	unsigned size       = argc_ > 2 ? (unsigned) std::stoul(argv_[2]) : 16;
+
+	std::vector<unsigned char> payload(size, 0xab);
+	const unsigned char* data = payload.data();
+
+	run("string", count, [=](net::socket& tx_, const net::endpoint& dst_, unsigned long n_) {
+		std::string ip = dst_.address();
+
+		for (unsigned long i = 0; i < n_; i++)
+			tx_.send_to(ip, dst_.port(), data, size);
+	});
+
+	run("endpoint", count, [=](net::socket& tx_, const net::endpoint& dst_, unsigned long n_) {
+		for (unsigned long i = 0; i < n_; i++)
+			tx_.send_to(dst_, data, size);
+	});
+
+	run("connected", count, [=](net::socket& tx_, const net::endpoint& dst_, unsigned long n_) {
+		tx_.connect(dst_);
+
+		for (unsigned long i = 0; i < n_; i++)
+			tx_.send(data, size);
+	});
+
+	return 0;
+}
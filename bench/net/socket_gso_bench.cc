@@ -0,0 +1,105 @@
+
+// compares per-datagram sends with udp segmentation offload (UDP_SEGMENT/UDP_GRO) over loopback
+//
+// usage: socket_gso_bench [datagrams] [datagram size]
+
+#include <om/om.h>
+
+using namespace om;
+
+static const unsigned short PORT = 47101;
+
+template <typename Sender>
+static void run(const std::string& name_, unsigned long count_, bool gro_,
+	Sender sender_)
+{
+	net::socket rx(net::socket::type::dgram);
+	rx.bind("0.0.0.0", PORT);
+
+	bool gro = gro_ && rx.enable_gro();
+	int rcvbuf = 8 << 20;
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	struct timeval tv { 0, 200000 };
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	unsigned long received = 0, calls = 0;
+	std::chrono::time_point<std::chrono::high_resolution_clock> rx_start, rx_end;
+
+	std::thread receiver([&]() {
+		std::vector<unsigned char> buf(65536);
+		net::ip4_addr ip;
+		uint16_t port = 0, segment_size = 0;
+
+		for (;;) {
+			unsigned len = 0;
+
+			try {
+				len = rx.receive_coalesced(buf.data(), (unsigned) buf.size(), segment_size, ip, port);
+			} catch (const std::runtime_error&) {
+				break;
+			}
+
+			if (calls++ == 0)
+				rx_start = etc::now();
+
+			rx_end = etc::now();
+			// a zero-length datagram still counts as one
+			received += segment_size == 0 ? 1 : (len + segment_size - 1) / segment_size;
+		}
+	});
+
+	net::socket tx(net::socket::type::dgram);
+	double tx_seconds = etc::runtime([&]() { sender_(tx); });
+
+	receiver.join();
+
+	auto rx_seconds = std::chrono::duration<double>(rx_end - rx_start).count();
+
+	std::cout << std::left << std::setw(22) << (name_ + (gro ? " + gro" : ""))
+			  << std::right << std::fixed << std::setprecision(0)
+			  << " tx: " << std::setw(10) << count_ / tx_seconds << " pps"
+			  << "  rx: " << std::setw(10) << (rx_seconds > 0 ? received / rx_seconds : 0) << " pps"
+			  << "  received: " << received << "/" << count_
+			  << "  recv calls: " << calls << std::endl;
+}
+
+int main(int argc_, char** argv_)
+{
+	unsigned long count = argc_ > 1 ? std::stoul(argv_[1]) : 1000000;
+	unsigned size       = argc_ > 2 ? (unsigned) std::stoul(argv_[2]) : 1200;
+	auto dst            = net::ip4_addr::from_string("127.0.0.1");
+
+	const unsigned per_call = std::min(64u, 65000u / size);
+	std::vector<unsigned char> payload((std::size_t) size * per_call, 0xab);
+
+	auto per_datagram = [&](net::socket& tx_) {
+		for (unsigned long i = 0; i < count; i++)
+			tx_.send_to("127.0.0.1", PORT, payload.data(), size);
+	};
+
+	auto batched = [&](net::socket& tx_) {
+		net::datagram_batch batch(per_call, size);
+
+		for (unsigned long i = 0; i < count; ) {
+			batch.clear();
+
+			for (; i < count && batch.push(payload.data(), size, dst, PORT); i++)
+				;
+
+			tx_.send_batch(batch);
+		}
+	};
+
+	auto segmented = [&](net::socket& tx_) {
+		for (unsigned long i = 0; i < count; i += per_call) {
+			auto n = (unsigned) std::min<unsigned long>(per_call, count - i);
+			tx_.send_segmented(dst, PORT, payload.data(), n * size, (uint16_t) size);
+		}
+	};
+
+	run("send_to", count, false, per_datagram);
+	run("send_batch", count, false, batched);
+	run("send_segmented", count, false, segmented);
+	run("send_segmented", count, true, segmented);
+	return 0;
+}
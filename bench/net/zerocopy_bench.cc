@@ -0,0 +1,96 @@
+
+// compares copying and MSG_ZEROCOPY sends over a loopback tcp connection for increasing send sizes
+//
+// usage: zerocopy_bench [MiB per size]
+//
+// on loopback the kernel copies zerocopy sends on delivery, so the crossover point only shows
+// up when sending through a physical device
+
+#include <om/om.h>
+
+using namespace om;
+
+static double run(std::size_t size_, std::size_t total_, bool zerocopy_)
+{
+	const auto localhost = net::ip4_addr::from_string("127.0.0.1");
+	net::tcp_listener listener(localhost);
+
+	net::tcp_stream client;
+	client.connect(localhost, listener.port());
+
+	struct pollfd pfd { listener.fd(), POLLIN, 0 };
+	::poll(&pfd, 1, 1000);
+
+	net::tcp_stream server;
+	listener.accept(server);
+
+	pfd = { client.fd(), POLLOUT, 0 };
+	::poll(&pfd, 1, 1000);
+	sys::set_nonblocking(client.fd(), false);
+
+	std::thread reader([&server, total_]() {
+		std::vector<unsigned char> buf(1 << 20);
+		std::size_t received = 0;
+
+		while (received < total_) {
+			struct pollfd rfd { server.fd(), POLLIN, 0 };
+			::poll(&rfd, 1, 1000);
+			auto r = server.read(buf.data(), buf.size());
+
+			if (r.ok() && r.value() == 0)
+				break;
+
+			received += r.value();
+		}
+	});
+
+	// a threshold of 0 forces zerocopy, a threshold above the size forces copies
+	net::zerocopy_sender sender(client, 64, (unsigned) size_, zerocopy_ ? 0 : (unsigned) size_ + 1);
+
+	double t = etc::runtime([&]() {
+		for (std::size_t sent = 0; sent < total_; ) {
+			unsigned char* buf = sender.acquire();
+
+			if (!buf) {
+				sender.wait_all(10);
+				continue;
+			}
+
+			sent += sender.send(buf, (unsigned) size_);
+		}
+
+		sender.wait_all(1000);
+	});
+
+	reader.join();
+	return total_ / t / (1 << 20);
+}
+
+int main(int argc_, char** argv_)
+{
+	std::size_t total = (argc_ > 1 ? std::stoul(argv_[1]) : 256) << 20;
+	bool crossed = false;
+
+	std::cout << std::setw(10) << "size" << std::setw(14) << "copy MiB/s"
+			  << std::setw(16) << "zerocopy MiB/s" << std::endl;
+
+	for (std::size_t size = 1024; size <= (1 << 20); size *= 2) {
+		double copy = run(size, total, false);
+		double zerocopy = run(size, total, true);
+
+		std::cout << std::setw(10) << size << std::fixed << std::setprecision(0)
+				  << std::setw(14) << copy << std::setw(16) << zerocopy;
+
+		if (!crossed && zerocopy > copy) {
+			std::cout << "  <- crossover";
+			crossed = true;
+		}
+
+		std::cout << std::endl;
+	}
+
+	if (!crossed)
+		std::cout << "no crossover: zerocopy never beat copying" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+// measures dependent random reads (a pointer chase) and sequential reads over a table placed on
+// one numa node, from threads pinned to each node in turn, and a thread_pool updating per-node
+// tables with and without per_node placement; on a single node machine only local access is
+// measured
+//
+// usage: numa_bench [table MiB] [reads]
+
+#include <chrono>
+#include <om/om.h>
+
+using namespace om;
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point start_)
+{
+	return std::chrono::duration<double>(clock_type::now() - start_).count();
+}
+
+//! links the slots of table_ into one random cycle (Sattolo's algorithm)
+static void make_cycle(uint64_t* table_, std::size_t count_)
+{
+	uint64_t rng = 0x9e3779b97f4a7c15ULL;
+
+	for (std::size_t i = 0; i < count_; i++)
+		table_[i] = i;
+
+	for (std::size_t i = count_ - 1; i > 0; i--) {
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+		std::swap(table_[i], table_[rng % i]);
+	}
+}
+
+//! runs f_ on a thread pinned to cpus_
+template<typename Fx>
+static void run_on(const sys::cpu_set& cpus_, Fx f_)
+{
+	std::thread t([&]() {
+		cpus_.pin();
+		f_();
+	});
+	t.join();
+}
+
+int main(int argc_, char** argv_)
+{
+	std::size_t mib   = argc_ > 1 ? std::stoul(argv_[1]) : 256;
+	unsigned long reads = argc_ > 2 ? std::stoul(argv_[2]) : 20000000;
+
+	const sys::cpu_topology& topology = sys::cpu_topology::local();
+	sys::cpu_set allowed = sys::cpu_set::current();
+	std::vector<int> nodes;
+
+	for (int node : topology.nodes())
+		if (!(topology.node_cpus(node) & allowed).empty() || allowed.empty())
+			nodes.push_back(node);
+
+	std::cout << topology.cpus().size() << " cpus, " << topology.nodes().size() << " numa nodes, "
+		<< "allowed cpus " << allowed.to_string() << std::endl;
+
+	if (nodes.size() < 2)
+		std::cout << "single numa node, remote access is not measured" << std::endl;
+
+	const std::size_t size  = mib << 20;
+	const std::size_t count = size / sizeof(uint64_t);
+	int home = nodes.front();
+
+	uint64_t* table = static_cast<uint64_t*>(sys::numa_alloc(size, home));
+	run_on(topology.node_cpus(home) & allowed, [&]() { make_cycle(table, count); });
+
+	for (int node : nodes) {
+		const char* where = node == home ? "local" : "remote";
+		sys::cpu_set cpus = topology.node_cpus(node) & allowed;
+		double chase = 0, scan = 0;
+		volatile uint64_t sink = 0; // keeps the loops from being optimized out
+
+		run_on(cpus, [&]() {
+			auto start = clock_type::now();
+			uint64_t i = 0;
+
+			for (unsigned long n = 0; n < reads; n++)
+				i = table[i];
+
+			chase = seconds_since(start);
+			start = clock_type::now();
+
+			for (std::size_t j = 0; j < count; j++)
+				i += table[j];
+
+			scan = seconds_since(start);
+			sink = i;
+		});
+
+		std::cout << "node " << node << " (" << std::setw(6) << where << ")  " << std::fixed
+			<< std::setprecision(1) << std::setw(8) << chase * 1e9 / reads << " ns/dependent read"
+			<< std::setprecision(2) << std::setw(10) << size / scan / 1e9 << " GB/s sequential"
+			<< std::endl;
+	}
+
+	sys::numa_free(table, size);
+
+	// every worker hammers the table of the node it was assigned to
+	for (sys::placement placement : { sys::placement::none, sys::placement::per_node }) {
+		concurrency::thread_pool::config config;
+		config.placement = placement;
+		concurrency::thread_pool pool(config);
+
+		std::size_t per_node = size / nodes.size() / sizeof(uint64_t);
+		std::vector<std::vector<uint64_t, sys::numa_allocator<uint64_t>>> tables;
+
+		for (int node : nodes)
+			tables.emplace_back(per_node, 0, sys::numa_allocator<uint64_t>(node));
+
+		unsigned tasks = (unsigned) pool.size() * 4;
+		std::vector<concurrency::future<void>> done;
+		auto start = clock_type::now();
+
+		for (unsigned t = 0; t < tasks; t++) {
+			done.push_back(pool.async([&tables, &nodes, per_node, reads, tasks, t]() {
+				int node = sys::current_node();
+				std::size_t index = 0;
+
+				for (std::size_t i = 0; i < nodes.size(); i++)
+					if (nodes[i] == node)
+						index = i;
+
+				uint64_t* slots = tables[index].data();
+				uint64_t rng = 0x9e3779b97f4a7c15ULL * (t + 1);
+
+				for (unsigned long n = 0; n < reads / tasks; n++) {
+					rng ^= rng << 13;
+					rng ^= rng >> 7;
+					rng ^= rng << 17;
+					slots[rng % per_node]++;
+				}
+			}));
+		}
+
+		for (auto& f : done)
+			f.get();
+
+		double s = seconds_since(start);
+		std::cout << "thread_pool " << std::left << std::setw(9)
+			<< (placement == sys::placement::none ? "unpinned" : "per_node") << std::right
+			<< std::setprecision(2) << std::setw(10) << reads / s / 1e6 << " M updates/s" << std::endl;
+	}
+
+	return 0;
+}
@@ -2,17 +2,26 @@
 #ifndef LIBOM2_H
 #define LIBOM2_H
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <cstddef>
 #include <arpa/inet.h>
 #include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <netdb.h>
 #include <net/if.h>
 #include <netinet/if_ether.h>
 #include <netinet/in.h>
@@ -24,16 +33,50 @@
 #include <queue>
 #include <sstream>
 #include <stdexcept>
+#include <tuple>
 #include <string>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <thread>
+#include <type_traits>
 #include <regex>
 #include <unistd.h>
 #include <vector>
 
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/filter.h>
+#include <linux/futex.h>
+#include <linux/if_packet.h>
+#include <linux/mempolicy.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define OM_HAVE_IO_URING
+#endif
+#endif
+#endif
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#include <optional>
+#include <utility>
+#define OM_HAVE_COROUTINES
+#endif
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 namespace om {
 
 	namespace sys {
@@ -47,6 +90,63 @@ namespace om {
 			int _fd = -1;
 		};
 
+		//! the result of a non-blocking I/O operation, either a value (e.g. a byte count) or an
+		//! errno value
+		//!
+		//! Expected conditions such as EAGAIN are reported as values instead of exceptions.
+		class io_result
+		{
+		public:
+			io_result() = default;
+			io_result(std::size_t value_, int error_) : _value(value_), _error(error_) { }
+
+			//! captures the return value of a system call, taking errno if it is negative
+			static io_result from(ssize_t r_)
+			{
+				return r_ >= 0 ? io_result((std::size_t) r_, 0) : io_result(0, errno);
+			}
+
+			//! captures the return value of a read, where 0 marks the end of the stream
+			static io_result from_read(ssize_t r_)
+			{
+				io_result result = from(r_);
+				result._eof = r_ == 0;
+				return result;
+			}
+
+			//! returns the byte count or, for accept_batch(), the number of connections
+			std::size_t value() const { return _value; }
+
+			//! returns the errno value or 0 on success
+			int error() const { return _error; }
+
+			bool ok() const { return _error == 0; }
+			bool would_block() const { return _error == EAGAIN || _error == EWOULDBLOCK; }
+			bool in_progress() const { return _error == EINPROGRESS || _error == EALREADY; }
+
+			//! returns true if a read reached the end of the stream, i.e. the peer closed the
+			//! connection; never set for other operations such as an empty write
+			bool eof() const { return _eof; }
+
+			explicit operator bool() const { return ok(); }
+
+		private:
+			std::size_t _value = 0;
+			int _error         = 0;
+			bool _eof          = false;
+		};
+
+		//! enables or disables O_NONBLOCK on a file descriptor, throws std::runtime_error upon error
+		inline void set_nonblocking(int fd_, bool nonblocking_ = true)
+		{
+			int flags = ::fcntl(fd_, F_GETFL, 0);
+
+			if (flags == -1 || ::fcntl(fd_, F_SETFL,
+				nonblocking_ ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) == -1)
+				throw std::runtime_error("set_nonblocking: could not set flags: errno: "
+					+ std::to_string(errno));
+		}
+
 		inline unsigned write_uint16(uint16_t val_, char* buf_)
 		{
 			buf_[0] = (val_ >> 8) & 0xff;
@@ -101,6 +201,481 @@ namespace om {
 			     | ((((uint64_t) buf_[6]) <<  8) & 0x000000000000ff00)
 			     | ((((uint64_t) buf_[7]) <<  0) & 0x00000000000000ff);
 		}
+
+		//! a set of cpu ids, sorted and without duplicates
+		class cpu_set
+		{
+		public:
+			cpu_set() = default;
+			cpu_set(std::initializer_list<int> cpus_) : _cpus(cpus_) { _normalize(); }
+			explicit cpu_set(std::vector<int> cpus_) : _cpus(std::move(cpus_)) { _normalize(); }
+
+			//! parses the kernel's cpu list format, e.g. "0-3,8,10-11", throws
+			//! std::invalid_argument upon error
+			static cpu_set parse(const std::string& list_)
+			{
+				std::vector<int> cpus;
+				std::istringstream in(list_);
+				std::string range;
+
+				while (std::getline(in, range, ',')) {
+					range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+
+					if (range.empty())
+						continue;
+
+					std::size_t dash = range.find('-');
+					std::size_t end  = 0;
+					int first = std::stoi(range.substr(0, dash), &end);
+					int last  = first;
+
+					if (end != (dash == std::string::npos ? range.size() : dash))
+						throw std::invalid_argument("cpu_set: invalid cpu list: " + list_);
+
+					if (dash != std::string::npos)
+						last = std::stoi(range.substr(dash + 1));
+
+					if (first < 0 || last < first)
+						throw std::invalid_argument("cpu_set: invalid cpu list: " + list_);
+
+					for (int cpu = first; cpu <= last; cpu++)
+						cpus.push_back(cpu);
+				}
+
+				return cpu_set(std::move(cpus));
+			}
+
+			//! returns the cpus the calling thread may run on, or an empty set if unknown
+			static cpu_set current()
+			{
+				std::vector<int> cpus;
+#ifdef __linux__
+				cpu_set_t set;
+				CPU_ZERO(&set);
+
+				if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+					for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+						if (CPU_ISSET(cpu, &set))
+							cpus.push_back(cpu);
+#endif
+				return cpu_set(std::move(cpus));
+			}
+
+			//! returns the set in the kernel's cpu list format
+			std::string to_string() const
+			{
+				std::string s;
+
+				for (std::size_t i = 0; i < _cpus.size(); ) {
+					std::size_t j = i;
+
+					while (j + 1 < _cpus.size() && _cpus[j + 1] == _cpus[j] + 1)
+						j++;
+
+					s += (s.empty() ? "" : ",") + std::to_string(_cpus[i]);
+
+					if (j > i)
+						s += "-" + std::to_string(_cpus[j]);
+
+					i = j + 1;
+				}
+
+				return s;
+			}
+
+			const std::vector<int>& cpus() const { return _cpus; }
+			std::size_t size() const { return _cpus.size(); }
+			bool empty() const { return _cpus.empty(); }
+			int operator[](std::size_t index_) const { return _cpus[index_]; }
+
+			bool contains(int cpu_) const
+			{
+				return std::binary_search(_cpus.begin(), _cpus.end(), cpu_);
+			}
+
+			//! returns the cpus in both sets
+			cpu_set operator&(const cpu_set& other_) const
+			{
+				std::vector<int> cpus;
+				std::set_intersection(_cpus.begin(), _cpus.end(), other_._cpus.begin(),
+					other_._cpus.end(), std::back_inserter(cpus));
+				return cpu_set(std::move(cpus));
+			}
+
+			bool operator==(const cpu_set& other_) const { return _cpus == other_._cpus; }
+			bool operator!=(const cpu_set& other_) const { return _cpus != other_._cpus; }
+
+			//! restricts thread_ to the cpus of the set, returns false if the set is empty or
+			//! the kernel refused
+			bool pin(std::thread& thread_) const
+			{
+#ifdef __linux__
+				cpu_set_t set;
+				return _to_native(set)
+					&& ::pthread_setaffinity_np(thread_.native_handle(), sizeof(set), &set) == 0;
+#else
+				(void) thread_;
+				return false;
+#endif
+			}
+
+			//! restricts the calling thread to the cpus of the set, see pin(std::thread&)
+			bool pin() const
+			{
+#ifdef __linux__
+				cpu_set_t set;
+				return _to_native(set) && ::sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+				return false;
+#endif
+			}
+
+		private:
+			std::vector<int> _cpus;
+
+			void _normalize()
+			{
+				std::sort(_cpus.begin(), _cpus.end());
+				_cpus.erase(std::unique(_cpus.begin(), _cpus.end()), _cpus.end());
+			}
+
+#ifdef __linux__
+			bool _to_native(cpu_set_t& set_) const
+			{
+				CPU_ZERO(&set_);
+
+				for (int cpu : _cpus)
+					if (cpu < CPU_SETSIZE)
+						CPU_SET(cpu, &set_);
+
+				return CPU_COUNT(&set_) > 0;
+			}
+#endif
+		};
+
+		//! how threads of a pool or group are spread across the cpus they may run on
+		enum class placement
+		{
+			none,     //!< threads are not pinned
+			per_cpu,  //!< thread i on the i-th cpu in id order
+			per_core, //!< one thread per physical core first, then on the SMT siblings
+			no_smt,   //!< like per_core, but never two threads on siblings of one core
+			per_node  //!< threads split evenly across numa nodes, free to move within their node
+		};
+
+		//! a logical cpu and where it sits in the machine
+		struct cpu_info
+		{
+			int id      = 0;
+			int core    = 0; //!< core id, unique within the package
+			int package = 0;
+			int node    = 0; //!< numa node
+		};
+
+		//! the cpu and numa topology of the machine as reported by sysfs
+		//!
+		//! Missing information degrades gracefully: without sysfs every cpu reported by
+		//! std::thread::hardware_concurrency() is its own core on node 0.
+		class cpu_topology
+		{
+		public:
+			//! reads the topology below sysfs_root_, the directory holding cpu/ and node/
+			explicit cpu_topology(const std::string& sysfs_root_ = "/sys/devices/system")
+			{
+				std::string online = _read_line(sysfs_root_ + "/cpu/online");
+				cpu_set cpus = online.empty() ? cpu_set() : cpu_set::parse(online);
+
+				if (cpus.empty()) {
+					std::vector<int> ids(std::max(1u, std::thread::hardware_concurrency()));
+
+					for (std::size_t i = 0; i < ids.size(); i++)
+						ids[i] = (int) i;
+
+					cpus = cpu_set(std::move(ids));
+				}
+
+				for (int id : cpus.cpus()) {
+					std::string dir = sysfs_root_ + "/cpu/cpu" + std::to_string(id) + "/topology/";
+					std::string core    = _read_line(dir + "core_id");
+					std::string package = _read_line(dir + "physical_package_id");
+
+					cpu_info info;
+					info.id      = id;
+					info.core    = core.empty() ? id : std::stoi(core);
+					info.package = package.empty() ? 0 : std::stoi(package);
+					_cpus.push_back(info);
+				}
+
+				std::string nodes = _read_line(sysfs_root_ + "/node/online");
+				cpu_set node_ids  = nodes.empty() ? cpu_set { 0 } : cpu_set::parse(nodes);
+
+				for (int node : node_ids.cpus()) {
+					std::string list = _read_line(sysfs_root_ + "/node/node" + std::to_string(node)
+						+ "/cpulist");
+
+					if (list.empty() && !nodes.empty())
+						continue;
+
+					cpu_set node_cpus = list.empty() ? cpus : cpu_set::parse(list);
+
+					for (auto& info : _cpus)
+						if (node_cpus.contains(info.id))
+							info.node = node;
+
+					_nodes.push_back(node);
+				}
+
+				if (_nodes.empty())
+					_nodes.push_back(0);
+			}
+
+			//! returns the topology of this machine, read once
+			static const cpu_topology& local()
+			{
+				static const cpu_topology topology;
+				return topology;
+			}
+
+			//! returns the online cpus in id order
+			const std::vector<cpu_info>& cpus() const
+			{
+				return _cpus;
+			}
+
+			//! returns the ids of the numa nodes that have cpus
+			const std::vector<int>& nodes() const
+			{
+				return _nodes;
+			}
+
+			//! returns the node of cpu_, -1 if the cpu is unknown
+			int node_of(int cpu_) const
+			{
+				for (const auto& info : _cpus)
+					if (info.id == cpu_)
+						return info.node;
+
+				return -1;
+			}
+
+			//! returns the cpus of node_
+			cpu_set node_cpus(int node_) const
+			{
+				std::vector<int> cpus;
+
+				for (const auto& info : _cpus)
+					if (info.node == node_)
+						cpus.push_back(info.id);
+
+				return cpu_set(std::move(cpus));
+			}
+
+			//! returns the cpus sharing a physical core with cpu_, including cpu_
+			cpu_set siblings(int cpu_) const
+			{
+				std::vector<int> cpus;
+
+				for (const auto& a : _cpus)
+					if (a.id == cpu_)
+						for (const auto& b : _cpus)
+							if (b.package == a.package && b.core == a.core)
+								cpus.push_back(b.id);
+
+				return cpu_set(std::move(cpus));
+			}
+
+			//! returns the cpu set for each of threads_ threads under policy_, only using cpus
+			//! in allowed_ (all cpus if empty)
+			//!
+			//! With placement::none, or if no allowed cpu is known, all sets are empty, i.e. the
+			//! threads are not pinned. Threads wrap around if there are more threads than cpus.
+			std::vector<cpu_set> place(unsigned threads_, placement policy_,
+				const cpu_set& allowed_ = cpu_set::current()) const
+			{
+				std::vector<cpu_info> cpus;
+
+				for (const auto& info : _cpus)
+					if (allowed_.empty() || allowed_.contains(info.id))
+						cpus.push_back(info);
+
+				std::vector<cpu_set> sets(threads_);
+
+				if (cpus.empty() || policy_ == placement::none)
+					return sets;
+
+				if (policy_ == placement::per_node) {
+					std::vector<int> nodes;
+
+					for (int node : _nodes)
+						for (const auto& info : cpus)
+							if (info.node == node) {
+								nodes.push_back(node);
+								break;
+							}
+
+					std::vector<cpu_set> node_sets;
+
+					for (int node : nodes)
+						node_sets.push_back(node_cpus(node) & cpu_set(_ids(cpus)));
+
+					for (unsigned i = 0; i < threads_; i++)
+						sets[i] = node_sets[(std::size_t) i * node_sets.size() / threads_];
+
+					return sets;
+				}
+
+				std::vector<int> order;
+
+				if (policy_ == placement::per_cpu) {
+					order = _ids(cpus);
+				} else {
+					// the n-th round takes the n-th sibling of every core, cores ordered by node
+					std::stable_sort(cpus.begin(), cpus.end(), [](const cpu_info& a_, const cpu_info& b_) {
+						return std::make_tuple(a_.node, a_.package, a_.core)
+							< std::make_tuple(b_.node, b_.package, b_.core);
+					});
+
+					std::vector<int> rank(cpus.size(), 0);
+
+					for (std::size_t i = 1; i < cpus.size(); i++)
+						if (cpus[i].package == cpus[i - 1].package && cpus[i].core == cpus[i - 1].core)
+							rank[i] = rank[i - 1] + 1;
+
+					int rounds = policy_ == placement::no_smt ? 1
+						: *std::max_element(rank.begin(), rank.end()) + 1;
+
+					for (int round = 0; round < rounds; round++)
+						for (std::size_t i = 0; i < cpus.size(); i++)
+							if (rank[i] == round)
+								order.push_back(cpus[i].id);
+				}
+
+				for (unsigned i = 0; i < threads_; i++)
+					sets[i] = cpu_set { order[i % order.size()] };
+
+				return sets;
+			}
+
+			//! like place(), but thread i < cpus_.size() is pinned to cpus_[i] instead
+			std::vector<cpu_set> place(unsigned threads_, placement policy_,
+				const std::vector<int>& cpus_, const cpu_set& allowed_ = cpu_set::current()) const
+			{
+				std::vector<cpu_set> sets = place(threads_, policy_, allowed_);
+
+				for (std::size_t i = 0; i < cpus_.size() && i < sets.size(); i++)
+					sets[i] = cpu_set { cpus_[i] };
+
+				return sets;
+			}
+
+		private:
+			std::vector<cpu_info> _cpus;
+			std::vector<int> _nodes;
+
+			static std::string _read_line(const std::string& file_name_)
+			{
+				std::ifstream file(file_name_);
+				std::string line;
+				std::getline(file, line);
+				return line;
+			}
+
+			static std::vector<int> _ids(const std::vector<cpu_info>& cpus_)
+			{
+				std::vector<int> ids;
+
+				for (const auto& info : cpus_)
+					ids.push_back(info.id);
+
+				return ids;
+			}
+		};
+
+		//! returns the numa node the calling thread is running on, -1 if unknown
+		inline int current_node()
+		{
+#ifdef __linux__
+			unsigned cpu = 0, node = 0;
+
+			if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+				return (int) node;
+#endif
+			return -1;
+		}
+
+		//! allocates size_ bytes of zeroed, page aligned memory whose pages are placed on numa
+		//! node node_, throws std::runtime_error upon error
+		//!
+		//! With node_ -1 each page is placed on the node of the thread that touches it first.
+		//! Meant for large tables, every allocation takes whole pages. Kernels without numa
+		//! support, or sandboxes refusing mbind(), get unbound memory.
+		inline void* numa_alloc(std::size_t size_, int node_ = -1)
+		{
+			void* ptr = ::mmap(nullptr, std::max<std::size_t>(size_, 1), PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (ptr == MAP_FAILED)
+				throw std::runtime_error("numa_alloc: could not map memory: errno: "
+					+ std::to_string(errno));
+
+#ifdef __linux__
+			if (node_ >= 0) {
+				std::vector<unsigned long> mask(node_ / (8 * sizeof(unsigned long)) + 1, 0);
+				mask[node_ / (8 * sizeof(unsigned long))] = 1UL << (node_ % (8 * sizeof(unsigned long)));
+
+				if (::syscall(SYS_mbind, ptr, std::max<std::size_t>(size_, 1), MPOL_BIND, mask.data(),
+					mask.size() * 8 * sizeof(unsigned long) + 1, 0) && errno != ENOSYS && errno != EPERM) {
+					int error = errno;
+					::munmap(ptr, std::max<std::size_t>(size_, 1));
+					throw std::runtime_error("numa_alloc: could not bind memory to node "
+						+ std::to_string(node_) + ": errno: " + std::to_string(error));
+				}
+			}
+#endif
+			return ptr;
+		}
+
+		//! frees memory returned by numa_alloc(), size_ must match the allocation
+		inline void numa_free(void* ptr_, std::size_t size_)
+		{
+			if (ptr_)
+				::munmap(ptr_, std::max<std::size_t>(size_, 1));
+		}
+
+		//! a standard allocator on top of numa_alloc(), e.g. for a flow table owned by the
+		//! threads of one node
+		template<typename T>
+		class numa_allocator
+		{
+		public:
+			using value_type = T;
+
+			explicit numa_allocator(int node_ = -1) : _node(node_) { }
+
+			template<typename U>
+			numa_allocator(const numa_allocator<U>& other_) : _node(other_.node()) { }
+
+			T* allocate(std::size_t n_)
+			{
+				return static_cast<T*>(numa_alloc(n_ * sizeof(T), _node));
+			}
+
+			void deallocate(T* ptr_, std::size_t n_)
+			{
+				numa_free(ptr_, n_ * sizeof(T));
+			}
+
+			int node() const { return _node; }
+
+			template<typename U>
+			bool operator==(const numa_allocator<U>& other_) const { return _node == other_.node(); }
+
+			template<typename U>
+			bool operator!=(const numa_allocator<U>& other_) const { return _node != other_.node(); }
+
+		private:
+			int _node;
+		};
 	}
 
 	namespace net {
@@ -118,11 +693,23 @@ namespace om {
 				   | ((a_ & 0x0000ff00)<<8) | (a_<<24);
 		}
 
+		//! splits "host:port" or "[ip6 address]:port" into host and port
 		static std::pair<std::string, unsigned short> parse_host_port(const std::string& host_port_)
 		{
+			if (!host_port_.empty() && host_port_[0] == '[') {
+				std::size_t close_pos = host_port_.find("]:");
+
+				if (close_pos != std::string::npos && close_pos + 2 < host_port_.size())
+					return std::make_pair(host_port_.substr(1, close_pos - 1),
+						(unsigned short) std::stoul(host_port_.substr(close_pos + 2)));
+
+				throw std::invalid_argument("om::net::parse_host_port: invalid argument");
+			}
+
 			std::size_t colon_pos = host_port_.find(':');
 
-			if (colon_pos != std::string::npos) {
+			if (colon_pos != std::string::npos
+				&& host_port_.find(':', colon_pos + 1) == std::string::npos) {
 				std::string host_part = host_port_.substr(0, colon_pos);
 				std::string port_part = host_port_.substr(colon_pos + 1);
 				return std::make_pair(host_part, (unsigned short) std::stoul(port_part));
@@ -340,56 +927,233 @@ namespace om {
 			explicit ip4_addr(const char* addr_) : _addr(parse(addr_)) { }
 		};
 
-		//! base class for network packet headers
-		class packet_header
+		//! a resolved transport address: an IPv4 or IPv6 address and a port
+		//!
+		//! Stores the socket address in the form the kernel expects, so sockets can send to an
+		//! endpoint without parsing or converting anything per call.
+		class endpoint
 		{
 		public:
-			packet_header() = delete;
-			explicit packet_header(std::size_t len_)
-				: _alloc(true), _buf(new unsigned char[len_]{0}), _len(len_) { }
-			explicit packet_header(const unsigned char* buf_)
-				: _buf(buf_) { }
-			packet_header(const packet_header&) = delete;
-			packet_header& operator=(const packet_header&) = delete;
-			packet_header(packet_header&&) = default;
-			packet_header& operator=(packet_header&&) = default;
+			//! constructs an unspecified endpoint (family AF_UNSPEC)
+			endpoint() = default;
 
-			//! returns the length of the packet after initial parsing, including optional fields
-			std::size_t len() const
+			endpoint(const ip4_addr& addr_, uint16_t port_)
 			{
-				return _len;
+				auto* in = (struct sockaddr_in*) &_addr;
+				in->sin_family      = AF_INET;
+				in->sin_addr.s_addr = addr_.to_uint32();
+				in->sin_port        = htons(port_);
+				_len = sizeof(struct sockaddr_in);
 			}
 
-			//! writes the packet to a byte buffer
-			inline void write(unsigned char* buf_)
+			//! copies a socket address, e.g. one returned by the kernel
+			endpoint(const struct sockaddr* addr_, socklen_t len_)
 			{
-				std::memcpy(buf_, _buf, this->len());
+				if (len_ > sizeof(_addr))
+					throw std::invalid_argument("endpoint: invalid address length");
+
+				std::memcpy(&_addr, addr_, len_);
+				_len = len_;
 			}
 
-			virtual ~packet_header()
+			//! parses a numeric IPv4 or IPv6 address, does not resolve host names
+			static endpoint from_string(const std::string& ip_, uint16_t port_)
 			{
-				if (_alloc)
-					delete[] _buf;
+				endpoint ep;
+				auto* in  = (struct sockaddr_in*) &ep._addr;
+				auto* in6 = (struct sockaddr_in6*) &ep._addr;
+
+				if (::inet_pton(AF_INET, ip_.c_str(), &in->sin_addr) == 1) {
+					in->sin_family = AF_INET;
+					in->sin_port   = htons(port_);
+					ep._len = sizeof(struct sockaddr_in);
+				} else if (::inet_pton(AF_INET6, ip_.c_str(), &in6->sin6_addr) == 1) {
+					in6->sin6_family = AF_INET6;
+					in6->sin6_port   = htons(port_);
+					ep._len = sizeof(struct sockaddr_in6);
+				} else {
+					throw std::invalid_argument("endpoint: invalid address: " + ip_);
+				}
+
+				return ep;
 			}
 
-		protected:
-			bool _alloc               = false;
-			const unsigned char* _buf = nullptr;
-			std::size_t _len          = 0;
-		};
+			//! parses "ip:port" or "[ip6]:port"
+			static endpoint parse(const std::string& host_port_)
+			{
+				auto host_port = parse_host_port(host_port_);
+				return from_string(host_port.first, host_port.second);
+			}
 
-		//! a standard Ethernet header
-		class ethernet_header : public packet_header
-		{
-		public:
+			//! resolves a host name or numeric address with getaddrinfo(), family_ may restrict the
+			//! result to AF_INET or AF_INET6
+			static endpoint resolve(const std::string& host_, uint16_t port_,
+				int family_ = AF_UNSPEC)
+			{
+				struct addrinfo hints {};
+				hints.ai_family   = family_;
+				hints.ai_socktype = SOCK_DGRAM;
 
-			//! constructs an ethernet header with all fields set to 0
-			ethernet_header()
-				: packet_header(14), _eth((ether_header*) _buf)  { }
+				struct addrinfo* result = nullptr;
+				int err = ::getaddrinfo(host_.c_str(), nullptr, &hints, &result);
 
-			//! constructs an ethernet header from a byte buffer
-			explicit ethernet_header(const unsigned char* buf_)
-				: packet_header(buf_), _eth((ether_header*) _buf)
+				if (err != 0 || result == nullptr)
+					throw std::runtime_error("endpoint: could not resolve " + host_ + ": "
+						+ ::gai_strerror(err));
+
+				endpoint ep(result->ai_addr, result->ai_addrlen);
+				::freeaddrinfo(result);
+
+				if (ep.is_ip6())
+					((struct sockaddr_in6*) &ep._addr)->sin6_port = htons(port_);
+				else
+					((struct sockaddr_in*) &ep._addr)->sin_port = htons(port_);
+
+				return ep;
+			}
+
+			//! returns AF_INET, AF_INET6 or AF_UNSPEC
+			int family() const
+			{
+				return _len == 0 ? AF_UNSPEC : _addr.ss_family;
+			}
+
+			bool is_ip4() const
+			{
+				return family() == AF_INET;
+			}
+
+			bool is_ip6() const
+			{
+				return family() == AF_INET6;
+			}
+
+			uint16_t port() const
+			{
+				if (is_ip4())
+					return ntohs(((const struct sockaddr_in*) &_addr)->sin_port);
+
+				if (is_ip6())
+					return ntohs(((const struct sockaddr_in6*) &_addr)->sin6_port);
+
+				return 0;
+			}
+
+			//! returns the IPv4 address, throws std::logic_error for other families
+			ip4_addr ip4() const
+			{
+				if (!is_ip4())
+					throw std::logic_error("endpoint: not an IPv4 address");
+
+				return ip4_addr::from_net(((const struct sockaddr_in*) &_addr)->sin_addr.s_addr);
+			}
+
+			//! returns the address without the port in numeric form
+			std::string address() const
+			{
+				char buf[INET6_ADDRSTRLEN] = { 0 };
+
+				if (is_ip4())
+					::inet_ntop(AF_INET, &((const struct sockaddr_in*) &_addr)->sin_addr, buf,
+						sizeof(buf));
+				else if (is_ip6())
+					::inet_ntop(AF_INET6, &((const struct sockaddr_in6*) &_addr)->sin6_addr, buf,
+						sizeof(buf));
+
+				return buf;
+			}
+
+			//! returns "ip:port" or "[ip6]:port"
+			std::string to_string() const
+			{
+				return is_ip6() ? "[" + address() + "]:" + std::to_string(port())
+					: address() + ":" + std::to_string(port());
+			}
+
+			//! returns the socket address for passing to the kernel
+			const struct sockaddr* data() const
+			{
+				return (const struct sockaddr*) &_addr;
+			}
+
+			//! returns the length of the socket address
+			socklen_t size() const
+			{
+				return _len;
+			}
+
+			inline bool operator==(const endpoint& rhs_) const
+			{
+				return _len == rhs_._len && std::memcmp(&_addr, &rhs_._addr, _len) == 0;
+			}
+
+			inline bool operator!=(const endpoint& rhs_) const
+			{
+				return !(*this == rhs_);
+			}
+
+			friend std::ostream& operator<<(std::ostream& os_, const endpoint& ep_)
+			{
+				return (os_ << ep_.to_string());
+			}
+
+		private:
+			friend class socket;
+
+			struct sockaddr_storage _addr {};
+			socklen_t _len = 0;
+		};
+
+		//! base class for network packet headers
+		class packet_header
+		{
+		public:
+			packet_header() = delete;
+			explicit packet_header(std::size_t len_)
+				: _alloc(true), _buf(new unsigned char[len_]{0}), _len(len_) { }
+			explicit packet_header(const unsigned char* buf_)
+				: _buf(buf_) { }
+			packet_header(const packet_header&) = delete;
+			packet_header& operator=(const packet_header&) = delete;
+			packet_header(packet_header&&) = default;
+			packet_header& operator=(packet_header&&) = default;
+
+			//! returns the length of the packet after initial parsing, including optional fields
+			std::size_t len() const
+			{
+				return _len;
+			}
+
+			//! writes the packet to a byte buffer
+			inline void write(unsigned char* buf_)
+			{
+				std::memcpy(buf_, _buf, this->len());
+			}
+
+			virtual ~packet_header()
+			{
+				if (_alloc)
+					delete[] _buf;
+			}
+
+		protected:
+			bool _alloc               = false;
+			const unsigned char* _buf = nullptr;
+			std::size_t _len          = 0;
+		};
+
+		//! a standard Ethernet header
+		class ethernet_header : public packet_header
+		{
+		public:
+
+			//! constructs an ethernet header with all fields set to 0
+			ethernet_header()
+				: packet_header(14), _eth((ether_header*) _buf)  { }
+
+			//! constructs an ethernet header from a byte buffer
+			explicit ethernet_header(const unsigned char* buf_)
+				: packet_header(buf_), _eth((ether_header*) _buf)
 			{
 				_len = 14;
 			}
@@ -810,413 +1574,7662 @@ namespace om {
 			uint8_t  _ip_proto = 0;
 		};
 
-		//! an unix internet socket
-		class socket : public sys::file_descriptor
+		//! a preallocated batch of datagrams for socket::receive_batch() and socket::send_batch()
+		//!
+		//! Buffers, addresses and the message headers passed to recvmmsg()/sendmmsg() are
+		//! allocated once and reused across calls.
+		class datagram_batch
 		{
 		public:
+#ifdef __linux__
+			using message_header = struct ::mmsghdr;
+#else
+			struct message_header { struct msghdr msg_hdr; unsigned msg_len; };
+#endif
 
-			enum class type { stream = SOCK_STREAM, dgram = SOCK_DGRAM };
+			//! space for the SO_TIMESTAMPNS and SO_RXQ_OVFL control messages of one datagram
+			static const unsigned CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec))
+				+ CMSG_SPACE(sizeof(uint32_t));
 
-			explicit socket(type type_ = type::stream)
+			explicit datagram_batch(unsigned capacity_ = 64, unsigned buffer_size_ = 2048)
+				: _capacity(capacity_), _buffer_size(buffer_size_),
+				  _data((std::size_t) capacity_ * buffer_size_), _msgs(capacity_),
+				  _iovs(capacity_), _addrs(capacity_), _control((std::size_t) capacity_ * CONTROL_SIZE),
+				  _timestamps(capacity_, 0)
 			{
-				if ((_fd = ::socket(AF_INET, (int) type_, 0)) == -1)
-					throw std::runtime_error("socket: could not open: errno: "
-							  + std::to_string(errno));
+				for (unsigned i = 0; i < _capacity; i++) {
+					_iovs[i].iov_base = _data.data() + (std::size_t) i * _buffer_size;
+					_iovs[i].iov_len  = _buffer_size;
+					_msgs[i].msg_hdr.msg_iov     = &_iovs[i];
+					_msgs[i].msg_hdr.msg_iovlen  = 1;
+					_msgs[i].msg_hdr.msg_name    = &_addrs[i];
+					_msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+				}
 			}
 
-			void bind(const std::string& ip_addr_, unsigned short port_ = 0)
-			{
-				struct sockaddr_in in_addr {};
-				in_addr.sin_family = AF_INET;
-				in_addr.sin_addr.s_addr = htonl(inet_addr(ip_addr_.c_str()));
-				in_addr.sin_port = htons(port_);
+			datagram_batch(const datagram_batch&) = delete;
+			datagram_batch& operator=(const datagram_batch&) = delete;
 
-				if (::bind(_fd, (struct sockaddr*) &in_addr, sizeof(in_addr)))
-					throw std::runtime_error("socket: could not bind: errno: "
-							  + std::to_string(errno));
+			//! returns the maximum number of datagrams in the batch
+			unsigned capacity() const
+			{
+				return _capacity;
 			}
 
-			unsigned send_to(const std::string& ip_dst_, unsigned short tp_dst_,
-							 const unsigned char* buf_, unsigned len_, int flags_ = 0)
+			//! returns the size of each datagram buffer
+			unsigned buffer_size() const
 			{
-				struct sockaddr_in dest {};
-				dest.sin_family = AF_INET;
-				dest.sin_port = htons(tp_dst_);
-				dest.sin_addr.s_addr = inet_addr(ip_dst_.c_str());
-
-				ssize_t len = ::sendto(_fd, buf_, len_, flags_, (const sockaddr*) &dest,
-					sizeof(dest));
-
-				if (len == -1)
-					throw std::runtime_error("socket: could not send: errno: "
-							  + std::to_string(errno));
-
-				return (unsigned) len;
+				return _buffer_size;
 			}
 
-
-			unsigned receive(unsigned char* buffer_, unsigned len_, int flags_ = 0)
+			//! returns the number of datagrams in the batch
+			unsigned size() const
 			{
-				ssize_t len = ::recv(_fd, buffer_, len_, flags_);
-
-				if (len == -1)
-					throw std::runtime_error("socket: could not receive: errno: "
-											 + std::to_string(errno));
-
-				return (unsigned) len;
+				return _size;
 			}
 
-            unsigned receive_from(unsigned char* buffer_, unsigned len_, om::net::ip4_addr& ip,
-                                  std::uint16_t& port, int flags_ = 0)
-            {
-                struct sockaddr_storage from {};
-                socklen_t from_len = sizeof(from);
-
-                std::size_t rx_len = ::recvfrom(_fd, buffer_, len_, flags_,
-                                                (struct sockaddr*) &from, &from_len);
-
-                if (from.ss_family == AF_INET) {
-                    auto* from_in = (struct sockaddr_in*) &from;
-                    ip = om::net::ip4_addr::from_net(from_in->sin_addr.s_addr);
-                    port = ntohs(from_in->sin_port);
-                } else {
-                    return 0;
-                }
-
-                if (rx_len == -1)
-                    throw std::runtime_error("socket: could not receive: errno: "
-                                             + std::to_string(errno));
-
-                return (unsigned) rx_len;
-            }
+			bool empty() const
+			{
+				return _size == 0;
+			}
 
-			bool is_open()
+			bool full() const
 			{
-				return _fd != -1;
+				return _size == _capacity;
 			}
 
-			void close()
+			//! returns the buffer of datagram i_
+			unsigned char* data(unsigned i_)
 			{
-				::close(_fd);
-				_fd = -1;
+				return _data.data() + (std::size_t) i_ * _buffer_size;
 			}
 
-			~socket()
+			const unsigned char* data(unsigned i_) const
 			{
-				if (_fd > 0) close();
+				return _data.data() + (std::size_t) i_ * _buffer_size;
 			}
-		};
-	}
 
-	namespace async {
+			//! returns the length of datagram i_
+			unsigned len(unsigned i_) const
+			{
+				return _msgs[i_].msg_len;
+			}
 
-		//! a wrapper around the poll() system call
-		class poll
-		{
-		public:
-			enum class event : short { in = POLLIN, out = POLLOUT };
+			//! returns the source (after receiving) or destination address of IPv4 datagram i_,
+			//! 0.0.0.0 for other families, see peer()
+			ip4_addr addr(unsigned i_) const
+			{
+				if (_addrs[i_].ss_family != AF_INET)
+					return ip4_addr();
 
-			using callback_t = std::function<void (int, event)>;
+				return ip4_addr::from_net(((const struct sockaddr_in*) &_addrs[i_])->sin_addr.s_addr);
+			}
 
-			poll() = default;
+			//! returns the source (after receiving) or destination port of datagram i_
+			uint16_t port(unsigned i_) const
+			{
+				return peer(i_).port();
+			}
 
-			explicit poll(sys::file_descriptor fd_, callback_t cb_, event events_ = event::in)
+			//! returns the kernel receive timestamp of datagram i_ in nanoseconds since the epoch,
+			//! or 0 if the receiving socket does not have timestamps enabled
+			uint64_t timestamp(unsigned i_) const
 			{
-				add_fd(fd_, std::move(cb_), events_);
+				return _timestamps_valid ? _timestamps[i_] : 0;
 			}
 
-			explicit poll(int fd_, callback_t cb_, event events_ = event::in)
+			//! returns the source (after receiving) or destination endpoint of datagram i_
+			net::endpoint peer(unsigned i_) const
 			{
-				add_fd(fd_, std::move(cb_), events_);
+				return net::endpoint((const struct sockaddr*) &_addrs[i_],
+					_msgs[i_].msg_hdr.msg_namelen);
 			}
 
-			void add_fd(sys::file_descriptor fd_, callback_t cb_, event events_ = event::in)
+			//! copies a datagram into the batch, returns false if the batch is full or len_ exceeds
+			//! the buffer size
+			bool push(const unsigned char* buf_, unsigned len_, const ip4_addr& ip_dst_,
+				uint16_t tp_dst_)
 			{
-				_fds[_count_fds++] = {
-					.fd = fd_.fd(), .events = static_cast<short>((short) events_), .revents = 0
-				};
+				if (full() || len_ > _buffer_size)
+					return false;
 
-				_callbacks[fd_.fd()] = std::move(cb_);
+				std::memcpy(data(_size), buf_, len_);
+				_msgs[_size].msg_len = len_;
+
+				auto* dst = (struct sockaddr_in*) &_addrs[_size];
+				*dst = {};
+				dst->sin_family      = AF_INET;
+				dst->sin_addr.s_addr = ip_dst_.to_uint32();
+				dst->sin_port        = htons(tp_dst_);
+				_msgs[_size].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+				_size++;
+				return true;
 			}
 
-			void add_fd(int fd_, callback_t cb_, event events_ = event::in)
+			//! copies a datagram addressed to dst_ into the batch
+			bool push(const unsigned char* buf_, unsigned len_, const net::endpoint& dst_)
 			{
-				_fds[_count_fds++] = {
-					.fd = fd_, .events = static_cast<short>((short) events_), .revents = 0
-				};
+				if (full() || len_ > _buffer_size)
+					return false;
 
-				_callbacks[fd_] = std::move(cb_);
+				std::memcpy(data(_size), buf_, len_);
+				_msgs[_size].msg_len = len_;
+				std::memcpy(&_addrs[_size], dst_.data(), dst_.size());
+				_msgs[_size].msg_hdr.msg_namelen = dst_.size();
+
+				_size++;
+				return true;
 			}
 
-			void block()
+			//! copies a datagram without an address into the batch, for connected sockets
+			bool push(const unsigned char* buf_, unsigned len_)
 			{
-				for (int r = 0; !_stop && r >= 0; r = ::poll(_fds, _count_fds, 1000)) {
-					if (r > 0) {
-						for (unsigned i = 0; i < _count_fds; i++) {
+				if (full() || len_ > _buffer_size)
+					return false;
 
-							if (_fds[i].revents & POLLOUT)
-								_callbacks[_fds->fd](_fds[i].fd, event::out);
+				std::memcpy(data(_size), buf_, len_);
+				_msgs[_size].msg_len = len_;
+				_msgs[_size].msg_hdr.msg_namelen = 0;
 
-							if (_fds[i].revents & POLLIN)
-								_callbacks[_fds->fd](_fds[i].fd, event::in);
-						}
-					} else { continue; }
-				}
+				_size++;
+				return true;
 			}
 
-			void stop()
+			//! removes all datagrams from the batch
+			void clear()
 			{
-				_stop = true;
+				_size = 0;
 			}
 
 		private:
-			bool _stop = false;
-			static const unsigned _FDS_PREALLOC = 8;
-			std::map<int, std::function<void (int, event)>> _callbacks = {};
-			unsigned _count_fds = 0;
-			struct pollfd _fds[_FDS_PREALLOC] = {};
-		};
+			friend class socket;
+
+			unsigned _capacity;
+			unsigned _buffer_size;
+			unsigned _size = 0;
+			std::vector<unsigned char> _data;
+			std::vector<message_header> _msgs;
+			std::vector<struct iovec> _iovs;
+			std::vector<struct sockaddr_storage> _addrs;
+			std::vector<char> _control;
+			std::vector<uint64_t> _timestamps;
+			bool _timestamps_valid = false;
+
+			//! prepares the message headers for receiving into all buffers, with room for control
+			//! messages if control_ is set
+			void _prepare_receive(bool control_)
+			{
+				for (unsigned i = 0; i < _capacity; i++) {
+					_iovs[i].iov_len = _buffer_size;
+					_msgs[i].msg_hdr.msg_namelen    = sizeof(struct sockaddr_storage);
+					_msgs[i].msg_hdr.msg_control    = control_ ? &_control[i * CONTROL_SIZE] : nullptr;
+					_msgs[i].msg_hdr.msg_controllen = control_ ? (std::size_t) CONTROL_SIZE : 0;
+					_msgs[i].msg_len = 0;
+				}
 
-		inline short operator&(const poll::event& lhs_, const poll::event& rhs_)
-		{
-			return ((short) lhs_ & (short) rhs_);
-		}
-	}
+				_size = 0;
+				_timestamps_valid = false;
+			}
 
-	namespace file {
+			//! prepares the message headers for sending the first size() datagrams
+			void _prepare_send()
+			{
+				for (unsigned i = 0; i < _size; i++) {
+					_iovs[i].iov_len = _msgs[i].msg_len;
+					_msgs[i].msg_hdr.msg_control    = nullptr;
+					_msgs[i].msg_hdr.msg_controllen = 0;
+				}
+			}
+		};
 
-		inline unsigned long size(const std::string& file_name_)
+		//! an unix internet socket
+		class socket : public sys::file_descriptor
 		{
-			struct stat st {};
-
-			if (stat(file_name_.c_str(), &st) < 0)
-				throw std::runtime_error("size: could not determine file size: errno: "
-										 + std::to_string(errno));
+		public:
 
-			return (unsigned long)(st.st_size);
-		}
+			enum class type { stream = SOCK_STREAM, dgram = SOCK_DGRAM };
 
-		class _file_stream
-		{
-		public:
-			//! opens a file in the specified openmode, throws std::runtime_error upon error
-			explicit _file_stream(const std::string& file_name_, std::ios::openmode open_mode_)
-				: _stream(file_name_, open_mode_)
+			//! receive counters, see statistics()
+			struct stats
 			{
-				if (!_stream.is_open())
-					throw std::runtime_error("om::file::_file_stream: could not open " +file_name_);
+				uint64_t datagrams = 0; //!< datagrams (or stream reads) received
+				uint64_t bytes     = 0; //!< bytes received
+				uint64_t truncated = 0; //!< datagrams cut to the buffer size (needs recvmsg paths)
+				uint64_t drops     = 0; //!< datagrams the kernel dropped because the receive queue
+				                        //!< was full, needs enable_drop_counter()
+			};
+
+			//! opens a socket of family_ AF_INET or AF_INET6
+			explicit socket(type type_ = type::stream, int family_ = AF_INET)
+			{
+				if ((_fd = ::socket(family_, (int) type_, 0)) == -1)
+					throw std::runtime_error("socket: could not open: errno: "
+							  + std::to_string(errno));
 			}
 
-			//! closes the underlying file
-			virtual void close()
+			void bind(const std::string& ip_addr_, unsigned short port_ = 0)
 			{
-				_stream.close();
+				bind(endpoint::from_string(ip_addr_, port_));
 			}
 
-			//! closes the underlying file if it is open
-			virtual ~_file_stream()
+			void bind(const endpoint& local_)
 			{
-				if (_stream.is_open())
-					_stream.close();
+				if (::bind(_fd, local_.data(), local_.size()))
+					throw std::runtime_error("socket: could not bind: errno: "
+							  + std::to_string(errno));
 			}
 
-		protected:
+			//! sets the default destination and restricts receiving to datagrams from peer_
+			//!
+			//! A connected datagram socket can use send(), which skips the per-call address
+			//! lookup and routing of send_to().
+			void connect(const endpoint& peer_)
+			{
+				if (::connect(_fd, peer_.data(), peer_.size()))
+					throw std::runtime_error("socket: could not connect: errno: "
+							  + std::to_string(errno));
+			}
 
-			//! returns true if the file pointer was advanced beyond the end of the file
-			bool _eof()
+			//! returns the local address, useful after binding to port 0
+			endpoint local_endpoint() const
 			{
-				return _stream.tellg() == std::istream::pos_type(-1);
+				endpoint ep;
+				ep._len = sizeof(ep._addr);
+
+				if (::getsockname(_fd, (struct sockaddr*) &ep._addr, &ep._len))
+					throw std::runtime_error("socket: could not get local address: errno: "
+							  + std::to_string(errno));
+
+				return ep;
 			}
 
-			//! sets the read cursor to the beginning of the file
-			void _reset()
+			//! enables or disables non-blocking mode
+			void set_nonblocking(bool nonblocking_ = true)
 			{
-				_stream.clear();
-				_stream.seekg(0, std::ios::beg);
+				sys::set_nonblocking(_fd, nonblocking_);
 			}
 
-			std::fstream _stream;
-		};
+			//! lets the kernel timestamp every received datagram (SO_TIMESTAMPNS)
+			//!
+			//! The timestamps are taken when the packet enters the network stack and are returned
+			//! by the receive_from() overload with a timestamp and by datagram_batch::timestamp().
+			void enable_timestamps(bool enable_ = true)
+			{
+				_set_rx_option(SO_TIMESTAMPNS, RX_TIMESTAMPS, enable_);
+			}
+
+			//! lets the kernel report the number of datagrams dropped on this socket because its
+			//! receive queue was full (SO_RXQ_OVFL)
+			//!
+			//! The count arrives with each received datagram, so stats::drops is only updated
+			//! when the next datagram is received after a drop.
+			void enable_drop_counter(bool enable_ = true)
+			{
+#ifdef SO_RXQ_OVFL
+				_set_rx_option(SO_RXQ_OVFL, RX_DROPS, enable_);
+#else
+				throw std::runtime_error("socket: SO_RXQ_OVFL not supported");
+#endif
+			}
+
+			//! returns the receive counters of this socket
+			const stats& statistics() const
+			{
+				return _stats;
+			}
+
+			unsigned send_to(const std::string& ip_dst_, unsigned short tp_dst_,
+							 const unsigned char* buf_, unsigned len_, int flags_ = 0)
+			{
+				return send_to(endpoint::from_string(ip_dst_, tp_dst_), buf_, len_, flags_);
+			}
+
+			unsigned send_to(const endpoint& dst_, const unsigned char* buf_, unsigned len_,
+							 int flags_ = 0)
+			{
+				ssize_t len = ::sendto(_fd, buf_, len_, flags_, dst_.data(), dst_.size());
+
+				if (len == -1)
+					throw std::runtime_error("socket: could not send: errno: "
+							  + std::to_string(errno));
+
+				return (unsigned) len;
+			}
+
+			//! sends to the peer of a connected socket
+			unsigned send(const unsigned char* buf_, unsigned len_, int flags_ = 0)
+			{
+				ssize_t len = ::send(_fd, buf_, len_, flags_);
+
+				if (len == -1)
+					throw std::runtime_error("socket: could not send: errno: "
+							  + std::to_string(errno));
+
+				return (unsigned) len;
+			}
+
+
+			unsigned receive(unsigned char* buffer_, unsigned len_, int flags_ = 0)
+			{
+				ssize_t len = ::recv(_fd, buffer_, len_, flags_);
+
+				if (len == -1)
+					throw std::runtime_error("socket: could not receive: errno: "
+											 + std::to_string(errno));
+
+				_stats.datagrams++;
+				_stats.bytes += (uint64_t) len;
+				return (unsigned) len;
+			}
+
+			//! receives up to batch_.capacity() datagrams with a single recvmmsg() call
+			//!
+			//! Returns the number of datagrams received, 0 if the socket is non-blocking (or
+			//! MSG_DONTWAIT is passed) and no datagram is available.
+			unsigned receive_batch(datagram_batch& batch_, int flags_ = 0)
+			{
+				batch_._prepare_receive(_rx_options != 0);
+#ifdef __linux__
+				int r = ::recvmmsg(_fd, batch_._msgs.data(), batch_._capacity,
+					flags_ | MSG_WAITFORONE, nullptr);
+
+				if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					return 0;
+
+				if (r == -1)
+					throw std::runtime_error("socket: could not receive: errno: "
+											 + std::to_string(errno));
+
+				batch_._size = (unsigned) r;
+#else
+				for (unsigned i = 0; i < batch_._capacity; i++) {
+					ssize_t r = ::recvmsg(_fd, &batch_._msgs[i].msg_hdr,
+						i == 0 ? flags_ : flags_ | MSG_DONTWAIT);
+
+					if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+						break;
+
+					if (r == -1)
+						throw std::runtime_error("socket: could not receive: errno: "
+												 + std::to_string(errno));
+
+					batch_._msgs[i].msg_len = (unsigned) r;
+					batch_._size++;
+				}
+#endif
+				for (unsigned i = 0; i < batch_._size; i++) {
+					const struct msghdr& hdr = batch_._msgs[i].msg_hdr;
+					_stats.bytes += batch_._msgs[i].msg_len;
+					_stats.truncated += (hdr.msg_flags & MSG_TRUNC) != 0;
+
+					if (_rx_options)
+						batch_._timestamps[i] = _parse_control(hdr);
+				}
+
+				_stats.datagrams += batch_._size;
+				batch_._timestamps_valid = (_rx_options & RX_TIMESTAMPS) != 0;
+				return batch_._size;
+			}
+
+			//! sends all datagrams in batch_ with as few sendmmsg() calls as possible
+			//!
+			//! Returns the number of datagrams sent, which is less than batch_.size() only if the
+			//! socket is non-blocking and its send buffer is full.
+			unsigned send_batch(datagram_batch& batch_, int flags_ = 0)
+			{
+				batch_._prepare_send();
+				unsigned sent = 0;
+
+				while (sent < batch_._size) {
+#ifdef __linux__
+					int r = ::sendmmsg(_fd, batch_._msgs.data() + sent, batch_._size - sent, flags_);
+#else
+					int r = ::sendmsg(_fd, &batch_._msgs[sent].msg_hdr, flags_) == -1 ? -1 : 1;
+#endif
+					if (r == -1 && errno == EINTR)
+						continue;
+
+					if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+						break;
+
+					if (r == -1)
+						throw std::runtime_error("socket: could not send: errno: "
+								  + std::to_string(errno));
+
+					sent += (unsigned) r;
+				}
+
+				return sent;
+			}
+
+			//! sends len_ bytes as consecutive datagrams of segment_size_ bytes (the last one may be
+			//! shorter) using UDP generic segmentation offload
+			//!
+			//! Each call hands up to 64 segments to the kernel at once. Falls back to one send per
+			//! segment if the kernel or the outgoing device does not support UDP_SEGMENT. Returns
+			//! the number of bytes sent.
+			unsigned send_segmented(const ip4_addr& ip_dst_, unsigned short tp_dst_,
+				const unsigned char* buf_, unsigned len_, uint16_t segment_size_, int flags_ = 0)
+			{
+				return send_segmented(endpoint(ip_dst_, tp_dst_), buf_, len_, segment_size_, flags_);
+			}
+
+			unsigned send_segmented(const endpoint& dst_, const unsigned char* buf_, unsigned len_,
+				uint16_t segment_size_, int flags_ = 0)
+			{
+				if (segment_size_ == 0)
+					throw std::invalid_argument("socket: invalid segment size");
+
+				const unsigned max_segments = std::min(64u, 65000u / segment_size_);
+				unsigned sent = 0;
+
+				while (sent < len_) {
+					unsigned chunk = std::min(len_ - sent, std::max(1u, max_segments) * segment_size_);
+
+					if (chunk > segment_size_ && gso_supported()) {
+						ssize_t r = _send_gso(dst_, buf_ + sent, chunk, segment_size_, flags_);
+
+						if (r >= 0) {
+							sent += (unsigned) r;
+							continue;
+						}
+
+						if (errno != EIO && errno != EINVAL && errno != EOPNOTSUPP)
+							throw std::runtime_error("socket: could not send: errno: "
+								+ std::to_string(errno));
+
+						_gso = 0; // the outgoing device cannot segment, fall back
+					}
+
+					for (unsigned end = sent + chunk; sent < end; ) {
+						unsigned seg = std::min<unsigned>(segment_size_, end - sent);
+						ssize_t r = ::sendto(_fd, buf_ + sent, seg, flags_, dst_.data(),
+							dst_.size());
+
+						if (r == -1)
+							throw std::runtime_error("socket: could not send: errno: "
+								+ std::to_string(errno));
+
+						sent += seg;
+					}
+				}
+
+				return sent;
+			}
+
+			//! returns true if send_segmented() uses UDP generic segmentation offload
+			bool gso_supported()
+			{
+#ifdef UDP_SEGMENT
+				if (_gso == -1) {
+					int val = 0;
+					socklen_t len = sizeof(val);
+					_gso = ::getsockopt(_fd, SOL_UDP, UDP_SEGMENT, &val, &len) == 0 ? 1 : 0;
+				}
+
+				return _gso == 1;
+#else
+				return false;
+#endif
+			}
+
+			//! lets the kernel coalesce received datagrams, returns false if not supported
+			//!
+			//! Without UDP_GRO receive_coalesced() returns one datagram at a time.
+			bool enable_gro(bool enable_ = true)
+			{
+#ifdef UDP_GRO
+				int val = enable_ ? 1 : 0;
+				return ::setsockopt(_fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) == 0;
+#else
+				return false;
+#endif
+			}
+
+			//! receives a buffer of one or more coalesced datagrams from the same source
+			//!
+			//! segment_size_ is set to the size of each datagram in the buffer except the last one,
+			//! which may be shorter. Datagrams are at offsets 0, segment_size_, 2 * segment_size_,
+			//! ... The buffer should be able to hold 64 KiB. Returns the number of bytes received.
+			//! A zero-length datagram returns 0 with segment_size_ 0, callers dividing by
+			//! segment_size_ must check for it.
+			unsigned receive_coalesced(unsigned char* buffer_, unsigned len_, uint16_t& segment_size_,
+				endpoint& from_, int flags_ = 0)
+			{
+				struct iovec iov { buffer_, len_ };
+				// UDP_GRO comes after the SOL_SOCKET messages of enable_timestamps() and
+				// enable_drop_counter()
+				char control[datagram_batch::CONTROL_SIZE + CMSG_SPACE(sizeof(int))] = { };
+
+				struct msghdr msg {};
+				msg.msg_name       = &from_._addr;
+				msg.msg_namelen    = sizeof(from_._addr);
+				msg.msg_iov        = &iov;
+				msg.msg_iovlen     = 1;
+				msg.msg_control    = control;
+				msg.msg_controllen = sizeof(control);
+
+				ssize_t rx_len = ::recvmsg(_fd, &msg, flags_);
+
+				if (rx_len == -1)
+					throw std::runtime_error("socket: could not receive: errno: "
+											 + std::to_string(errno));
+
+				from_._len = msg.msg_namelen;
+
+				int gro_size = 0;
+				_parse_control(msg, &gro_size);
+				segment_size_ = (uint16_t) (gro_size > 0 ? gro_size : rx_len);
+
+				_stats.datagrams += segment_size_ > 0 ? (rx_len + segment_size_ - 1) / segment_size_ : 1;
+				_stats.bytes     += (uint64_t) rx_len;
+				_stats.truncated += (msg.msg_flags & MSG_TRUNC) != 0;
+				return (unsigned) rx_len;
+			}
+
+			//! receive_coalesced() for IPv4 sockets, ip_ is 0.0.0.0 for other families
+			unsigned receive_coalesced(unsigned char* buffer_, unsigned len_, uint16_t& segment_size_,
+				ip4_addr& ip_, uint16_t& port_, int flags_ = 0)
+			{
+				endpoint from;
+				unsigned rx_len = receive_coalesced(buffer_, len_, segment_size_, from, flags_);
+
+				ip_   = from.is_ip4() ? from.ip4() : ip4_addr();
+				port_ = from.port();
+				return rx_len;
+			}
+
+            unsigned receive_from(unsigned char* buffer_, unsigned len_, om::net::ip4_addr& ip,
+                                  std::uint16_t& port, int flags_ = 0)
+            {
+                endpoint from;
+                unsigned rx_len = receive_from(buffer_, len_, from, flags_);
+
+                if (!from.is_ip4())
+                    return 0;
+
+                ip = from.ip4();
+                port = from.port();
+                return rx_len;
+            }
+
+			//! receives one datagram and sets from_ to its source
+			unsigned receive_from(unsigned char* buffer_, unsigned len_, endpoint& from_,
+								  int flags_ = 0)
+			{
+				uint64_t timestamp = 0;
+				return receive_from(buffer_, len_, from_, timestamp, flags_);
+			}
+
+			//! receives one datagram, sets from_ to its source and timestamp_ to the kernel
+			//! receive time in nanoseconds since the epoch (0 unless enable_timestamps() was called)
+			unsigned receive_from(unsigned char* buffer_, unsigned len_, endpoint& from_,
+								  uint64_t& timestamp_, int flags_ = 0)
+			{
+				from_._len = sizeof(from_._addr);
+				timestamp_ = 0;
+				ssize_t rx_len;
+
+				if (_rx_options == 0) {
+					rx_len = ::recvfrom(_fd, buffer_, len_, flags_,
+										(struct sockaddr*) &from_._addr, &from_._len);
+				} else {
+					char control[datagram_batch::CONTROL_SIZE];
+					struct iovec iov { buffer_, len_ };
+
+					struct msghdr msg {};
+					msg.msg_name       = &from_._addr;
+					msg.msg_namelen    = from_._len;
+					msg.msg_iov        = &iov;
+					msg.msg_iovlen     = 1;
+					msg.msg_control    = control;
+					msg.msg_controllen = sizeof(control);
+
+					if ((rx_len = ::recvmsg(_fd, &msg, flags_)) != -1) {
+						from_._len = msg.msg_namelen;
+						timestamp_ = _parse_control(msg);
+						_stats.truncated += (msg.msg_flags & MSG_TRUNC) != 0;
+					}
+				}
+
+				if (rx_len == -1)
+					throw std::runtime_error("socket: could not receive: errno: "
+											 + std::to_string(errno));
+
+				_stats.datagrams++;
+				_stats.bytes += (uint64_t) rx_len;
+				return (unsigned) rx_len;
+			}
+
+			bool is_open()
+			{
+				return _fd != -1;
+			}
+
+			void close()
+			{
+				::close(_fd);
+				_fd = -1;
+			}
+
+			~socket()
+			{
+				if (_fd > 0) close();
+			}
+
+		private:
+			static const int RX_TIMESTAMPS = 1;
+			static const int RX_DROPS      = 2;
+
+			int _gso = -1; // UDP_SEGMENT support, -1 if not probed yet
+			int _rx_options = 0;
+			stats _stats;
+
+			void _set_rx_option(int option_, int bit_, bool enable_)
+			{
+				int val = enable_ ? 1 : 0;
+
+				if (::setsockopt(_fd, SOL_SOCKET, option_, &val, sizeof(val)))
+					throw std::runtime_error("socket: could not set receive option: errno: "
+						+ std::to_string(errno));
+
+				_rx_options = enable_ ? _rx_options | bit_ : _rx_options & ~bit_;
+			}
+
+			//! reads the control messages of a received datagram, returns its timestamp and sets
+			//! *gro_size_ to the UDP_GRO segment size if there is one
+			uint64_t _parse_control(const struct msghdr& msg_, int* gro_size_ = nullptr)
+			{
+				uint64_t timestamp = 0;
+
+				for (auto* c = CMSG_FIRSTHDR(&msg_); c; c = CMSG_NXTHDR((struct msghdr*) &msg_, c)) {
+#ifdef UDP_GRO
+					if (gro_size_ && c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO)
+						std::memcpy(gro_size_, CMSG_DATA(c), sizeof(*gro_size_));
+#endif
+					if (c->cmsg_level != SOL_SOCKET)
+						continue;
+
+					if (c->cmsg_type == SCM_TIMESTAMPNS) {
+						struct timespec ts;
+						std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+						timestamp = (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+					}
+#ifdef SO_RXQ_OVFL
+					else if (c->cmsg_type == SO_RXQ_OVFL) {
+						uint32_t drops;
+						std::memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+						_stats.drops = drops;
+					}
+#endif
+				}
+
+				return timestamp;
+			}
+
+			ssize_t _send_gso(const endpoint& dest_, const unsigned char* buf_,
+				unsigned len_, uint16_t segment_size_, int flags_)
+			{
+#ifdef UDP_SEGMENT
+				struct iovec iov { (void*) buf_, len_ };
+				char control[CMSG_SPACE(sizeof(uint16_t))] = { };
+
+				struct msghdr msg {};
+				msg.msg_name       = (void*) dest_.data();
+				msg.msg_namelen    = dest_.size();
+				msg.msg_iov        = &iov;
+				msg.msg_iovlen     = 1;
+				msg.msg_control    = control;
+				msg.msg_controllen = sizeof(control);
+
+				struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+				c->cmsg_level = SOL_UDP;
+				c->cmsg_type  = UDP_SEGMENT;
+				c->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+				std::memcpy(CMSG_DATA(c), &segment_size_, sizeof(segment_size_));
+
+				return ::sendmsg(_fd, &msg, flags_);
+#else
+				errno = EOPNOTSUPP;
+				return -1;
+#endif
+			}
+		};
+
+		//! a non-blocking tcp connection
+		//!
+		//! All I/O operations return a sys::io_result instead of throwing, so that a connection can
+		//! be drained until would_block() from an edge-triggered event loop.
+		class tcp_stream : public sys::file_descriptor
+		{
+		public:
+			tcp_stream() = default;
+
+			//! takes ownership of a connected socket and makes it non-blocking
+			explicit tcp_stream(int fd_)
+			{
+				_fd = fd_;
+
+				try {
+					sys::set_nonblocking(_fd);
+				} catch (...) {
+					close();
+					throw;
+				}
+			}
+
+			tcp_stream(const tcp_stream&) = delete;
+			tcp_stream& operator=(const tcp_stream&) = delete;
+
+			tcp_stream(tcp_stream&& other_) noexcept
+			{
+				std::swap(_fd, other_._fd);
+			}
+
+			tcp_stream& operator=(tcp_stream&& other_) noexcept
+			{
+				std::swap(_fd, other_._fd);
+				return *this;
+			}
+
+			//! starts connecting to ip_dst_:tp_dst_, the result is ok() or in_progress() on success
+			//!
+			//! Once the socket becomes writable, finish_connect() reports the outcome.
+			sys::io_result connect(const ip4_addr& ip_dst_, uint16_t tp_dst_)
+			{
+				return connect(endpoint(ip_dst_, tp_dst_));
+			}
+
+			sys::io_result connect(const endpoint& dst_)
+			{
+				close();
+
+				if ((_fd = _socket(dst_.family())) == -1)
+					return sys::io_result(0, errno);
+
+				return sys::io_result::from(::connect(_fd, dst_.data(), dst_.size()));
+			}
+
+			//! returns the outcome of a connection attempt after the socket became writable
+			sys::io_result finish_connect()
+			{
+				int err = 0;
+				socklen_t len = sizeof(err);
+
+				if (::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+					err = errno;
+
+				return sys::io_result(0, err);
+			}
+
+			sys::io_result read(unsigned char* buf_, std::size_t len_)
+			{
+				return sys::io_result::from_read(::recv(_fd, buf_, len_, 0));
+			}
+
+			sys::io_result write(const unsigned char* buf_, std::size_t len_)
+			{
+				return sys::io_result::from(::send(_fd, buf_, len_, MSG_NOSIGNAL));
+			}
+
+			//! scatter read into count_ buffers
+			sys::io_result readv(const struct iovec* iov_, int count_)
+			{
+				return sys::io_result::from_read(::readv(_fd, iov_, count_));
+			}
+
+			//! gather write from count_ buffers
+			sys::io_result writev(const struct iovec* iov_, int count_)
+			{
+				struct msghdr msg {};
+				msg.msg_iov    = (struct iovec*) iov_;
+				msg.msg_iovlen = (decltype(msg.msg_iovlen)) count_;
+				return sys::io_result::from(::sendmsg(_fd, &msg, MSG_NOSIGNAL));
+			}
+
+			//! disables Nagle's algorithm
+			void set_nodelay(bool nodelay_ = true)
+			{
+				int val = nodelay_ ? 1 : 0;
+				::setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+			}
+
+			//! closes the sending direction of the connection
+			sys::io_result shutdown_write()
+			{
+				return sys::io_result::from(::shutdown(_fd, SHUT_WR));
+			}
+
+			bool is_open() const
+			{
+				return _fd != -1;
+			}
+
+			void close()
+			{
+				if (_fd != -1) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+
+			~tcp_stream()
+			{
+				close();
+			}
+
+		private:
+			friend class tcp_listener;
+
+			void _adopt(int fd_)
+			{
+				close();
+				_fd = fd_;
+			}
+
+			static int _socket(int family_)
+			{
+#ifdef __linux__
+				return ::socket(family_, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+#else
+				int fd = ::socket(family_, SOCK_STREAM, 0);
+
+				if (fd != -1) {
+					int one = 1;
+					::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+					sys::set_nonblocking(fd);
+				}
+
+				return fd;
+#endif
+			}
+		};
+
+		//! a non-blocking tcp listening socket
+		class tcp_listener : public sys::file_descriptor
+		{
+		public:
+			//! binds to ip_addr_:port_ (port 0 picks an ephemeral port) and starts listening
+			explicit tcp_listener(const ip4_addr& ip_addr_, uint16_t port_ = 0,
+				int backlog_ = SOMAXCONN)
+				: tcp_listener(endpoint(ip_addr_, port_), backlog_) { }
+
+			explicit tcp_listener(const endpoint& local_, int backlog_ = SOMAXCONN)
+			{
+				if ((_fd = ::socket(local_.family(), SOCK_STREAM, 0)) == -1)
+					throw std::runtime_error("tcp_listener: could not open: errno: "
+						+ std::to_string(errno));
+
+				int one = 1;
+				::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+				if (::bind(_fd, local_.data(), local_.size()) || ::listen(_fd, backlog_)) {
+					int err = errno;
+					close();
+					throw std::runtime_error("tcp_listener: could not listen: errno: "
+						+ std::to_string(err));
+				}
+
+				sys::set_nonblocking(_fd);
+			}
+
+			tcp_listener(const tcp_listener&) = delete;
+			tcp_listener& operator=(const tcp_listener&) = delete;
+
+			//! returns the local port, useful after binding to port 0
+			uint16_t port() const
+			{
+				struct sockaddr_storage addr {};
+				socklen_t len = sizeof(addr);
+				::getsockname(_fd, (struct sockaddr*) &addr, &len);
+				return endpoint((struct sockaddr*) &addr, len).port();
+			}
+
+			//! accepts one pending connection as a non-blocking stream
+			sys::io_result accept(tcp_stream& stream_)
+			{
+				int fd = _accept();
+
+				if (fd == -1)
+					return sys::io_result(0, errno);
+
+				stream_ = tcp_stream();
+				stream_._adopt(fd);
+				return sys::io_result(1, 0);
+			}
+
+			//! accepts up to max_ pending connections and appends them to streams_
+			//!
+			//! value() of the result is the number of accepted connections, error() the condition
+			//! that ended the batch (EAGAIN once the backlog is drained).
+			sys::io_result accept_batch(std::vector<tcp_stream>& streams_, unsigned max_ = 64)
+			{
+				unsigned count = 0;
+
+				while (count < max_) {
+					int fd = _accept();
+
+					if (fd == -1) {
+						if (errno == EINTR || errno == ECONNABORTED)
+							continue;
+
+						return sys::io_result(count, errno);
+					}
+
+					streams_.emplace_back();
+					streams_.back()._adopt(fd);
+					count++;
+				}
+
+				return sys::io_result(count, 0);
+			}
+
+			void close()
+			{
+				if (_fd != -1) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+
+			~tcp_listener()
+			{
+				close();
+			}
+
+		private:
+			int _accept()
+			{
+#ifdef __linux__
+				return ::accept4(_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+				int fd = ::accept(_fd, nullptr, nullptr);
+
+				if (fd != -1) {
+					int one = 1;
+					::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+					sys::set_nonblocking(fd);
+				}
+
+				return fd;
+#endif
+			}
+		};
+
+#ifdef __linux__
+		//! a pool of send buffers for MSG_ZEROCOPY sends on a socket
+		//!
+		//! With MSG_ZEROCOPY the kernel transmits directly from user memory, so a buffer must not
+		//! be modified until the kernel reports completion on the socket's error queue. Buffers
+		//! are taken from the pool with acquire() and return to it once their send completed.
+		//! Sends smaller than the threshold are copied, since pinning pages costs more than
+		//! copying them. If the socket does not support SO_ZEROCOPY, all sends are copied.
+		class zerocopy_sender
+		{
+		public:
+			struct stats
+			{
+				uint64_t zerocopy_sends = 0; //!< sends passed with MSG_ZEROCOPY
+				uint64_t copied_sends   = 0; //!< sends below the threshold or without support
+				uint64_t completions    = 0; //!< zerocopy sends completed by the kernel
+				uint64_t kernel_copied  = 0; //!< zerocopy sends the kernel copied anyway
+			};
+
+			//! enables SO_ZEROCOPY on socket_ and allocates buffer_count_ buffers
+			explicit zerocopy_sender(const sys::file_descriptor& socket_, unsigned buffer_count_ = 64,
+				unsigned buffer_size_ = 1 << 16, unsigned threshold_ = 1 << 14)
+				: _fd(socket_.fd()), _buffer_size(buffer_size_), _threshold(threshold_),
+				  _data((std::size_t) buffer_count_ * buffer_size_), _seq(buffer_count_, 0),
+				  _state(buffer_count_, state::free)
+			{
+				int one = 1;
+				_enabled = ::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+
+				for (unsigned i = buffer_count_; i > 0; i--)
+					_free.push_back(i - 1);
+			}
+
+			zerocopy_sender(const zerocopy_sender&) = delete;
+			zerocopy_sender& operator=(const zerocopy_sender&) = delete;
+
+			//! returns true if the socket accepted SO_ZEROCOPY
+			bool enabled() const
+			{
+				return _enabled;
+			}
+
+			unsigned buffer_size() const
+			{
+				return _buffer_size;
+			}
+
+			//! returns a free buffer of buffer_size() bytes, or nullptr if all are in flight
+			unsigned char* acquire()
+			{
+				if (_free.empty())
+					reap();
+
+				if (_free.empty())
+					return nullptr;
+
+				unsigned i = _free.back();
+				_free.pop_back();
+				_state[i] = state::acquired;
+				return _buffer(i);
+			}
+
+			//! returns an acquired buffer to the pool without sending it
+			void release(unsigned char* buf_)
+			{
+				unsigned i = _index(buf_);
+
+				if (_state[i] == state::acquired)
+					_release(i);
+			}
+
+			//! sends len_ bytes of an acquired buffer on a connected socket and takes ownership of
+			//! it, returns the number of bytes sent
+			//!
+			//! All sends throw std::invalid_argument if len_ exceeds buffer_size(); the buffer
+			//! stays acquired then.
+			unsigned send(unsigned char* buf_, unsigned len_, int flags_ = 0)
+			{
+				return _send(buf_, len_, flags_, nullptr, 0);
+			}
+
+			//! sends len_ bytes of an acquired buffer to ip_dst_:tp_dst_ and takes ownership of it,
+			//! returns the number of bytes sent
+			unsigned send_to(unsigned char* buf_, unsigned len_, const ip4_addr& ip_dst_,
+				uint16_t tp_dst_, int flags_ = 0)
+			{
+				return send_to(buf_, len_, endpoint(ip_dst_, tp_dst_), flags_);
+			}
+
+			//! sends len_ bytes of an acquired buffer to dst_ and takes ownership of it
+			unsigned send_to(unsigned char* buf_, unsigned len_, const endpoint& dst_,
+				int flags_ = 0)
+			{
+				return _send(buf_, len_, flags_, dst_.data(), dst_.size());
+			}
+
+			//! reads completion notifications from the error queue without blocking and returns
+			//! completed buffers to the pool, returns the number of buffers released
+			unsigned reap()
+			{
+				unsigned released = 0;
+
+				while (_pending > 0) {
+					char control[128];
+					struct msghdr msg {};
+					msg.msg_control    = control;
+					msg.msg_controllen = sizeof(control);
+
+					if (::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+						if (errno == EINTR)
+							continue;
+
+						break;
+					}
+
+					for (auto* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+						if (!((c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR)
+							|| (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR)))
+							continue;
+
+						struct sock_extended_err err {};
+						std::memcpy(&err, CMSG_DATA(c), sizeof(err));
+
+						if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0)
+							continue;
+
+						released += _complete(err.ee_info, err.ee_data,
+							err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+					}
+				}
+
+				return released;
+			}
+
+			//! waits up to timeout_ms_ until all zerocopy sends completed, returns true if so
+			bool wait_all(int timeout_ms_ = -1)
+			{
+				auto start = std::chrono::steady_clock::now();
+
+				while (reap(), _pending > 0) {
+					int remaining = timeout_ms_;
+
+					if (timeout_ms_ >= 0) {
+						auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+							std::chrono::steady_clock::now() - start).count();
+
+						if (elapsed >= timeout_ms_)
+							return false;
+
+						remaining = timeout_ms_ - (int) elapsed;
+					}
+
+					struct pollfd pfd { _fd, 0, 0 }; // POLLERR is always reported
+					::poll(&pfd, 1, remaining);
+				}
+
+				return true;
+			}
+
+			//! returns the number of buffers waiting for completion
+			unsigned in_flight() const
+			{
+				return _pending;
+			}
+
+			const stats& statistics() const
+			{
+				return _stats;
+			}
+
+		private:
+			enum class state : uint8_t { free, acquired, in_flight };
+
+			int _fd;
+			unsigned _buffer_size;
+			unsigned _threshold;
+			bool _enabled       = false;
+			uint32_t _next_seq  = 0;
+			unsigned _pending   = 0;
+			std::vector<unsigned char> _data;
+			std::vector<uint32_t> _seq;
+			std::vector<state> _state;
+			std::vector<unsigned> _free;
+			stats _stats;
+
+			unsigned char* _buffer(unsigned i_)
+			{
+				return _data.data() + (std::size_t) i_ * _buffer_size;
+			}
+
+			unsigned _index(const unsigned char* buf_) const
+			{
+				std::size_t off = (std::size_t) (buf_ - _data.data());
+
+				if (buf_ < _data.data() || off >= _data.size() || off % _buffer_size)
+					throw std::invalid_argument("zerocopy_sender: buffer not from this pool");
+
+				return (unsigned) (off / _buffer_size);
+			}
+
+			void _release(unsigned i_)
+			{
+				_state[i_] = state::free;
+				_free.push_back(i_);
+			}
+
+			unsigned _send(unsigned char* buf_, unsigned len_, int flags_,
+				const struct sockaddr* dest_, socklen_t dest_len_)
+			{
+				unsigned i = _index(buf_);
+
+				if (_state[i] != state::acquired)
+					throw std::invalid_argument("zerocopy_sender: buffer not acquired");
+
+				if (len_ > _buffer_size)
+					throw std::invalid_argument("zerocopy_sender: length exceeds the buffer size");
+
+				struct iovec iov { buf_, len_ };
+
+				struct msghdr msg {};
+				msg.msg_name    = (void*) dest_;
+				msg.msg_namelen = dest_len_;
+				msg.msg_iov     = &iov;
+				msg.msg_iovlen  = 1;
+
+				bool zerocopy = _enabled && len_ >= _threshold;
+				ssize_t r;
+
+				do {
+					r = ::sendmsg(_fd, &msg, flags_ | (zerocopy ? MSG_ZEROCOPY : 0));
+
+					// out of option memory for notifications, copy this one
+					if (r == -1 && errno == ENOBUFS && zerocopy) {
+						reap();
+						zerocopy = false;
+						r = ::sendmsg(_fd, &msg, flags_);
+					}
+				} while (r == -1 && errno == EINTR);
+
+				if (r == -1) {
+					int err = errno;
+					_release(i);
+					throw std::runtime_error("zerocopy_sender: could not send: errno: "
+						+ std::to_string(err));
+				}
+
+				if (zerocopy) {
+					_state[i] = state::in_flight;
+					_seq[i] = _next_seq++;
+					_pending++;
+					_stats.zerocopy_sends++;
+				} else {
+					_release(i);
+					_stats.copied_sends++;
+				}
+
+				return (unsigned) r;
+			}
+
+			//! releases the buffers of the zerocopy sends [lo_, hi_]
+			unsigned _complete(uint32_t lo_, uint32_t hi_, bool copied_)
+			{
+				unsigned released = 0;
+
+				for (unsigned i = 0; i < _state.size(); i++) {
+					if (_state[i] == state::in_flight && _seq[i] - lo_ <= hi_ - lo_) {
+						_release(i);
+						released++;
+					}
+				}
+
+				_pending -= released;
+				_stats.completions += released;
+
+				if (copied_)
+					_stats.kernel_copied += released;
+
+				return released;
+			}
+		};
+#endif
+
+#ifdef __linux__
+		//! a group of SO_REUSEPORT datagram sockets bound to the same address, each served by its
+		//! own receive thread
+		//!
+		//! The kernel spreads incoming datagrams across the sockets by flow hash or, with
+		//! cpu_steering, by the cpu that processed the packet. Every receive thread is optionally
+		//! pinned to a cpu and calls the handler directly with each received batch, so datagrams
+		//! are never handed off between threads.
+		class listener_group
+		{
+		public:
+			struct config
+			{
+				unsigned size         = std::thread::hardware_concurrency();
+				bool cpu_steering     = false; //!< select the socket by cpu (cBPF program)
+				bool pin_threads      = true;
+				std::vector<int> cpus = {};    //!< cpu for thread i, takes precedence over placement
+				sys::placement placement = sys::placement::per_cpu;
+				unsigned batch_size   = 32;
+				unsigned buffer_size  = 2048;
+				int poll_timeout      = 100;   //!< ms between checks for stop()
+			};
+
+			//! called on receive thread index_ with each batch received on socket index_
+			using handler_t = std::function<void (unsigned index_, const datagram_batch& batch_)>;
+
+			listener_group(const ip4_addr& ip_addr_, uint16_t port_)
+				: listener_group(ip_addr_, port_, config()) { }
+
+			//! opens and binds config_.size sockets, port_ 0 picks an ephemeral port
+			listener_group(const ip4_addr& ip_addr_, uint16_t port_, const config& config_)
+				: _config(config_), _received(std::max(1u, config_.size))
+			{
+				_config.size = std::max(1u, _config.size);
+
+				for (unsigned i = 0; i < _config.size; i++) {
+					_sockets.emplace_back(new socket(socket::type::dgram));
+					int fd = _sockets.back()->fd();
+					int one = 1;
+
+					if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)))
+						throw std::runtime_error("listener_group: could not set SO_REUSEPORT: errno: "
+							+ std::to_string(errno));
+
+					struct sockaddr_in in_addr {};
+					in_addr.sin_family = AF_INET;
+					in_addr.sin_addr.s_addr = ip_addr_.to_uint32();
+					in_addr.sin_port = htons(port_);
+
+					if (::bind(fd, (struct sockaddr*) &in_addr, sizeof(in_addr)))
+						throw std::runtime_error("listener_group: could not bind: errno: "
+							+ std::to_string(errno));
+
+					if (port_ == 0) {
+						socklen_t len = sizeof(in_addr);
+						::getsockname(fd, (struct sockaddr*) &in_addr, &len);
+						port_ = ntohs(in_addr.sin_port);
+					}
+
+					sys::set_nonblocking(fd);
+				}
+
+				_port = port_;
+
+				if (_config.cpu_steering)
+					_attach_cpu_steering();
+			}
+
+			listener_group(const listener_group&) = delete;
+			listener_group& operator=(const listener_group&) = delete;
+
+			//! starts one receive thread per socket
+			void start(handler_t handler_)
+			{
+				if (!_threads.empty())
+					throw std::logic_error("listener_group: already started");
+
+				_handler = std::move(handler_);
+				_stop = false;
+
+				std::vector<sys::cpu_set> cpus(_config.size);
+
+				if (_config.pin_threads)
+					cpus = sys::cpu_topology::local().place(_config.size, _config.placement, _config.cpus);
+
+				for (unsigned i = 0; i < _config.size; i++) {
+					sys::cpu_set cpu = cpus[i];
+
+					// pinned before the first receive, an empty set leaves the thread unpinned
+					_threads.emplace_back([this, i, cpu]() {
+						cpu.pin();
+						_receive_loop(i);
+					});
+				}
+			}
+
+			//! stops and joins all receive threads
+			void stop()
+			{
+				_stop = true;
+
+				for (auto& t : _threads)
+					if (t.joinable()) t.join();
+
+				_threads.clear();
+			}
+
+			unsigned size() const
+			{
+				return _config.size;
+			}
+
+			//! returns the bound port
+			uint16_t port() const
+			{
+				return _port;
+			}
+
+			//! returns socket index_ of the group
+			socket& at(unsigned index_)
+			{
+				return *_sockets.at(index_);
+			}
+
+			//! returns the number of datagrams received on socket index_
+			uint64_t received(unsigned index_) const
+			{
+				return _received.at(index_).value.load(std::memory_order_relaxed);
+			}
+
+			~listener_group()
+			{
+				stop();
+			}
+
+		private:
+			struct counter
+			{
+				std::atomic<uint64_t> value { 0 };
+				char pad[64 - sizeof(std::atomic<uint64_t>)];
+			};
+
+			config _config;
+			uint16_t _port = 0;
+			std::vector<std::unique_ptr<socket>> _sockets;
+			std::vector<std::thread> _threads;
+			std::vector<counter> _received;
+			handler_t _handler;
+			std::atomic_bool _stop { false };
+
+			void _receive_loop(unsigned index_)
+			{
+				socket& sock = *_sockets[index_];
+				datagram_batch batch(_config.batch_size, _config.buffer_size);
+				struct pollfd pfd { sock.fd(), POLLIN, 0 };
+
+				while (!_stop) {
+					unsigned n = sock.receive_batch(batch, MSG_DONTWAIT);
+
+					if (n == 0) {
+						::poll(&pfd, 1, _config.poll_timeout);
+						continue;
+					}
+
+					_received[index_].value.fetch_add(n, std::memory_order_relaxed);
+					_handler(index_, batch);
+				}
+			}
+
+			//! selects the socket with index cpu % size for every packet
+			void _attach_cpu_steering()
+			{
+				struct sock_filter code[] = {
+					{ BPF_LD  | BPF_W   | BPF_ABS, 0, 0, (uint32_t) (SKF_AD_OFF + SKF_AD_CPU) },
+					{ BPF_ALU | BPF_MOD | BPF_K,   0, 0, _config.size },
+					{ BPF_RET | BPF_A,             0, 0, 0 }
+				};
+
+				struct sock_fprog prog { (unsigned short) (sizeof(code) / sizeof(code[0])), code };
+
+				if (::setsockopt(_sockets[0]->fd(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+					&prog, sizeof(prog)))
+					throw std::runtime_error("listener_group: could not attach cpu steering program:"
+						" errno: " + std::to_string(errno));
+			}
+		};
+#endif
+
+#ifdef __linux__
+		//! a linux packet capture source using an AF_PACKET socket with a TPACKET_V3 mmap ring
+		//!
+		//! Frames are delivered in bursts of one ring block at a time and point directly into the
+		//! ring, starting at the link layer header, so that they can be parsed with the
+		//! packet_header classes without copying.
+		class packet_capture : public sys::file_descriptor
+		{
+		public:
+			enum class fanout : int {
+				none = -1,
+				hash = PACKET_FANOUT_HASH,
+				lb   = PACKET_FANOUT_LB,
+				cpu  = PACKET_FANOUT_CPU
+			};
+
+			struct config
+			{
+				unsigned block_size    = 1 << 20; //!< must be a multiple of the page size
+				unsigned block_count   = 64;
+				unsigned frame_size    = 2048;    //!< upper bound for the snap length
+				unsigned block_timeout = 10;      //!< ms until the kernel retires a partial block
+				fanout fanout_mode     = fanout::none;
+				uint16_t fanout_group  = 0;
+				bool promiscuous       = false;
+			};
+
+			//! a captured frame, valid until the handler it was passed to returns
+			struct frame
+			{
+				const unsigned char* data = nullptr;
+				uint32_t caplen           = 0;
+				uint32_t len              = 0;
+				uint64_t timestamp        = 0; //!< nanoseconds since the unix epoch
+				int ifindex               = 0;
+				uint8_t pkttype           = 0; //!< PACKET_HOST, PACKET_OUTGOING, ...
+			};
+
+			struct stats
+			{
+				uint64_t packets = 0; //!< packets seen by the kernel
+				uint64_t drops   = 0; //!< packets dropped because the ring was full
+				uint64_t freezes = 0; //!< times the ring queue was frozen
+				uint64_t blocks  = 0; //!< blocks delivered
+				uint64_t frames  = 0; //!< frames delivered
+				uint64_t bytes   = 0; //!< captured bytes delivered
+			};
+
+			//! opens a capture on interface_ ("" or "any" captures on all interfaces)
+			explicit packet_capture(const std::string& interface_)
+				: packet_capture(interface_, config()) { }
+
+			//! opens a capture on interface_ ("" or "any" captures on all interfaces)
+			packet_capture(const std::string& interface_, const config& config_)
+				: _config(config_)
+			{
+				if ((_fd = ::socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) == -1)
+					throw std::runtime_error("packet_capture: could not open: errno: "
+						+ std::to_string(errno));
+
+				int version = TPACKET_V3;
+
+				if (::setsockopt(_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)))
+					_fail("could not set version");
+
+				struct tpacket_req3 req {};
+				req.tp_block_size     = _config.block_size;
+				req.tp_block_nr       = _config.block_count;
+				req.tp_frame_size     = _config.frame_size;
+				req.tp_frame_nr       = (_config.block_size / _config.frame_size)
+				                        * _config.block_count;
+				req.tp_retire_blk_tov = _config.block_timeout;
+
+				if (::setsockopt(_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)))
+					_fail("could not set up ring");
+
+				_ring_size = (std::size_t) _config.block_size * _config.block_count;
+				void* ring = ::mmap(nullptr, _ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+
+				if (ring == MAP_FAILED) {
+					_ring_size = 0;
+					_fail("could not map ring");
+				}
+
+				_ring = (unsigned char*) ring;
+
+				struct sockaddr_ll ll {};
+				ll.sll_family   = AF_PACKET;
+				ll.sll_protocol = htons(ETH_P_ALL);
+
+				if (!interface_.empty() && interface_ != "any"
+					&& (ll.sll_ifindex = (int) ::if_nametoindex(interface_.c_str())) == 0)
+					_fail("unknown interface " + interface_);
+
+				if (::bind(_fd, (struct sockaddr*) &ll, sizeof(ll)))
+					_fail("could not bind");
+
+				if (_config.promiscuous && ll.sll_ifindex) {
+					struct packet_mreq mreq {};
+					mreq.mr_ifindex = ll.sll_ifindex;
+					mreq.mr_type    = PACKET_MR_PROMISC;
+
+					if (::setsockopt(_fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)))
+						_fail("could not enable promiscuous mode");
+				}
+
+				if (_config.fanout_mode != fanout::none) {
+					int arg = _config.fanout_group | ((int) _config.fanout_mode << 16);
+
+					if (_config.fanout_mode == fanout::hash)
+						arg |= PACKET_FANOUT_FLAG_DEFRAG << 16;
+
+					if (::setsockopt(_fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)))
+						_fail("could not join fanout group");
+				}
+
+				_frames.reserve(_config.block_size / TPACKET_ALIGNMENT);
+			}
+
+			packet_capture(const packet_capture&) = delete;
+			packet_capture& operator=(const packet_capture&) = delete;
+
+			//! delivers all blocks ready in the ring, waiting up to timeout_ms_ if there are none
+			//!
+			//! handler_ is called once per block as handler_(const frame* frames, unsigned count)
+			//! and the block is returned to the kernel when it returns. Returns the number of
+			//! frames delivered.
+			template <typename Handler>
+			unsigned dispatch(Handler handler_, int timeout_ms_ = -1)
+			{
+				if (!_ready(_block(_current))) {
+					struct pollfd pfd { _fd, POLLIN | POLLERR, 0 };
+
+					if (::poll(&pfd, 1, timeout_ms_) == -1 && errno != EINTR)
+						throw std::runtime_error("packet_capture: could not poll: errno: "
+							+ std::to_string(errno));
+				}
+
+				unsigned count = 0;
+
+				for (unsigned i = 0; i < _config.block_count; i++) {
+					struct tpacket_block_desc* bd = _block(_current);
+
+					if (!_ready(bd))
+						break;
+
+					_frames.clear();
+
+					// the block goes back to the kernel and is counted once, also if handler_ throws
+					struct release
+					{
+						packet_capture& capture;
+						struct tpacket_block_desc* bd;
+						uint64_t bytes;
+
+						~release()
+						{
+							__atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+							capture._current = (capture._current + 1) % capture._config.block_count;
+
+							capture._stats.blocks++;
+							capture._stats.frames += capture._frames.size();
+							capture._stats.bytes  += bytes;
+						}
+					} guard { *this, bd, 0 };
+
+					auto* hdr = (struct tpacket3_hdr*) ((unsigned char*) bd
+						+ bd->hdr.bh1.offset_to_first_pkt);
+
+					for (uint32_t n = 0; n < bd->hdr.bh1.num_pkts; n++) {
+						auto* ll = (struct sockaddr_ll*) ((unsigned char*) hdr
+							+ TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+						frame f;
+						f.data      = (const unsigned char*) hdr + hdr->tp_mac;
+						f.caplen    = hdr->tp_snaplen;
+						f.len       = hdr->tp_len;
+						f.timestamp = (uint64_t) hdr->tp_sec * 1000000000 + hdr->tp_nsec;
+						f.ifindex   = ll->sll_ifindex;
+						f.pkttype   = ll->sll_pkttype;
+						_frames.push_back(f);
+
+						guard.bytes += f.caplen;
+						hdr = (struct tpacket3_hdr*) ((unsigned char*) hdr + hdr->tp_next_offset);
+					}
+
+					count += (unsigned) _frames.size();
+					handler_((const frame*) _frames.data(), (unsigned) _frames.size());
+				}
+
+				return count;
+			}
+
+			//! returns the kernel packet and drop counters along with delivery counters
+			stats statistics()
+			{
+				struct tpacket_stats_v3 st {};
+				socklen_t len = sizeof(st);
+
+				// the kernel resets its counters on every read
+				if (::getsockopt(_fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+					_stats.packets += st.tp_packets;
+					_stats.drops   += st.tp_drops;
+					_stats.freezes += st.tp_freeze_q_cnt;
+				}
+
+				return _stats;
+			}
+
+			void close()
+			{
+				if (_ring) {
+					::munmap(_ring, _ring_size);
+					_ring = nullptr;
+				}
+
+				if (_fd != -1) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+
+			~packet_capture()
+			{
+				close();
+			}
+
+		private:
+			config _config;
+			unsigned char* _ring   = nullptr;
+			std::size_t _ring_size = 0;
+			unsigned _current      = 0;
+			std::vector<frame> _frames;
+			stats _stats;
+
+			struct tpacket_block_desc* _block(unsigned i_) const
+			{
+				return (struct tpacket_block_desc*) (_ring + (std::size_t) i_ * _config.block_size);
+			}
+
+			static bool _ready(struct tpacket_block_desc* bd_)
+			{
+				return __atomic_load_n(&bd_->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+					& TP_STATUS_USER;
+			}
+
+			void _fail(const std::string& what_)
+			{
+				int err = errno;
+				close();
+				throw std::runtime_error("packet_capture: " + what_ + ": errno: "
+					+ std::to_string(err));
+			}
+		};
+#endif
+	}
+
+	namespace async {
+
+		//! a wrapper around the poll() system call
+		class poll
+		{
+		public:
+			enum class event : short { in = POLLIN, out = POLLOUT };
+
+			using callback_t = std::function<void (int, event)>;
+
+			poll() = default;
+
+			explicit poll(sys::file_descriptor fd_, callback_t cb_, event events_ = event::in)
+			{
+				add_fd(fd_, std::move(cb_), events_);
+			}
+
+			explicit poll(int fd_, callback_t cb_, event events_ = event::in)
+			{
+				add_fd(fd_, std::move(cb_), events_);
+			}
+
+			void add_fd(sys::file_descriptor fd_, callback_t cb_, event events_ = event::in)
+			{
+				add_fd(fd_.fd(), std::move(cb_), events_);
+			}
+
+			void add_fd(int fd_, callback_t cb_, event events_ = event::in)
+			{
+				struct pollfd pfd {};
+				pfd.fd     = fd_;
+				pfd.events = (short) events_;
+
+				_fds.push_back(pfd);
+				_callbacks.push_back(std::move(cb_));
+			}
+
+			//! removes all entries of fd_, may be called from a callback
+			void remove_fd(int fd_)
+			{
+				for (auto& pfd : _fds) {
+					if (pfd.fd == fd_) {
+						pfd.fd = -1; // ignored by poll(), erased before the next call
+						pfd.revents = 0;
+						_removed = true;
+					}
+				}
+			}
+
+			void block()
+			{
+				while (!_stop) {
+					_compact();
+
+					if (::poll(_fds.data(), _fds.size(), 1000) < 0)
+						break;
+
+					// fds added by callbacks have no revents yet
+					for (std::size_t i = 0; i < _fds.size() && !_stop; i++) {
+						short revents = _fds[i].revents;
+						_fds[i].revents = 0;
+
+						if (revents & POLLOUT)
+							_callbacks[i](_fds[i].fd, event::out);
+
+						if (revents & POLLIN && _fds[i].fd != -1)
+							_callbacks[i](_fds[i].fd, event::in);
+					}
+				}
+			}
+
+			void stop()
+			{
+				_stop = true;
+			}
+
+		private:
+			std::atomic_bool _stop { false };
+			bool _removed = false;
+			std::deque<callback_t> _callbacks; // stable while callbacks add fds
+			std::vector<struct pollfd> _fds;
+
+			void _compact()
+			{
+				if (!_removed)
+					return;
+
+				std::size_t j = 0;
+
+				for (std::size_t i = 0; i < _fds.size(); i++) {
+					if (_fds[i].fd == -1)
+						continue;
+
+					if (i != j) {
+						_fds[j] = _fds[i];
+						_callbacks[j] = std::move(_callbacks[i]);
+					}
+
+					j++;
+				}
+
+				_fds.resize(j);
+				_callbacks.resize(j);
+				_removed = false;
+			}
+		};
+
+		inline short operator&(const poll::event& lhs_, const poll::event& rhs_)
+		{
+			return ((short) lhs_ & (short) rhs_);
+		}
+
+		class timer_wheel;
+
+		//! a one-shot or periodic timer for a timer_wheel
+		//!
+		//! Timers are intrusive: the wheel links the timer objects themselves, so scheduling,
+		//! rescheduling and cancelling never allocate. A timer must outlive its schedule or be
+		//! destroyed, which cancels it.
+		class timer
+		{
+		public:
+			using callback_t = std::function<void (timer&)>;
+
+			timer() = default;
+
+			explicit timer(callback_t callback_) : _callback(std::move(callback_)) { }
+
+			timer(const timer&) = delete;
+			timer& operator=(const timer&) = delete;
+
+			void set_callback(callback_t callback_)
+			{
+				_callback = std::move(callback_);
+			}
+
+			//! returns true if the timer is scheduled
+			bool active() const
+			{
+				return _wheel != nullptr;
+			}
+
+			//! returns the repeat interval in ticks, 0 for one-shot timers
+			uint64_t period() const
+			{
+				return _period;
+			}
+
+			inline ~timer();
+
+		private:
+			friend class timer_wheel;
+
+			timer* _prev   = nullptr;
+			timer* _next   = nullptr;
+			timer** _list  = nullptr;
+			timer_wheel* _wheel = nullptr;
+			uint64_t _expiry = 0;
+			uint64_t _period = 0;
+			callback_t _callback;
+		};
+
+		//! a hashed timing wheel
+		//!
+		//! Time is divided into ticks of resolution_ms_ milliseconds. A timer is linked into the
+		//! slot of its expiry tick; timers more than one revolution away stay in their slot until
+		//! the wheel has come around often enough. A bitmap of non-empty slots lets advance() and
+		//! next_timeout_ms() skip empty slots.
+		class timer_wheel
+		{
+		public:
+			//! slots_ is rounded up to a power of two
+			explicit timer_wheel(unsigned resolution_ms_ = 1, unsigned slots_ = 4096)
+				: _resolution(std::max(1u, resolution_ms_))
+			{
+				unsigned slots = 64;
+
+				while (slots < slots_)
+					slots <<= 1;
+
+				_slots.assign(slots, nullptr);
+				_bitmap.assign(slots / 64, 0);
+				_mask = slots - 1;
+				_current = now();
+			}
+
+			timer_wheel(const timer_wheel&) = delete;
+			timer_wheel& operator=(const timer_wheel&) = delete;
+
+			//! returns the current time in ticks of the steady clock
+			uint64_t now() const
+			{
+				return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count() / _resolution;
+			}
+
+			//! returns the tick up to which timers have been expired
+			uint64_t current() const
+			{
+				return _current;
+			}
+
+			//! (re)schedules timer_ to expire delay_ ticks (at least one) after current() and then
+			//! every period_ ticks if period_ is not 0
+			//!
+			//! The delay counts from the last advance, use schedule_at() to count from now().
+			void schedule(timer& timer_, uint64_t delay_, uint64_t period_ = 0)
+			{
+				schedule_at(timer_, _current + std::max<uint64_t>(1, delay_), period_);
+			}
+
+			//! (re)schedules timer_ to expire at tick_ (at least current() + 1) and then every
+			//! period_ ticks if period_ is not 0
+			void schedule_at(timer& timer_, uint64_t tick_, uint64_t period_ = 0)
+			{
+				if (timer_._wheel)
+					timer_._wheel->cancel(timer_);
+
+				timer_._period = period_;
+				_insert(timer_, std::max(tick_, _current + 1));
+				_size++;
+			}
+
+			//! stops timer_, does nothing if it is not scheduled
+			void cancel(timer& timer_)
+			{
+				if (timer_._wheel != this)
+					return;
+
+				_unlink(timer_);
+				timer_._wheel = nullptr;
+				_size--;
+			}
+
+			//! returns the number of scheduled timers
+			std::size_t size() const
+			{
+				return _size;
+			}
+
+			//! expires all timers due up to now(), returns the number of callbacks called
+			unsigned advance()
+			{
+				return advance_to(now());
+			}
+
+			//! expires all timers due up to tick_, returns the number of callbacks called
+			//!
+			//! Periodic timers are rescheduled before their callback runs, callbacks may schedule
+			//! or cancel any timer.
+			unsigned advance_to(uint64_t tick_)
+			{
+				unsigned fired = 0;
+
+				while (_current < tick_) {
+					if (_size == 0) {
+						_current = tick_;
+						break;
+					}
+
+					uint64_t distance = _next_slot(std::min<uint64_t>(tick_ - _current, _mask + 1));
+
+					if (distance == 0) {
+						_current = tick_;
+						break;
+					}
+
+					_current += distance;
+					fired += _expire(_current & _mask);
+				}
+
+				return fired;
+			}
+
+			//! returns the milliseconds until the next non-empty slot is due (which may not hold
+			//! a due timer yet), 0 if it is overdue and -1 if no timer is scheduled
+			int next_timeout_ms() const
+			{
+				if (_size == 0)
+					return -1;
+
+				uint64_t distance = _next_slot(_mask + 1);
+				uint64_t due = (_current + (distance ? distance : _mask + 1)) * _resolution;
+				uint64_t now_ms = now() * _resolution;
+				return due <= now_ms ? 0 : (int) std::min<uint64_t>(due - now_ms, INT32_MAX);
+			}
+
+			~timer_wheel()
+			{
+				for (auto& head : _slots)
+					while (head)
+						cancel(*head);
+			}
+
+		private:
+			unsigned _resolution;
+			uint64_t _mask;
+			uint64_t _current;
+			std::size_t _size = 0;
+			std::vector<timer*> _slots;
+			std::vector<uint64_t> _bitmap;
+			timer* _firing = nullptr;
+
+			void _insert(timer& timer_, uint64_t expiry_)
+			{
+				uint64_t slot = expiry_ & _mask;
+				timer*& head = _slots[slot];
+
+				timer_._expiry = expiry_;
+				timer_._wheel  = this;
+				timer_._list   = &head;
+				timer_._prev   = nullptr;
+				timer_._next   = head;
+
+				if (head)
+					head->_prev = &timer_;
+
+				head = &timer_;
+				_bitmap[slot / 64] |= 1ULL << (slot % 64);
+			}
+
+			void _unlink(timer& timer_)
+			{
+				if (timer_._prev)
+					timer_._prev->_next = timer_._next;
+				else
+					*timer_._list = timer_._next;
+
+				if (timer_._next)
+					timer_._next->_prev = timer_._prev;
+
+				if (*timer_._list == nullptr && timer_._list != &_firing) {
+					auto slot = (uint64_t) (timer_._list - _slots.data());
+					_bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+				}
+
+				timer_._prev = timer_._next = nullptr;
+				timer_._list = nullptr;
+			}
+
+			//! returns the distance (1..max_) from the current tick to the next non-empty slot,
+			//! 0 if there is none within max_ ticks
+			uint64_t _next_slot(uint64_t max_) const
+			{
+				uint64_t distance = 1;
+
+				while (distance <= max_) {
+					uint64_t slot = (_current + distance) & _mask;
+					uint64_t word = _bitmap[slot / 64] >> (slot % 64);
+
+					if (word)
+						return distance + (uint64_t) __builtin_ctzll(word) <= max_
+							? distance + (uint64_t) __builtin_ctzll(word) : 0;
+
+					distance += 64 - slot % 64;
+				}
+
+				return 0;
+			}
+
+			//! fires the due timers of slot_
+			unsigned _expire(uint64_t slot_)
+			{
+				// move due timers to the firing list first, callbacks may modify the slot
+				for (timer* t = _slots[slot_]; t; ) {
+					timer* next = t->_next;
+
+					if (t->_expiry <= _current) {
+						_unlink(*t);
+						t->_list = &_firing;
+						t->_next = _firing;
+
+						if (_firing)
+							_firing->_prev = t;
+
+						_firing = t;
+					}
+
+					t = next;
+				}
+
+				unsigned fired = 0;
+
+				while (_firing) {
+					timer& t = *_firing;
+					_unlink(t);
+
+					if (t._period) {
+						_insert(t, _current + t._period);
+					} else {
+						t._wheel = nullptr;
+						_size--;
+					}
+
+					fired++;
+
+					if (t._callback)
+						t._callback(t);
+				}
+
+				return fired;
+			}
+		};
+
+		timer::~timer()
+		{
+			if (_wheel)
+				_wheel->cancel(*this);
+		}
+
+#ifdef __linux__
+		//! an epoll based event loop that dispatches readiness events to per-fd handlers and
+		//! expires timers
+		//!
+		//! Handlers are stored in a table indexed by fd, so registration, removal and dispatch
+		//! are O(1) regardless of the number of fds. Handlers may add, modify or remove any fd,
+		//! including their own. Timers run on a timer_wheel with millisecond ticks whose next due
+		//! slot bounds the epoll_wait() timeout. post(), stop() and wakeup() may be called from
+		//! any thread, they interrupt a blocking wait through an eventfd; everything else belongs
+		//! to the thread running the loop.
+		class reactor : public sys::file_descriptor
+		{
+		public:
+			enum event : uint32_t
+			{
+				in     = EPOLLIN,
+				out    = EPOLLOUT,
+				hangup = EPOLLHUP | EPOLLRDHUP,
+				error  = EPOLLERR
+			};
+
+			enum class trigger { level, edge };
+
+			//! called with the fd and the ready events (a combination of event values)
+			using handler_t = std::function<void (int fd_, uint32_t events_)>;
+
+			using task_t = std::function<void ()>;
+
+			//! max_events_ is the number of events fetched by one epoll_wait() call
+			explicit reactor(unsigned max_events_ = 256) : _events(std::max(1u, max_events_))
+			{
+				if ((_fd = ::epoll_create1(EPOLL_CLOEXEC)) == -1)
+					throw std::runtime_error("reactor: could not create epoll instance: errno: "
+						+ std::to_string(errno));
+
+				if ((_wakeup_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+					int err = errno;
+					::close(_fd);
+					throw std::runtime_error("reactor: could not create eventfd: errno: "
+						+ std::to_string(err));
+				}
+
+				struct epoll_event ev {};
+				ev.events   = EPOLLIN;
+				ev.data.u64 = WAKEUP_TAG;
+				::epoll_ctl(_fd, EPOLL_CTL_ADD, _wakeup_fd, &ev);
+			}
+
+			reactor(const reactor&) = delete;
+			reactor& operator=(const reactor&) = delete;
+
+			//! registers fd_ for events_, throws std::runtime_error if it is already registered
+			void add(int fd_, uint32_t events_, handler_t handler_,
+				trigger trigger_ = trigger::level)
+			{
+				if (fd_ < 0)
+					throw std::invalid_argument("reactor: invalid fd");
+
+				// a deque, so that the entry of a handler running right now does not move
+				if ((std::size_t) fd_ >= _handlers.size())
+					_handlers.resize(std::max<std::size_t>(fd_ + 1, _handlers.size() * 2));
+
+				entry& e = _handlers[fd_];
+
+				if (e.handler)
+					throw std::runtime_error("reactor: fd already registered");
+
+				e.generation++;
+				_ctl(EPOLL_CTL_ADD, fd_, events_, trigger_, e.generation);
+				e.handler = std::move(handler_);
+				_size++;
+			}
+
+			void add(const sys::file_descriptor& fd_, uint32_t events_, handler_t handler_,
+				trigger trigger_ = trigger::level)
+			{
+				add(fd_.fd(), events_, std::move(handler_), trigger_);
+			}
+
+			//! changes the events and trigger mode of a registered fd
+			void modify(int fd_, uint32_t events_, trigger trigger_ = trigger::level)
+			{
+				_ctl(EPOLL_CTL_MOD, fd_, events_, trigger_, _entry(fd_).generation);
+			}
+
+			//! unregisters fd_, pending events of fd_ are discarded
+			void remove(int fd_)
+			{
+				entry& e = _entry(fd_);
+
+				if (::epoll_ctl(_fd, EPOLL_CTL_DEL, fd_, nullptr) && errno != EBADF)
+					throw std::runtime_error("reactor: could not remove fd: errno: "
+						+ std::to_string(errno));
+
+				e.generation++;
+
+				// a handler may remove itself, keep it alive until the dispatch loop is done
+				if (_dispatching)
+					_retired.push_back(std::move(e.handler));
+
+				e.handler = nullptr;
+				_size--;
+			}
+
+			//! returns true if fd_ is registered
+			bool contains(int fd_) const
+			{
+				return fd_ >= 0 && (std::size_t) fd_ < _handlers.size() && _handlers[fd_].handler;
+			}
+
+			//! returns the number of registered fds
+			std::size_t size() const
+			{
+				return _size;
+			}
+
+			//! (re)schedules timer_ to fire after delay_ms_ and then every period_ms_ if not 0
+			//!
+			//! The delay counts from the actual time, also when the wheel has not been advanced
+			//! since a long wait, e.g. when called from a handler.
+			void schedule(timer& timer_, uint64_t delay_ms_, uint64_t period_ms_ = 0)
+			{
+				uint64_t base = std::max(_timers.current(), _timers.now());
+				_timers.schedule_at(timer_, base + std::max<uint64_t>(1, delay_ms_), period_ms_);
+			}
+
+			//! stops timer_
+			void cancel(timer& timer_)
+			{
+				_timers.cancel(timer_);
+			}
+
+			timer_wheel& timers()
+			{
+				return _timers;
+			}
+
+			//! waits up to timeout_ms_ (-1: forever) for events, or less if a timer is due, and
+			//! dispatches events and due timers, returns the number of handlers and timers called
+			unsigned run_once(int timeout_ms_ = -1)
+			{
+				int timer_ms = _timers.next_timeout_ms();
+
+				if (timer_ms >= 0 && (timeout_ms_ < 0 || timer_ms < timeout_ms_))
+					timeout_ms_ = timer_ms;
+
+				int n = ::epoll_wait(_fd, _events.data(), (int) _events.size(), timeout_ms_);
+
+				if (n == -1 && errno == EINTR)
+					return _timers.advance();
+
+				if (n == -1)
+					throw std::runtime_error("reactor: could not wait: errno: "
+						+ std::to_string(errno));
+
+				unsigned called = 0;
+				_dispatching = true;
+
+				for (int i = 0; i < n; i++) {
+					uint64_t tag = _events[i].data.u64;
+
+					if (tag == WAKEUP_TAG) {
+						uint64_t val;
+						while (::read(_wakeup_fd, &val, sizeof(val)) > 0) ;
+						continue;
+					}
+
+					auto fd = (int) (uint32_t) tag;
+					entry& e = _handlers[fd];
+
+					// skip events of fds removed (or removed and added again) by an earlier handler
+					if (!e.handler || e.generation != (uint32_t) (tag >> 32))
+						continue;
+
+					e.handler(fd, _events[i].events);
+					called++;
+				}
+
+				_dispatching = false;
+				_retired.clear();
+				called += run_posted();
+				return called + _timers.advance();
+			}
+
+			//! dispatches events until stop() is called
+			void run()
+			{
+				_stop.store(false, std::memory_order_relaxed);
+
+				while (!_stop.load(std::memory_order_acquire))
+					run_once(-1);
+			}
+
+			//! queues task_ to run on the loop thread, may be called from any thread
+			//!
+			//! The mailbox is a lock-free multi-producer queue. Posters only write to the eventfd
+			//! if no wakeup is pending since the loop last drained the mailbox.
+			void post(task_t task_)
+			{
+				auto* node = new task_node();
+				node->task = std::move(task_);
+
+				task_node* prev = _mailbox_head.exchange(node, std::memory_order_acq_rel);
+				prev->next.store(node, std::memory_order_release);
+
+				if (!_wake_pending.exchange(true, std::memory_order_acq_rel))
+					wakeup();
+			}
+
+			//! runs the tasks posted so far on the calling thread, returns the number of tasks run
+			//!
+			//! Called by run_once(), only call it directly while the loop is not running.
+			unsigned run_posted()
+			{
+				// reset before reading, posts that miss this drain wake the loop again
+				_wake_pending.exchange(false, std::memory_order_acq_rel);
+				unsigned count = 0;
+
+				while (task_node* next = _mailbox_tail->next.load(std::memory_order_acquire)) {
+					task_t task = std::move(next->task);
+					delete _mailbox_tail;
+					_mailbox_tail = next; // the consumed node becomes the new stub
+					task();
+					count++;
+				}
+
+				return count;
+			}
+
+			//! makes run() return after the current dispatch, may be called from any thread
+			void stop()
+			{
+				_stop.store(true, std::memory_order_release);
+				wakeup();
+			}
+
+			//! interrupts a blocking run_once(), may be called from any thread
+			void wakeup()
+			{
+				uint64_t one = 1;
+				ssize_t r = ::write(_wakeup_fd, &one, sizeof(one));
+				(void) r; // EAGAIN: the counter is saturated, a wakeup is pending anyway
+			}
+
+			~reactor()
+			{
+				while (task_node* node = _mailbox_tail) {
+					_mailbox_tail = node->next.load(std::memory_order_relaxed);
+					delete node;
+				}
+
+				::close(_wakeup_fd);
+				::close(_fd);
+			}
+
+		private:
+			static const uint64_t WAKEUP_TAG = ~0ULL;
+
+			struct entry
+			{
+				handler_t handler;
+				uint32_t generation = 0;
+			};
+
+			struct task_node
+			{
+				std::atomic<task_node*> next { nullptr };
+				task_t task;
+			};
+
+			std::deque<entry> _handlers;
+			std::vector<struct epoll_event> _events;
+			std::vector<handler_t> _retired;
+			timer_wheel _timers;
+			std::size_t _size = 0;
+			bool _dispatching = false;
+			std::atomic_bool _stop { false };
+			int _wakeup_fd = -1;
+
+			task_node* _mailbox_tail = new task_node();              // consumer side, a stub
+			std::atomic<task_node*> _mailbox_head { _mailbox_tail }; // producer side
+			std::atomic_bool _wake_pending { false };
+
+			entry& _entry(int fd_)
+			{
+				if (!contains(fd_))
+					throw std::invalid_argument("reactor: fd not registered");
+
+				return _handlers[fd_];
+			}
+
+			void _ctl(int op_, int fd_, uint32_t events_, trigger trigger_, uint32_t generation_)
+			{
+				struct epoll_event ev {};
+				ev.events   = events_ | (trigger_ == trigger::edge ? (uint32_t) EPOLLET : 0);
+				ev.data.u64 = (uint64_t) generation_ << 32 | (uint32_t) fd_;
+
+				if (::epoll_ctl(_fd, op_, fd_, &ev))
+					throw std::runtime_error("reactor: could not register fd: errno: "
+						+ std::to_string(errno));
+			}
+		};
+
+		//! a group of reactors, each run by its own (optionally pinned) thread
+		//!
+		//! fds are spread across the loops round-robin or by a hash of the fd. Work is moved
+		//! between loops by posting tasks to a loop's mailbox, each fd is only ever touched by
+		//! the thread of the loop it was assigned to.
+		class reactor_group
+		{
+		public:
+			enum class assignment { round_robin, hash };
+
+			//! called on the loop's thread with the fd and the error if registering it failed
+			using error_handler_t = std::function<void (int fd_, std::exception_ptr error_)>;
+
+			struct config
+			{
+				unsigned size         = std::thread::hardware_concurrency();
+				bool pin_threads      = true;
+				std::vector<int> cpus = {}; //!< cpu for loop i, takes precedence over placement
+				sys::placement placement = sys::placement::per_cpu;
+				assignment assign     = assignment::round_robin;
+			};
+
+			reactor_group() : reactor_group(config()) { }
+
+			explicit reactor_group(const config& config_) : _config(config_)
+			{
+				_config.size = std::max(1u, _config.size);
+
+				for (unsigned i = 0; i < _config.size; i++)
+					_loops.emplace_back(new reactor());
+			}
+
+			reactor_group(const reactor_group&) = delete;
+			reactor_group& operator=(const reactor_group&) = delete;
+
+			//! starts one thread per loop
+			void start()
+			{
+				if (!_threads.empty())
+					throw std::logic_error("reactor_group: already started");
+
+				std::vector<sys::cpu_set> cpus(_config.size);
+
+				if (_config.pin_threads)
+					cpus = sys::cpu_topology::local().place(_config.size, _config.placement, _config.cpus);
+
+				for (unsigned i = 0; i < _config.size; i++) {
+					reactor* loop = _loops[i].get();
+					sys::cpu_set cpu = cpus[i];
+
+					// pinned before run(), so that no event is handled on the wrong cpu
+					_threads.emplace_back([loop, cpu]() {
+						cpu.pin();
+						loop->run();
+					});
+				}
+			}
+
+			//! stops all loops and joins their threads
+			//!
+			//! Tasks that were posted but not run before a loop stopped, e.g. by another loop
+			//! during shutdown, are run on the calling thread once all loops have stopped.
+			void stop()
+			{
+				for (auto& loop : _loops)
+					loop->stop();
+
+				for (auto& t : _threads)
+					if (t.joinable()) t.join();
+
+				_threads.clear();
+
+				for (bool pending = true; pending; ) {
+					pending = false;
+
+					for (auto& loop : _loops)
+						pending = loop->run_posted() > 0 || pending;
+				}
+			}
+
+			unsigned size() const
+			{
+				return _config.size;
+			}
+
+			//! returns loop index_
+			reactor& at(unsigned index_)
+			{
+				return *_loops.at(index_);
+			}
+
+			//! returns the index of the loop fd_ is assigned to by the assignment policy
+			unsigned select(int fd_)
+			{
+				if (_config.assign == assignment::hash) {
+					uint64_t h = (uint64_t) fd_ * 0x9e3779b97f4a7c15ULL;
+					return (unsigned) ((h >> 32) % _config.size);
+				}
+
+				return _next.fetch_add(1, std::memory_order_relaxed) % _config.size;
+			}
+
+			//! assigns fd_ to a loop and registers it there, returns the loop index
+			//!
+			//! May be called from any thread, the registration runs on the loop's thread. If it
+			//! fails, e.g. because fd_ is already registered, error_ is called with the exception
+			//! on that thread. Without error_ the exception escapes the loop like that of any
+			//! other posted task, which ends the process.
+			unsigned add(int fd_, uint32_t events_, reactor::handler_t handler_,
+				reactor::trigger trigger_ = reactor::trigger::level, error_handler_t error_ = nullptr)
+			{
+				unsigned index = select(fd_);
+				reactor* loop = _loops[index].get();
+
+				// std::function needs a copyable task, so the handler is shared
+				auto handler = std::make_shared<reactor::handler_t>(std::move(handler_));
+
+				loop->post([loop, fd_, events_, handler, trigger_, error_]() {
+					try {
+						loop->add(fd_, events_, std::move(*handler), trigger_);
+					} catch (...) {
+						if (!error_)
+							throw;
+
+						error_(fd_, std::current_exception());
+					}
+				});
+
+				return index;
+			}
+
+			//! runs task_ on loop index_, may be called from any thread
+			void post(unsigned index_, reactor::task_t task_)
+			{
+				_loops.at(index_)->post(std::move(task_));
+			}
+
+			~reactor_group()
+			{
+				stop();
+			}
+
+		private:
+			config _config;
+			std::vector<std::unique_ptr<reactor>> _loops;
+			std::vector<std::thread> _threads;
+			std::atomic<unsigned> _next { 0 };
+		};
+#endif
+
+#ifdef OM_HAVE_IO_URING
+		//! a minimal io_uring submission/completion queue pair
+		//!
+		//! Operations are prepared with the prep_* functions, each tagged with a user_data value
+		//! that is returned with its completion, and handed to the kernel in one batch by
+		//! submit(). The prep_* functions return false if the submission queue is full.
+		class uring : public sys::file_descriptor
+		{
+		public:
+			//! a completion queue entry
+			struct completion
+			{
+				uint64_t user_data = 0;
+				int32_t res        = 0; //!< result of the operation, -errno on failure
+				uint32_t flags     = 0;
+
+				//! returns true if a multishot operation will post more completions
+#ifdef IORING_CQE_F_MORE
+				bool more() const { return flags & IORING_CQE_F_MORE; }
+#else
+				bool more() const { return false; }
+#endif
+
+				//! returns true if the kernel picked a provided buffer for this completion
+				bool has_buffer() const { return flags & IORING_CQE_F_BUFFER; }
+
+				//! returns the id of the provided buffer picked by the kernel
+				uint16_t buffer_id() const { return (uint16_t) (flags >> IORING_CQE_BUFFER_SHIFT); }
+			};
+
+			//! sets up a ring with (at least) entries_ submission queue entries
+			explicit uring(unsigned entries_ = 256, unsigned flags_ = 0)
+			{
+				struct io_uring_params p {};
+				p.flags = flags_;
+
+				if ((_fd = (int) ::syscall(__NR_io_uring_setup, entries_, &p)) == -1)
+					throw std::runtime_error("uring: could not set up: errno: "
+						+ std::to_string(errno));
+
+				_sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+				_cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+				if (p.features & IORING_FEAT_SINGLE_MMAP)
+					_sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+
+				void* sq = ::mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+
+				if (sq == MAP_FAILED)
+					_fail("could not map submission queue");
+
+				_sq_ring = (unsigned char*) sq;
+
+				if (p.features & IORING_FEAT_SINGLE_MMAP) {
+					_cq_ring = _sq_ring;
+				} else {
+					void* cq = ::mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+
+					if (cq == MAP_FAILED)
+						_fail("could not map completion queue");
+
+					_cq_ring = (unsigned char*) cq;
+				}
+
+				_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+				void* sqes = ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+
+				if (sqes == MAP_FAILED)
+					_fail("could not map submission queue entries");
+
+				_sqes = (struct io_uring_sqe*) sqes;
+
+				_sq_head    = (unsigned*) (_sq_ring + p.sq_off.head);
+				_sq_tail    = (unsigned*) (_sq_ring + p.sq_off.tail);
+				_sq_mask    = *(unsigned*) (_sq_ring + p.sq_off.ring_mask);
+				_sq_entries = p.sq_entries;
+				_cq_head    = (unsigned*) (_cq_ring + p.cq_off.head);
+				_cq_tail    = (unsigned*) (_cq_ring + p.cq_off.tail);
+				_cq_mask    = *(unsigned*) (_cq_ring + p.cq_off.ring_mask);
+				_cqes       = (struct io_uring_cqe*) (_cq_ring + p.cq_off.cqes);
+
+				// submission queue slots map 1:1 to entries
+				auto* array = (unsigned*) (_sq_ring + p.sq_off.array);
+
+				for (unsigned i = 0; i < _sq_entries; i++)
+					array[i] = i;
+
+				_sq_local_tail = *_sq_tail;
+			}
+
+			uring(const uring&) = delete;
+			uring& operator=(const uring&) = delete;
+
+			bool prep_recv(int fd_, void* buf_, unsigned len_, uint64_t user_data_, int flags_ = 0)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_RECV, fd_, buf_, len_, 0, user_data_);
+
+				if (sqe)
+					sqe->msg_flags = (uint32_t) flags_;
+
+				return sqe != nullptr;
+			}
+
+			bool prep_send(int fd_, const void* buf_, unsigned len_, uint64_t user_data_,
+				int flags_ = 0)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_SEND, fd_, buf_, len_, 0, user_data_);
+
+				if (sqe)
+					sqe->msg_flags = (uint32_t) flags_;
+
+				return sqe != nullptr;
+			}
+
+			//! accepts a connection, the completion result is the new file descriptor
+			bool prep_accept(int fd_, uint64_t user_data_, int flags_ = SOCK_NONBLOCK | SOCK_CLOEXEC)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_ACCEPT, fd_, nullptr, 0, 0, user_data_);
+
+				if (sqe)
+					sqe->accept_flags = (uint32_t) flags_;
+
+				return sqe != nullptr;
+			}
+
+			bool prep_read(int fd_, void* buf_, unsigned len_, uint64_t offset_, uint64_t user_data_)
+			{
+				return _prep(IORING_OP_READ, fd_, buf_, len_, offset_, user_data_) != nullptr;
+			}
+
+			bool prep_write(int fd_, const void* buf_, unsigned len_, uint64_t offset_,
+				uint64_t user_data_)
+			{
+				return _prep(IORING_OP_WRITE, fd_, buf_, len_, offset_, user_data_) != nullptr;
+			}
+
+			//! reads into a buffer registered with register_buffers()
+			bool prep_read_fixed(int fd_, void* buf_, unsigned len_, uint64_t offset_,
+				uint16_t buf_index_, uint64_t user_data_)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_READ_FIXED, fd_, buf_, len_, offset_,
+					user_data_);
+
+				if (sqe)
+					sqe->buf_index = buf_index_;
+
+				return sqe != nullptr;
+			}
+
+			//! writes from a buffer registered with register_buffers()
+			bool prep_write_fixed(int fd_, const void* buf_, unsigned len_, uint64_t offset_,
+				uint16_t buf_index_, uint64_t user_data_)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_WRITE_FIXED, fd_, buf_, len_, offset_,
+					user_data_);
+
+				if (sqe)
+					sqe->buf_index = buf_index_;
+
+				return sqe != nullptr;
+			}
+
+			//! hands count_ buffers of len_ bytes starting at addr_ to the kernel as buffer group
+			//! group_, with ids starting at start_id_
+			bool prep_provide_buffers(void* addr_, unsigned len_, unsigned count_, uint16_t group_,
+				uint16_t start_id_, uint64_t user_data_)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_PROVIDE_BUFFERS, (int) count_, addr_,
+					len_, start_id_, user_data_);
+
+				if (sqe)
+					sqe->buf_group = group_;
+
+				return sqe != nullptr;
+			}
+
+#ifdef IORING_RECV_MULTISHOT
+			//! receives repeatedly into buffers picked from buffer group group_
+			//!
+			//! Every datagram or read posts a completion with more() set until the request ends,
+			//! e.g. because the group ran out of buffers (-ENOBUFS).
+			bool prep_recv_multishot(int fd_, uint16_t group_, uint64_t user_data_, int flags_ = 0)
+			{
+				struct io_uring_sqe* sqe = _prep(IORING_OP_RECV, fd_, nullptr, 0, 0, user_data_);
+
+				if (sqe) {
+					sqe->msg_flags = (uint32_t) flags_;
+					sqe->flags    |= IOSQE_BUFFER_SELECT;
+					sqe->buf_group = group_;
+					sqe->ioprio   |= IORING_RECV_MULTISHOT;
+				}
+
+				return sqe != nullptr;
+			}
+#endif
+
+			//! adds IOSQE_* flags (e.g. IOSQE_FIXED_FILE, IOSQE_IO_LINK) to the last prepared entry
+			void set_flags(uint8_t flags_)
+			{
+				if (_last)
+					_last->flags |= flags_;
+			}
+
+			//! registers buffers for prep_read_fixed() and prep_write_fixed()
+			void register_buffers(const struct iovec* iov_, unsigned count_)
+			{
+				_register(IORING_REGISTER_BUFFERS, iov_, count_, "could not register buffers");
+			}
+
+			void unregister_buffers()
+			{
+				_register(IORING_UNREGISTER_BUFFERS, nullptr, 0, "could not unregister buffers");
+			}
+
+			//! registers files, fixed-file operations then pass the index instead of the fd
+			void register_files(const int* fds_, unsigned count_)
+			{
+				_register(IORING_REGISTER_FILES, fds_, count_, "could not register files");
+			}
+
+			void unregister_files()
+			{
+				_register(IORING_UNREGISTER_FILES, nullptr, 0, "could not unregister files");
+			}
+
+			//! returns the number of entries that can be prepared before submitting
+			unsigned sq_space_left() const
+			{
+				return _sq_entries - (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE));
+			}
+
+			//! submits all prepared entries and waits for at least wait_nr_ completions, returns
+			//! the number of entries submitted
+			unsigned submit(unsigned wait_nr_ = 0)
+			{
+				unsigned to_submit = _sq_local_tail - *_sq_tail;
+				__atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+				_last = nullptr;
+
+				if (to_submit == 0 && wait_nr_ == 0)
+					return 0;
+
+				for (;;) {
+					int r = (int) ::syscall(__NR_io_uring_enter, _fd, to_submit, wait_nr_,
+						wait_nr_ ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+					if (r >= 0)
+						return (unsigned) r;
+
+					if (errno != EINTR)
+						throw std::runtime_error("uring: could not submit: errno: "
+							+ std::to_string(errno));
+				}
+			}
+
+			//! calls handler_(const completion&) for every available completion, returns the
+			//! number of completions handled
+			template <typename Handler>
+			unsigned complete(Handler handler_)
+			{
+				unsigned head  = *_cq_head;
+				unsigned tail  = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+				unsigned count = 0;
+
+				for (; head != tail; head++, count++) {
+					const struct io_uring_cqe& cqe = _cqes[head & _cq_mask];
+
+					completion c;
+					c.user_data = cqe.user_data;
+					c.res       = cqe.res;
+					c.flags     = cqe.flags;
+
+					// release the entry before calling the handler, which may submit again
+					__atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+					handler_(c);
+				}
+
+				return count;
+			}
+
+			//! submits all prepared entries, waits for at least min_ completions and handles all
+			//! available completions
+			template <typename Handler>
+			unsigned wait(Handler handler_, unsigned min_ = 1)
+			{
+				unsigned ready = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE) - *_cq_head;
+				submit(ready >= min_ ? 0 : min_ - ready);
+				return complete(handler_);
+			}
+
+			void close()
+			{
+				if (_sqes)
+					::munmap(_sqes, _sqes_size);
+
+				if (_cq_ring && _cq_ring != _sq_ring)
+					::munmap(_cq_ring, _cq_ring_size);
+
+				if (_sq_ring)
+					::munmap(_sq_ring, _sq_ring_size);
+
+				_sqes    = nullptr;
+				_sq_ring = _cq_ring = nullptr;
+
+				if (_fd != -1) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+
+			~uring()
+			{
+				close();
+			}
+
+		private:
+			unsigned char* _sq_ring   = nullptr;
+			unsigned char* _cq_ring   = nullptr;
+			struct io_uring_sqe* _sqes = nullptr;
+			struct io_uring_cqe* _cqes = nullptr;
+			struct io_uring_sqe* _last = nullptr;
+			std::size_t _sq_ring_size = 0;
+			std::size_t _cq_ring_size = 0;
+			std::size_t _sqes_size    = 0;
+			unsigned* _sq_head        = nullptr;
+			unsigned* _sq_tail        = nullptr;
+			unsigned* _cq_head        = nullptr;
+			unsigned* _cq_tail        = nullptr;
+			unsigned _sq_mask         = 0;
+			unsigned _cq_mask         = 0;
+			unsigned _sq_entries      = 0;
+			unsigned _sq_local_tail   = 0;
+
+			struct io_uring_sqe* _prep(uint8_t op_, int fd_, const void* addr_, unsigned len_,
+				uint64_t offset_, uint64_t user_data_)
+			{
+				if (sq_space_left() == 0)
+					return nullptr;
+
+				struct io_uring_sqe* sqe = &_sqes[_sq_local_tail++ & _sq_mask];
+				std::memset(sqe, 0, sizeof(*sqe));
+				sqe->opcode    = op_;
+				sqe->fd        = fd_;
+				sqe->addr      = (uint64_t) (uintptr_t) addr_;
+				sqe->len       = len_;
+				sqe->off       = offset_;
+				sqe->user_data = user_data_;
+				return (_last = sqe);
+			}
+
+			void _register(unsigned opcode_, const void* arg_, unsigned count_, const char* what_)
+			{
+				if (::syscall(__NR_io_uring_register, _fd, opcode_, arg_, count_) == -1)
+					throw std::runtime_error(std::string("uring: ") + what_ + ": errno: "
+						+ std::to_string(errno));
+			}
+
+			void _fail(const std::string& what_)
+			{
+				int err = errno;
+				close();
+				throw std::runtime_error("uring: " + what_ + ": errno: " + std::to_string(err));
+			}
+		};
+#endif
+
+#if defined(OM_HAVE_COROUTINES) && defined(__linux__)
+		template<typename T = void>
+		class task;
+
+		//! the part of a task promise that does not depend on the result type
+		class _task_promise_base
+		{
+		public:
+			//! resumes the awaiting coroutine by symmetric transfer, so chains of awaited tasks
+			//! do not grow the stack
+			struct final_awaiter
+			{
+				bool await_ready() const noexcept { return false; }
+
+				template<typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h_) noexcept
+				{
+					auto continuation = h_.promise()._continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept { }
+			};
+
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			final_awaiter final_suspend() const noexcept { return {}; }
+			void unhandled_exception() noexcept { _exception = std::current_exception(); }
+
+			std::coroutine_handle<> _continuation;
+			std::exception_ptr _exception;
+		};
+
+		template<typename T>
+		class _task_promise : public _task_promise_base
+		{
+		public:
+			task<T> get_return_object() noexcept;
+
+			void return_value(T value_)
+			{
+				_value.emplace(std::move(value_));
+			}
+
+			T result()
+			{
+				if (_exception)
+					std::rethrow_exception(_exception);
+
+				return std::move(*_value);
+			}
+
+		private:
+			std::optional<T> _value;
+		};
+
+		template<>
+		class _task_promise<void> : public _task_promise_base
+		{
+		public:
+			task<void> get_return_object() noexcept;
+
+			void return_void() noexcept { }
+
+			void result()
+			{
+				if (_exception)
+					std::rethrow_exception(_exception);
+			}
+		};
+
+		//! a lazily started coroutine that produces a T
+		//!
+		//! A task starts when it is awaited and resumes its awaiter when it completes. Awaiting
+		//! a task never allocates, only creating the coroutine frame does.
+		template<typename T>
+		class task
+		{
+		public:
+			using promise_type = _task_promise<T>;
+			using handle_type  = std::coroutine_handle<promise_type>;
+
+			task(task&& other_) noexcept : _handle(std::exchange(other_._handle, nullptr)) { }
+
+			task& operator=(task&& other_) noexcept
+			{
+				if (this != &other_) {
+					if (_handle)
+						_handle.destroy();
+
+					_handle = std::exchange(other_._handle, nullptr);
+				}
+
+				return *this;
+			}
+
+			task(const task&) = delete;
+			task& operator=(const task&) = delete;
+
+			//! returns true if the coroutine has run to completion
+			bool done() const
+			{
+				return !_handle || _handle.done();
+			}
+
+			auto operator co_await() const noexcept
+			{
+				struct awaiter
+				{
+					handle_type handle;
+
+					bool await_ready() const noexcept
+					{
+						return !handle || handle.done();
+					}
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting_) noexcept
+					{
+						handle.promise()._continuation = awaiting_;
+						return handle;
+					}
+
+					T await_resume()
+					{
+						return handle.promise().result();
+					}
+				};
+
+				return awaiter { _handle };
+			}
+
+			~task()
+			{
+				if (_handle)
+					_handle.destroy();
+			}
+
+		private:
+			friend class _task_promise<T>;
+
+			template<typename U>
+			friend U block_on(reactor& reactor_, task<U> task_);
+
+			handle_type _handle;
+
+			explicit task(handle_type handle_) : _handle(handle_) { }
+		};
+
+		template<typename T>
+		task<T> _task_promise<T>::get_return_object() noexcept
+		{
+			return task<T>(std::coroutine_handle<_task_promise<T>>::from_promise(*this));
+		}
+
+		inline task<void> _task_promise<void>::get_return_object() noexcept
+		{
+			return task<void>(std::coroutine_handle<_task_promise<void>>::from_promise(*this));
+		}
+
+		//! the coroutine type of spawn(), it starts immediately and frees itself when done
+		struct _detached
+		{
+			struct promise_type
+			{
+				_detached get_return_object() const noexcept { return {}; }
+				std::suspend_never initial_suspend() const noexcept { return {}; }
+				std::suspend_never final_suspend() const noexcept { return {}; }
+				void return_void() const noexcept { }
+				void unhandled_exception() const noexcept { std::terminate(); }
+			};
+		};
+
+		//! starts task_ and lets it run to completion on its own, an escaping exception
+		//! terminates the program
+		inline _detached spawn(task<void> task_)
+		{
+			co_await task_;
+		}
+
+		//! starts task_ and runs reactor_ until the task is done, returns its result
+		template<typename T>
+		T block_on(reactor& reactor_, task<T> task_)
+		{
+			task_._handle.resume();
+
+			while (!task_._handle.done())
+				reactor_.run_once(-1);
+
+			return task_._handle.promise().result();
+		}
+
+		//! a non-blocking fd registered (edge-triggered) with a reactor, with awaitable I/O
+		//!
+		//! Operations first try the system call and only suspend if it would block, the
+		//! awaiters live in the awaiting coroutine's frame. At most one read-side and one
+		//! write-side operation may be pending at a time. The fd is not closed.
+		class async_fd
+		{
+		public:
+			async_fd(reactor& reactor_, int fd_) : _reactor(reactor_), _fd(fd_)
+			{
+				sys::set_nonblocking(_fd);
+				_reactor.add(_fd, reactor::in | reactor::out | reactor::hangup,
+					[this](int, uint32_t events_) { _on_ready(events_); }, reactor::trigger::edge);
+			}
+
+			async_fd(reactor& reactor_, const sys::file_descriptor& fd_)
+				: async_fd(reactor_, fd_.fd()) { }
+
+			async_fd(const async_fd&) = delete;
+			async_fd& operator=(const async_fd&) = delete;
+
+			int fd() const
+			{
+				return _fd;
+			}
+
+			//! the base of all awaitable operations
+			class operation
+			{
+			public:
+				bool await_ready()
+				{
+					_result = _attempt();
+					return !_result.would_block();
+				}
+
+				void await_suspend(std::coroutine_handle<> handle_)
+				{
+					_handle = handle_;
+					(_write ? _owner->_writer : _owner->_reader) = this;
+				}
+
+				sys::io_result await_resume() const
+				{
+					return _result;
+				}
+
+			protected:
+				async_fd* _owner;
+
+				operation(async_fd* owner_, bool write_) : _owner(owner_), _write(write_) { }
+
+				//! performs the system call, returns EAGAIN to keep waiting
+				virtual sys::io_result _attempt() = 0;
+
+			private:
+				friend class async_fd;
+
+				bool _write;
+				sys::io_result _result;
+				std::coroutine_handle<> _handle;
+			};
+
+			//! reads up to len_ bytes, the result holds the byte count (0 at end of stream)
+			auto read(void* buf_, std::size_t len_)
+			{
+				struct op : operation
+				{
+					void* buf;
+					std::size_t len;
+
+					op(async_fd* owner_, void* buf_, std::size_t len_)
+						: operation(owner_, false), buf(buf_), len(len_) { }
+
+					sys::io_result _attempt() override
+					{
+						return sys::io_result::from_read(::read(_owner->_fd, buf, len));
+					}
+				};
+
+				return op(this, buf_, len_);
+			}
+
+			//! writes up to len_ bytes, the result holds the byte count
+			auto write(const void* buf_, std::size_t len_)
+			{
+				struct op : operation
+				{
+					const void* buf;
+					std::size_t len;
+
+					op(async_fd* owner_, const void* buf_, std::size_t len_)
+						: operation(owner_, true), buf(buf_), len(len_) { }
+
+					sys::io_result _attempt() override
+					{
+						ssize_t r = ::send(_owner->_fd, buf, len, MSG_NOSIGNAL);
+
+						// not a socket, e.g. a pipe
+						if (r == -1 && errno == ENOTSOCK)
+							r = ::write(_owner->_fd, buf, len);
+
+						return sys::io_result::from(r);
+					}
+				};
+
+				return op(this, buf_, len_);
+			}
+
+			//! accepts a connection on a listening socket, the result holds the new
+			//! (non-blocking) fd
+			auto accept()
+			{
+				struct op : operation
+				{
+					explicit op(async_fd* owner_) : operation(owner_, false) { }
+
+					sys::io_result _attempt() override
+					{
+						return sys::io_result::from(::accept4(_owner->_fd, nullptr, nullptr,
+							SOCK_NONBLOCK | SOCK_CLOEXEC));
+					}
+				};
+
+				return op(this);
+			}
+
+			//! waits until the fd is readable
+			auto readable()
+			{
+				return _wait_op(this, POLLIN, false);
+			}
+
+			//! waits until the fd is writable, e.g. for a non-blocking connect() to finish
+			auto writable()
+			{
+				return _wait_op(this, POLLOUT, true);
+			}
+
+			~async_fd()
+			{
+				_reactor.remove(_fd);
+			}
+
+		private:
+			reactor& _reactor;
+			int _fd;
+			operation* _reader = nullptr;
+			operation* _writer = nullptr;
+
+			struct _wait_op : operation
+			{
+				short events;
+
+				_wait_op(async_fd* owner_, short events_, bool write_)
+					: operation(owner_, write_), events(events_) { }
+
+				sys::io_result _attempt() override
+				{
+					struct pollfd pfd { _owner->_fd, events, 0 };
+					return ::poll(&pfd, 1, 0) == 1 ? sys::io_result() : sys::io_result(0, EAGAIN);
+				}
+			};
+
+			void _on_ready(uint32_t events_)
+			{
+				std::coroutine_handle<> reader, writer;
+
+				// retry the pending operations, they only complete if they no longer block
+				if (_reader && (events_ & ~(uint32_t) reactor::out)) {
+					_reader->_result = _reader->_attempt();
+
+					if (!_reader->_result.would_block()) {
+						reader = _reader->_handle;
+						_reader = nullptr;
+					}
+				}
+
+				if (_writer && (events_ & ~(uint32_t) reactor::in)) {
+					_writer->_result = _writer->_attempt();
+
+					if (!_writer->_result.would_block()) {
+						writer = _writer->_handle;
+						_writer = nullptr;
+					}
+				}
+
+				// resuming may destroy this async_fd, do not touch members from here on
+				if (reader)
+					reader.resume();
+
+				if (writer)
+					writer.resume();
+			}
+		};
+
+		//! suspends the awaiting coroutine for ms_ milliseconds on reactor_'s timer wheel
+		class sleep_for
+		{
+		public:
+			sleep_for(reactor& reactor_, uint64_t ms_) : _reactor(reactor_), _ms(ms_) { }
+
+			bool await_ready() const noexcept
+			{
+				return _ms == 0;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle_)
+			{
+				// the resumed coroutine destroys this awaiter and with it the timer whose callback
+				// would still be running, so the resume is posted to run after the callback
+				reactor* r = &_reactor;
+				_timer.set_callback([r, handle_](timer&) { r->post([handle_]() { handle_.resume(); }); });
+				_reactor.schedule(_timer, _ms);
+			}
+
+			void await_resume() const noexcept { }
+
+		private:
+			reactor& _reactor;
+			uint64_t _ms;
+			timer _timer;
+		};
+
+#ifdef OM_HAVE_IO_URING
+		//! awaitable file reads through an io_uring whose completions are delivered by a reactor
+		class file_reader
+		{
+		public:
+			explicit file_reader(reactor& reactor_, unsigned entries_ = 64)
+				: _reactor(reactor_), _ring(entries_)
+			{
+				_reactor.add(_ring.fd(), reactor::in, [this](int, uint32_t) {
+					_ring.complete([](const uring::completion& c_) {
+						auto* op = (read_op*) c_.user_data;
+						op->_res = c_.res;
+						op->_handle.resume();
+					});
+				});
+			}
+
+			file_reader(const file_reader&) = delete;
+			file_reader& operator=(const file_reader&) = delete;
+
+			class read_op
+			{
+			public:
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				//! returns false, resuming right away with EBUSY, if the submission queue stays full
+				bool await_suspend(std::coroutine_handle<> handle_)
+				{
+					_handle = handle_;
+
+					if (!_owner->_ring.prep_read(_fd, _buf, _len, _offset, (uint64_t) this)) {
+						_owner->_ring.submit();
+
+						if (!_owner->_ring.prep_read(_fd, _buf, _len, _offset, (uint64_t) this)) {
+							_res = -EBUSY;
+							return false;
+						}
+					}
+
+					_owner->_ring.submit();
+					return true;
+				}
+
+				//! returns the byte count or the error
+				sys::io_result await_resume() const
+				{
+					return _res < 0 ? sys::io_result(0, -_res) : sys::io_result::from_read(_res);
+				}
+
+			private:
+				friend class file_reader;
+
+				read_op(file_reader* owner_, int fd_, void* buf_, unsigned len_, uint64_t offset_)
+					: _owner(owner_), _fd(fd_), _buf(buf_), _len(len_), _offset(offset_) { }
+
+				file_reader* _owner;
+				int _fd;
+				void* _buf;
+				unsigned _len;
+				uint64_t _offset;
+				int _res = 0;
+				std::coroutine_handle<> _handle;
+			};
+
+			//! reads up to len_ bytes at offset_ of fd_
+			read_op read(int fd_, void* buf_, unsigned len_, uint64_t offset_)
+			{
+				return read_op(this, fd_, buf_, len_, offset_);
+			}
+
+			~file_reader()
+			{
+				_reactor.remove(_ring.fd());
+			}
+
+		private:
+			reactor& _reactor;
+			uring _ring;
+		};
+#endif
+#endif
+	}
+
+	namespace file {
+
+		inline unsigned long size(const std::string& file_name_)
+		{
+			struct stat st {};
+
+			if (stat(file_name_.c_str(), &st) < 0)
+				throw std::runtime_error("size: could not determine file size: errno: "
+										 + std::to_string(errno));
+
+			return (unsigned long)(st.st_size);
+		}
+
+		class _file_stream
+		{
+		public:
+			//! opens a file in the specified openmode, throws std::runtime_error upon error
+			explicit _file_stream(const std::string& file_name_, std::ios::openmode open_mode_)
+				: _stream(file_name_, open_mode_)
+			{
+				if (!_stream.is_open())
+					throw std::runtime_error("om::file::_file_stream: could not open " +file_name_);
+			}
+
+			//! closes the underlying file
+			virtual void close()
+			{
+				_stream.close();
+			}
+
+			//! closes the underlying file if it is open
+			virtual ~_file_stream()
+			{
+				if (_stream.is_open())
+					_stream.close();
+			}
+
+		protected:
+
+			//! returns true if the file pointer was advanced beyond the end of the file
+			bool _eof()
+			{
+				return _stream.tellg() == std::istream::pos_type(-1);
+			}
+
+			//! sets the read cursor to the beginning of the file
+			void _reset()
+			{
+				_stream.clear();
+				_stream.seekg(0, std::ios::beg);
+			}
+
+			std::fstream _stream;
+		};
 
 		template <typename T>
 		class simple_binary_reader : public _file_stream
 		{
 		public:
-			explicit simple_binary_reader(const std::string& file_name_, bool use_buffer_ = false)
-				: _file_stream(file_name_, std::ios::binary | std::ios::in),
-				  _use_buffer(use_buffer_),
-				  _data()
+			explicit simple_binary_reader(const std::string& file_name_, bool use_buffer_ = false)
+				: _file_stream(file_name_, std::ios::binary | std::ios::in),
+				  _use_buffer(use_buffer_),
+				  _data()
+
+			{
+				T t;
+
+				if (_use_buffer) {
+					while (!_eof()) {
+						_stream.read((char*) &t, sizeof(T));
+						_data.push_back(t);
+					}
+					_iter = std::begin(_data);
+				}
+			}
+
+			bool next(T& t_)
+			{
+				if (_use_buffer)
+					t_ = *(_iter++);
+				else
+					_stream.read((char*) &t_, sizeof(T));
+
+				return !done();
+			}
+
+			void reset()
+			{
+				if (_use_buffer)
+					_iter = std::begin(_data);
+				else
+					_reset();
+			}
+
+			bool done()
+			{
+				return _use_buffer ? _iter == _data.end() : _eof();
+			}
+
+			virtual ~simple_binary_reader() = default;
+
+		private:
+			bool _use_buffer;
+			std::vector<T> _data;
+			typename std::vector<T>::const_iterator _iter;
+		};
+
+		template <typename T>
+		class simple_binary_writer : public _file_stream
+		{
+		public:
+			explicit simple_binary_writer(const std::string& file_name_)
+				: _file_stream(file_name_, std::ios::binary | std::ios::out) { }
+
+			//! writes t_ to the file
+			void write(const T& t_)
+			{
+				_stream.write((char*)&t_, sizeof(T));
+			}
+		};
+
+		//! a captured packet as returned by the capture file readers
+		//!
+		//! data points into the reader's buffer and remains valid until the next call to next()
+		struct packet_record
+		{
+			const unsigned char* data = nullptr;
+			uint32_t caplen           = 0;
+			uint32_t len              = 0;
+			uint64_t timestamp        = 0; //!< nanoseconds since the unix epoch
+			uint32_t interface_id     = 0;
+			uint32_t flags            = 0; //!< epb_flags option, 0 if absent
+		};
+
+		//! pcapng block types and option codes (https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng)
+		namespace pcapng {
+			static const uint32_t SECTION_HEADER_BLOCK    = 0x0a0d0d0a;
+			static const uint32_t INTERFACE_DESCRIPTION   = 0x00000001;
+			static const uint32_t SIMPLE_PACKET_BLOCK     = 0x00000003;
+			static const uint32_t ENHANCED_PACKET_BLOCK   = 0x00000006;
+			static const uint32_t BYTE_ORDER_MAGIC        = 0x1a2b3c4d;
+
+			static const uint16_t OPT_END_OF_OPT          = 0;
+			static const uint16_t OPT_IF_NAME             = 2;
+			static const uint16_t OPT_IF_TSRESOL          = 9;
+			static const uint16_t OPT_IF_TSOFFSET         = 14;
+			static const uint16_t OPT_EPB_FLAGS           = 2;
+
+			//! an interface as described by an interface description block
+			struct interface
+			{
+				uint16_t link_type = 0;
+				uint32_t snaplen   = 0;
+				uint8_t  tsresol   = 6; //!< if_tsresol, defaults to microseconds
+				int64_t  tsoffset  = 0; //!< if_tsoffset in seconds
+				std::string name   = "";
+			};
+
+			//! returns false for resolutions finer than 10^-19 or 2^-63 seconds, whose scale factors
+			//! do not fit in 64 bits
+			inline bool valid_tsresol(uint8_t tsresol_)
+			{
+				return tsresol_ & 0x80 ? (tsresol_ & 0x7f) <= 63 : tsresol_ <= 19;
+			}
+
+			//! converts a timestamp in units of tsresol_ to nanoseconds, see valid_tsresol()
+			inline uint64_t to_nanoseconds(uint64_t ts_, uint8_t tsresol_)
+			{
+				if (tsresol_ & 0x80)
+					return (uint64_t) (((unsigned __int128) ts_ * 1000000000) >> (tsresol_ & 0x7f));
+
+				uint64_t f = 1;
+
+				if (tsresol_ <= 9) {
+					for (unsigned i = tsresol_; i < 9; i++) f *= 10;
+					return ts_ * f;
+				}
+
+				for (unsigned i = 9; i < tsresol_; i++) f *= 10;
+				return ts_ / f;
+			}
+
+			//! converts a timestamp in nanoseconds to units of tsresol_, see valid_tsresol()
+			inline uint64_t from_nanoseconds(uint64_t ns_, uint8_t tsresol_)
+			{
+				if (tsresol_ & 0x80)
+					return (uint64_t) (((unsigned __int128) ns_ << (tsresol_ & 0x7f)) / 1000000000);
+
+				uint64_t f = 1;
+
+				if (tsresol_ <= 9) {
+					for (unsigned i = tsresol_; i < 9; i++) f *= 10;
+					return ns_ / f;
+				}
+
+				for (unsigned i = 9; i < tsresol_; i++) f *= 10;
+				return ns_ * f;
+			}
+		}
+
+		//! base class for capture file readers, either memory-maps a file or reads it in chunks
+		class _capture_file_reader : public sys::file_descriptor
+		{
+		public:
+			enum class mode { mmap, chunked };
+
+			_capture_file_reader(const _capture_file_reader&) = delete;
+			_capture_file_reader& operator=(const _capture_file_reader&) = delete;
+
+			//! returns true once all records have been read
+			bool done() const
+			{
+				return _done;
+			}
+
+			//! returns true if record data points into the memory-mapped file, where it stays
+			//! valid until the reader is closed, rather than into a buffer reused by next()
+			bool mapped() const
+			{
+				return _mode == mode::mmap;
+			}
+
+			void close()
+			{
+				if (_map) {
+					::munmap((void*) _map, _size);
+					_map = nullptr;
+				}
+
+				if (_fd != -1) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+
+			virtual ~_capture_file_reader()
+			{
+				close();
+			}
+
+		protected:
+			//! opens file_name_, throws std::runtime_error upon error
+			_capture_file_reader(const std::string& file_name_, mode mode_, std::size_t chunk_size_,
+				const std::string& name_)
+				: _name(name_), _mode(mode_), _chunk_size(chunk_size_ < 64 ? 64 : chunk_size_)
+			{
+				if ((_fd = ::open(file_name_.c_str(), O_RDONLY)) == -1)
+					throw std::runtime_error(_name + ": could not open " + file_name_);
+
+				if (_mode == mode::mmap) {
+					struct stat st {};
+
+					if (::fstat(_fd, &st) == -1) {
+						close();
+						throw std::runtime_error(_name + ": could not stat " + file_name_);
+					}
+
+					_size = (std::size_t) st.st_size;
+
+					if (_size > 0) {
+						void* map = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+						if (map == MAP_FAILED) {
+							close();
+							throw std::runtime_error(_name + ": could not map " + file_name_
+								+ ": errno: " + std::to_string(errno));
+						}
+
+						::madvise(map, _size, MADV_SEQUENTIAL);
+						_map = (const unsigned char*) map;
+					}
+				} else {
+					_buf.resize(_chunk_size);
+				}
+			}
+
+			//! makes len_ bytes available at the read cursor, returns nullptr at end of file
+			const unsigned char* _ensure(std::size_t len_)
+			{
+				if (_mode == mode::mmap)
+					return _pos + len_ <= _size ? _map + _pos : nullptr;
+
+				if (_end - _pos >= len_)
+					return _buf.data() + _pos;
+
+				if (_pos > 0) {
+					std::memmove(_buf.data(), _buf.data() + _pos, _end - _pos);
+					_end -= _pos;
+					_pos  = 0;
+				}
+
+				if (len_ > _buf.size())
+					_buf.resize(len_ + _chunk_size);
+
+				while (!_eof && _end < len_) {
+					ssize_t r = ::read(_fd, _buf.data() + _end, _buf.size() - _end);
+
+					if (r == -1 && errno == EINTR)
+						continue;
+
+					if (r == -1)
+						throw std::runtime_error(_name + ": could not read: errno: "
+							+ std::to_string(errno));
+
+					if (r == 0)
+						_eof = true;
+
+					_end += (std::size_t) r;
+				}
+
+				return _end >= len_ ? _buf.data() : nullptr;
+			}
+
+			//! returns the number of bytes left in the file after _ensure() returned nullptr
+			std::size_t _remaining() const
+			{
+				return _mode == mode::mmap ? _size - _pos : _end - _pos;
+			}
+
+			//! sets the read cursor to the beginning of the file
+			void _rewind()
+			{
+				if (_mode == mode::chunked) {
+					::lseek(_fd, 0, SEEK_SET);
+					_end = 0;
+					_eof = false;
+				}
+
+				_pos  = 0;
+				_done = false;
+			}
+
+			static uint32_t _raw_u32(const unsigned char* buf_)
+			{
+				uint32_t v;
+				std::memcpy(&v, buf_, sizeof(v));
+				return v;
+			}
+
+			uint16_t _u16(const unsigned char* buf_) const
+			{
+				uint16_t v;
+				std::memcpy(&v, buf_, sizeof(v));
+				return _swap ? __builtin_bswap16(v) : v;
+			}
+
+			uint32_t _u32(const unsigned char* buf_) const
+			{
+				uint32_t v = _raw_u32(buf_);
+				return _swap ? __builtin_bswap32(v) : v;
+			}
+
+			uint64_t _u64(const unsigned char* buf_) const
+			{
+				uint64_t v;
+				std::memcpy(&v, buf_, sizeof(v));
+				return _swap ? __builtin_bswap64(v) : v;
+			}
+
+			std::string _name;
+			mode _mode;
+			std::size_t _chunk_size;
+			const unsigned char* _map = nullptr;
+			std::size_t _size = 0;
+			std::vector<unsigned char> _buf;
+			std::size_t _pos  = 0;
+			std::size_t _end  = 0;
+			bool _eof         = false;
+			bool _done        = false;
+			bool _swap        = false;
+		};
+
+		//! a streaming reader for pcapng capture files
+		//!
+		//! Handles multiple sections of either byte order as well as section header, interface
+		//! description, enhanced packet and simple packet blocks. All other blocks are skipped.
+		//! The file is either memory-mapped or read in chunks into an internal buffer.
+		class pcapng_reader : public _capture_file_reader
+		{
+		public:
+			//! opens a pcapng file, throws std::runtime_error upon error
+			explicit pcapng_reader(const std::string& file_name_, mode mode_ = mode::mmap,
+				std::size_t chunk_size_ = 1 << 20)
+				: _capture_file_reader(file_name_, mode_, chunk_size_, "om::file::pcapng_reader")
+			{
+				const unsigned char* hdr = _ensure(12);
+
+				if (!hdr || _raw_u32(hdr) != pcapng::SECTION_HEADER_BLOCK) {
+					close();
+					throw std::runtime_error("om::file::pcapng_reader: not a pcapng file: "
+						+ file_name_);
+				}
+			}
+
+			//! reads the next packet record, returns false if there are no more packets
+			bool next(packet_record& rec_)
+			{
+				while (!_done) {
+					const unsigned char* b = _ensure(12);
+
+					if (!b && _remaining() > 0)
+						_truncated();
+
+					if (!b) break;
+
+					uint32_t type = _raw_u32(b);
+
+					if (type == pcapng::SECTION_HEADER_BLOCK) {
+						uint32_t magic = _raw_u32(b + 8);
+
+						if (magic == pcapng::BYTE_ORDER_MAGIC)
+							_swap = false;
+						else if (magic == __builtin_bswap32(pcapng::BYTE_ORDER_MAGIC))
+							_swap = true;
+						else
+							throw std::runtime_error("om::file::pcapng_reader: invalid byte order");
+					} else {
+						type = _u32(b);
+					}
+
+					uint32_t block_len = _u32(b + 4);
+
+					if (block_len < 12 || block_len % 4 != 0)
+						throw std::runtime_error("om::file::pcapng_reader: invalid block length");
+
+					if (!(b = _ensure(block_len)))
+						_truncated();
+
+					_pos += block_len;
+
+					switch (type) {
+						case pcapng::SECTION_HEADER_BLOCK:
+							_interfaces.clear();
+							break;
+						case pcapng::INTERFACE_DESCRIPTION:
+							_read_interface(b, block_len);
+							break;
+						case pcapng::ENHANCED_PACKET_BLOCK:
+							if (_read_enhanced_packet(b, block_len, rec_))
+								return true;
+							break;
+						case pcapng::SIMPLE_PACKET_BLOCK:
+							if (_read_simple_packet(b, block_len, rec_))
+								return true;
+							break;
+						default:
+							break;
+					}
+				}
+
+				_done = true;
+				return false;
+			}
+
+			//! sets the read cursor to the beginning of the file
+			void reset()
+			{
+				_rewind();
+				_interfaces.clear();
+			}
+
+			//! returns the interfaces described in the current section so far
+			const std::vector<pcapng::interface>& interfaces() const
+			{
+				return _interfaces;
+			}
+
+		private:
+			std::vector<pcapng::interface> _interfaces;
+
+			[[noreturn]] void _truncated()
+			{
+				_done = true;
+				throw std::runtime_error("om::file::pcapng_reader: invalid block length");
+			}
+
+			//! calls f_(code, value, len) for each option in [begin_, end_)
+			template <typename F>
+			void _for_each_option(const unsigned char* begin_, const unsigned char* end_, F f_) const
+			{
+				while (begin_ + 4 <= end_) {
+					uint16_t code = _u16(begin_);
+					uint16_t len  = _u16(begin_ + 2);
+
+					if (code == pcapng::OPT_END_OF_OPT || begin_ + 4 + len > end_)
+						return;
+
+					f_(code, begin_ + 4, len);
+					begin_ += 4 + ((len + 3u) & ~3u);
+				}
+			}
+
+			void _read_interface(const unsigned char* b_, uint32_t len_)
+			{
+				if (len_ < 20)
+					throw std::runtime_error("om::file::pcapng_reader: invalid interface block");
+
+				pcapng::interface itf;
+				itf.link_type = _u16(b_ + 8);
+				itf.snaplen   = _u32(b_ + 12);
+
+				_for_each_option(b_ + 16, b_ + len_ - 4,
+					[this, &itf](uint16_t code_, const unsigned char* val_, uint16_t len_) {
+						if (code_ == pcapng::OPT_IF_TSRESOL && len_ >= 1)
+							itf.tsresol = val_[0];
+						else if (code_ == pcapng::OPT_IF_TSOFFSET && len_ >= 8)
+							itf.tsoffset = (int64_t) _u64(val_);
+						else if (code_ == pcapng::OPT_IF_NAME)
+							itf.name = std::string((const char*) val_, strnlen((const char*) val_, len_));
+					});
+
+				if (!pcapng::valid_tsresol(itf.tsresol))
+					throw std::runtime_error("om::file::pcapng_reader: invalid interface block");
+
+				_interfaces.push_back(std::move(itf));
+			}
+
+			bool _read_enhanced_packet(const unsigned char* b_, uint32_t len_, packet_record& rec_)
+			{
+				if (len_ < 32)
+					throw std::runtime_error("om::file::pcapng_reader: invalid packet block");
+
+				uint32_t if_id  = _u32(b_ + 8);
+				uint32_t caplen = _u32(b_ + 20);
+
+				if (if_id >= _interfaces.size() || caplen > len_ - 32)
+					throw std::runtime_error("om::file::pcapng_reader: invalid packet block");
+
+				const pcapng::interface& itf = _interfaces[if_id];
+				uint64_t ts = (uint64_t) _u32(b_ + 12) << 32 | _u32(b_ + 16);
+
+				rec_.data         = b_ + 28;
+				rec_.caplen       = caplen;
+				rec_.len          = _u32(b_ + 24);
+				rec_.timestamp    = pcapng::to_nanoseconds(ts, itf.tsresol)
+				                    + (uint64_t) itf.tsoffset * 1000000000;
+				rec_.interface_id = if_id;
+				rec_.flags        = 0;
+
+				_for_each_option(b_ + 28 + ((caplen + 3u) & ~3u), b_ + len_ - 4,
+					[this, &rec_](uint16_t code_, const unsigned char* val_, uint16_t len_) {
+						if (code_ == pcapng::OPT_EPB_FLAGS && len_ >= 4)
+							rec_.flags = _u32(val_);
+					});
+
+				return true;
+			}
+
+			bool _read_simple_packet(const unsigned char* b_, uint32_t len_, packet_record& rec_)
+			{
+				if (len_ < 16 || _interfaces.empty())
+					throw std::runtime_error("om::file::pcapng_reader: invalid simple packet block");
+
+				uint32_t snaplen = _interfaces[0].snaplen;
+
+				rec_.data         = b_ + 12;
+				rec_.len          = _u32(b_ + 8);
+				rec_.caplen       = std::min(rec_.len, len_ - 16);
+				rec_.caplen       = snaplen ? std::min(rec_.caplen, snaplen) : rec_.caplen;
+				rec_.timestamp    = 0;
+				rec_.interface_id = 0;
+				rec_.flags        = 0;
+				return true;
+			}
+		};
+
+		//! a streaming reader for classic pcap capture files (microsecond and nanosecond variants)
+		class pcap_reader : public _capture_file_reader
+		{
+		public:
+			static const uint32_t MAGIC_MICROSECONDS = 0xa1b2c3d4;
+			static const uint32_t MAGIC_NANOSECONDS  = 0xa1b23c4d;
+			static const uint32_t MAX_CAPLEN         = 256 * 1024; //!< largest record accepted
+
+			//! opens a pcap file, throws std::runtime_error upon error
+			explicit pcap_reader(const std::string& file_name_, mode mode_ = mode::mmap,
+				std::size_t chunk_size_ = 1 << 20)
+				: _capture_file_reader(file_name_, mode_, chunk_size_, "om::file::pcap_reader")
+			{
+				const unsigned char* hdr = _ensure(24);
+				uint32_t magic = hdr ? _raw_u32(hdr) : 0;
+
+				if (magic == MAGIC_MICROSECONDS || magic == MAGIC_NANOSECONDS) {
+					_swap = false;
+				} else if (magic == __builtin_bswap32(MAGIC_MICROSECONDS)
+					|| magic == __builtin_bswap32(MAGIC_NANOSECONDS)) {
+					_swap = true;
+				} else {
+					close();
+					throw std::runtime_error("om::file::pcap_reader: not a pcap file: " + file_name_);
+				}
+
+				_nanoseconds = _u32(hdr) == MAGIC_NANOSECONDS;
+				_snaplen     = _u32(hdr + 16);
+				_link_type   = _u32(hdr + 20);
+				_pos         = 24;
+			}
+
+			//! reads the next packet record, returns false if there are no more packets
+			bool next(packet_record& rec_)
+			{
+				const unsigned char* b = _done ? nullptr : _ensure(16);
+				uint32_t caplen = b ? _u32(b + 8) : 0;
+
+				// a corrupt length would otherwise make the chunked mode allocate up to 4 GiB, the
+				// snaplen is no bound since files commonly set it to 0xffffffff
+				if (caplen > MAX_CAPLEN) {
+					_done = true;
+					throw std::runtime_error("om::file::pcap_reader: invalid record length: "
+						+ std::to_string(caplen));
+				}
+
+				if (!b || !(b = _ensure(16 + caplen))) {
+					_done = true;
+					return false;
+				}
+
+				_pos += 16 + caplen;
+
+				rec_.data         = b + 16;
+				rec_.caplen       = caplen;
+				rec_.len          = _u32(b + 12);
+				rec_.timestamp    = (uint64_t) _u32(b) * 1000000000
+				                    + (uint64_t) _u32(b + 4) * (_nanoseconds ? 1 : 1000);
+				rec_.interface_id = 0;
+				rec_.flags        = 0;
+				return true;
+			}
+
+			//! sets the read cursor to the first record
+			void reset()
+			{
+				_rewind();
+				_ensure(24);
+				_pos = 24;
+			}
+
+			//! returns the link-layer header type of the file (1 for Ethernet)
+			uint32_t link_type() const
+			{
+				return _link_type;
+			}
+
+			uint32_t snaplen() const
+			{
+				return _snaplen;
+			}
+
+		private:
+			bool _nanoseconds   = false;
+			uint32_t _snaplen   = 0;
+			uint32_t _link_type = 0;
+		};
+
+		//! a block-buffered writer for pcapng capture files in host byte order
+		class pcapng_writer : public _file_stream
+		{
+		public:
+			//! creates a pcapng file and writes the section header block
+			explicit pcapng_writer(const std::string& file_name_, std::size_t buffer_size_ = 1 << 16)
+				: _file_stream(file_name_, std::ios::binary | std::ios::out | std::ios::trunc),
+				  _buffer_size(buffer_size_)
+			{
+				_buf.reserve(_buffer_size);
+
+				unsigned char* b = _begin_block(pcapng::SECTION_HEADER_BLOCK, 16);
+				_put_u32(b, pcapng::BYTE_ORDER_MAGIC);
+				_put_u16(b + 4, 1);
+				_put_u16(b + 6, 0);
+				_put_u32(b + 8, 0xffffffff); // section length unspecified
+				_put_u32(b + 12, 0xffffffff);
+				_end_block();
+			}
+
+			//! writes an interface description block and returns the interface id
+			uint32_t add_interface(uint16_t link_type_ = 1, uint32_t snaplen_ = 262144,
+				uint8_t tsresol_ = 9, const std::string& name_ = "")
+			{
+				if (!pcapng::valid_tsresol(tsresol_))
+					throw std::invalid_argument("om::file::pcapng_writer: invalid timestamp resolution");
+
+				std::size_t name_len = (name_.size() + 3u) & ~3u;
+				std::size_t opt_len  = 8 + (name_.empty() ? 0 : 4 + name_len) + 4;
+
+				unsigned char* b = _begin_block(pcapng::INTERFACE_DESCRIPTION, 8 + opt_len);
+				_put_u16(b, link_type_);
+				_put_u16(b + 2, 0);
+				_put_u32(b + 4, snaplen_);
+
+				b += 8;
+				_put_u16(b, pcapng::OPT_IF_TSRESOL);
+				_put_u16(b + 2, 1);
+				b[4] = tsresol_;
+				b += 8;
+
+				if (!name_.empty()) {
+					_put_u16(b, pcapng::OPT_IF_NAME);
+					_put_u16(b + 2, (uint16_t) name_.size());
+					std::memcpy(b + 4, name_.data(), name_.size());
+					b += 4 + name_len;
+				}
+
+				_put_u32(b, 0); // opt_endofopt
+				_end_block();
+
+				_tsresol.push_back(tsresol_);
+				return (uint32_t) _tsresol.size() - 1;
+			}
+
+			//! writes an enhanced packet block, len_ defaults to caplen_
+			void write(uint32_t interface_id_, uint64_t timestamp_, const unsigned char* data_,
+				uint32_t caplen_, uint32_t len_ = 0, uint32_t flags_ = 0)
+			{
+				if (interface_id_ >= _tsresol.size())
+					throw std::invalid_argument("om::file::pcapng_writer: unknown interface");
+
+				uint32_t pad_len = (caplen_ + 3u) & ~3u;
+				uint64_t ts = pcapng::from_nanoseconds(timestamp_, _tsresol[interface_id_]);
+
+				unsigned char* b = _begin_block(pcapng::ENHANCED_PACKET_BLOCK,
+					20 + pad_len + (flags_ ? 12 : 0));
+				_put_u32(b, interface_id_);
+				_put_u32(b + 4, (uint32_t) (ts >> 32));
+				_put_u32(b + 8, (uint32_t) ts);
+				_put_u32(b + 12, caplen_);
+				_put_u32(b + 16, len_ ? len_ : caplen_);
+				std::memcpy(b + 20, data_, caplen_);
+				b += 20 + pad_len;
+
+				if (flags_) {
+					_put_u16(b, pcapng::OPT_EPB_FLAGS);
+					_put_u16(b + 2, 4);
+					_put_u32(b + 4, flags_);
+					_put_u32(b + 8, 0); // opt_endofopt
+				}
+
+				_end_block();
+			}
+
+			//! writes a packet record as an enhanced packet block
+			void write(const packet_record& rec_)
+			{
+				write(rec_.interface_id, rec_.timestamp, rec_.data, rec_.caplen, rec_.len,
+					rec_.flags);
+			}
+
+			//! writes a simple packet block (refers to interface 0), len_ defaults to caplen_
+			void write_simple(const unsigned char* data_, uint32_t caplen_, uint32_t len_ = 0)
+			{
+				if (_tsresol.empty())
+					throw std::invalid_argument("om::file::pcapng_writer: unknown interface");
+
+				uint32_t pad_len = (caplen_ + 3u) & ~3u;
+				unsigned char* b = _begin_block(pcapng::SIMPLE_PACKET_BLOCK, 4 + pad_len);
+				_put_u32(b, len_ ? len_ : caplen_);
+				std::memcpy(b + 4, data_, caplen_);
+				_end_block();
+			}
+
+			//! writes all buffered blocks to the file
+			void flush()
+			{
+				if (!_buf.empty()) {
+					_stream.write((const char*) _buf.data(), _buf.size());
+					_buf.clear();
+				}
+
+				_stream.flush();
+
+				if (!_stream)
+					throw std::runtime_error("om::file::pcapng_writer: could not write");
+			}
+
+			//! flushes buffered blocks and closes the underlying file
+			void close() override
+			{
+				if (_stream.is_open()) {
+					flush();
+					_stream.close();
+				}
+			}
+
+			virtual ~pcapng_writer()
+			{
+				try { close(); } catch (...) { }
+			}
+
+		private:
+			std::size_t _buffer_size;
+			std::vector<unsigned char> _buf;
+			std::size_t _block_begin = 0;
+			std::vector<uint8_t> _tsresol;
+
+			//! appends a block header and returns a pointer to body_len_ zeroed body bytes
+			unsigned char* _begin_block(uint32_t type_, std::size_t body_len_)
+			{
+				if (!_buf.empty() && _buf.size() + body_len_ + 12 > _buffer_size)
+					flush();
+
+				_block_begin = _buf.size();
+				_buf.resize(_block_begin + body_len_ + 12, 0);
+				_put_u32(_buf.data() + _block_begin, type_);
+				_put_u32(_buf.data() + _block_begin + 4, (uint32_t) (body_len_ + 12));
+				return _buf.data() + _block_begin + 8;
+			}
+
+			void _end_block()
+			{
+				std::memcpy(_buf.data() + _buf.size() - 4, _buf.data() + _block_begin + 4, 4);
+
+				if (_buf.size() >= _buffer_size)
+					flush();
+			}
+
+			static void _put_u16(unsigned char* buf_, uint16_t val_)
+			{
+				std::memcpy(buf_, &val_, sizeof(val_));
+			}
+
+			static void _put_u32(unsigned char* buf_, uint32_t val_)
+			{
+				std::memcpy(buf_, &val_, sizeof(val_));
+			}
+		};
+	}
+
+	namespace net {
+
+		//! sends the UDP payloads of captured Ethernet/IPv4/UDP frames to a fixed destination
+		//!
+		//! Frames that do not carry a (non-fragmented) IPv4 UDP datagram are skipped. Payloads
+		//! are sent in batches through socket::send_batch().
+		class udp_payload_sink
+		{
+		public:
+			udp_payload_sink(socket& socket_, const std::string& ip_dst_, unsigned short tp_dst_,
+				unsigned batch_size_ = 64)
+				: udp_payload_sink(socket_, endpoint::from_string(ip_dst_, tp_dst_), batch_size_) { }
+
+			udp_payload_sink(socket& socket_, const endpoint& dst_, unsigned batch_size_ = 64)
+				: _socket(socket_), _dst(dst_), _batch(batch_size_) { }
+
+			//! sends the payloads of count_ records, returns the number of datagrams sent
+			//!
+			//! send_batch() only sends part of a batch on a non-blocking socket whose send buffer
+			//! is full, the rest is counted in dropped().
+			unsigned send(const file::packet_record* recs_, unsigned count_)
+			{
+				unsigned sent = 0;
+
+				for (unsigned i = 0; i < count_; i++) {
+					const unsigned char* payload = nullptr;
+					unsigned len = 0;
+
+					if (!udp_payload(recs_[i], payload, len)) {
+						_skipped++;
+						continue;
+					}
+
+					if (_batch.full())
+						sent += _flush();
+
+					if (!_batch.push(payload, len, _dst)) {
+						sent += _flush();
+						_socket.send_to(_dst, payload, len);
+						sent++;
+					}
+				}
+
+				return sent + _flush();
+			}
+
+			//! returns the number of records that did not contain a UDP datagram
+			uint64_t skipped() const
+			{
+				return _skipped;
+			}
+
+			//! returns the number of datagrams not sent because a non-blocking socket's send
+			//! buffer was full
+			uint64_t dropped() const
+			{
+				return _dropped;
+			}
+
+			//! locates the UDP payload of an Ethernet frame (optionally 802.1Q-tagged)
+			static bool udp_payload(const file::packet_record& rec_, const unsigned char*& payload_,
+				unsigned& len_)
+			{
+				const unsigned char* p = rec_.data;
+				const unsigned char* end = rec_.data + rec_.caplen;
+
+				if (end - p < 14)
+					return false;
+
+				uint16_t ether_type = sys::read_uint16((const char*) p + 12);
+				p += 14;
+
+				if (ether_type == 0x8100 && end - p >= 4) {
+					ether_type = sys::read_uint16((const char*) p + 2);
+					p += 4;
+				}
+
+				if (ether_type != 0x0800 || end - p < 20 || (p[0] >> 4) != 4 || p[9] != 17)
+					return false;
+
+				if (sys::read_uint16((const char*) p + 6) & 0x3fff) // fragment
+					return false;
+
+				unsigned ihl = (p[0] & 0x0f) * 4u;
+
+				if (ihl < 20 || end - p < ihl + 8)
+					return false;
+
+				p += ihl;
+				unsigned udp_len = sys::read_uint16((const char*) p + 4);
+
+				if (udp_len < 8)
+					return false;
+
+				payload_ = p + 8;
+				len_ = std::min<unsigned>(udp_len - 8, (unsigned) (end - payload_));
+				return true;
+			}
+
+		private:
+			socket& _socket;
+			endpoint _dst;
+			datagram_batch _batch;
+			uint64_t _skipped = 0;
+			uint64_t _dropped = 0;
+
+			unsigned _flush()
+			{
+				unsigned sent = _socket.send_batch(_batch);
+				_dropped += _batch.size() - sent;
+				_batch.clear();
+				return sent;
+			}
+		};
+
+#ifdef __linux__
+		//! sends captured frames unmodified on a network interface through an AF_PACKET socket
+		class raw_packet_sink : public sys::file_descriptor
+		{
+		public:
+			explicit raw_packet_sink(const std::string& interface_)
+			{
+				if ((_fd = ::socket(AF_PACKET, SOCK_RAW, 0)) == -1)
+					throw std::runtime_error("raw_packet_sink: could not open: errno: "
+						+ std::to_string(errno));
+
+				struct sockaddr_ll ll {};
+				ll.sll_family  = AF_PACKET;
+				ll.sll_ifindex = (int) ::if_nametoindex(interface_.c_str());
+
+				if (ll.sll_ifindex == 0 || ::bind(_fd, (struct sockaddr*) &ll, sizeof(ll))) {
+					::close(_fd);
+					_fd = -1;
+					throw std::runtime_error("raw_packet_sink: could not bind to " + interface_);
+				}
+			}
+
+			raw_packet_sink(const raw_packet_sink&) = delete;
+			raw_packet_sink& operator=(const raw_packet_sink&) = delete;
+
+			//! sends count_ frames with a single sendmmsg() call, returns the number sent
+			unsigned send(const file::packet_record* recs_, unsigned count_)
+			{
+				_msgs.resize(count_);
+				_iovs.resize(count_);
+
+				for (unsigned i = 0; i < count_; i++) {
+					_iovs[i].iov_base = (void*) recs_[i].data;
+					_iovs[i].iov_len  = recs_[i].caplen;
+					_msgs[i] = {};
+					_msgs[i].msg_hdr.msg_iov    = &_iovs[i];
+					_msgs[i].msg_hdr.msg_iovlen = 1;
+				}
+
+				unsigned sent = 0;
+
+				while (sent < count_) {
+					int r = ::sendmmsg(_fd, _msgs.data() + sent, count_ - sent, 0);
+
+					if (r == -1 && errno == EINTR)
+						continue;
+
+					if (r == -1)
+						throw std::runtime_error("raw_packet_sink: could not send: errno: "
+							+ std::to_string(errno));
+
+					sent += (unsigned) r;
+				}
+
+				return sent;
+			}
+
+			~raw_packet_sink()
+			{
+				if (_fd != -1) ::close(_fd);
+			}
+
+		private:
+			std::vector<struct mmsghdr> _msgs;
+			std::vector<struct iovec> _iovs;
+		};
+#endif
+
+		//! replays capture files to a sink at the original timing, a multiple of it, a fixed
+		//! packet rate, or as fast as possible
+		//!
+		//! A sink is any type with a member unsigned send(const file::packet_record*, unsigned).
+		//! Packets due at the same time are sent in batches of up to batch_size. Records of a
+		//! memory-mapped reader are sent straight from the mapping, others are copied first.
+		class replayer
+		{
+		public:
+			enum class mode { original, multiplier, fixed_rate, max_rate };
+
+			struct config
+			{
+				mode timing        = mode::original;
+				double multiplier  = 1.0; //!< speed-up factor for mode::multiplier
+				double rate        = 0;   //!< packets per second for mode::fixed_rate
+				unsigned batch_size = 32;
+			};
+
+			struct report
+			{
+				uint64_t packets        = 0; //!< records read from the capture
+				uint64_t sent           = 0; //!< records accepted by the sink
+				uint64_t bytes          = 0; //!< captured bytes of all records read
+				double seconds          = 0;
+				double mean_error_ns    = 0; //!< mean absolute deviation from the schedule
+				double max_error_ns     = 0; //!< max absolute deviation from the schedule
+
+				double pps() const { return seconds > 0 ? packets / seconds : 0; }
+				double bps() const { return seconds > 0 ? bytes * 8 / seconds : 0; }
+			};
+
+			replayer() : replayer(config()) { }
+
+			explicit replayer(const config& config_)
+				: _config(config_)
+			{
+				if (_config.batch_size == 0)
+					_config.batch_size = 1;
+
+				if (_config.timing == mode::multiplier && !(_config.multiplier > 0))
+					throw std::invalid_argument("om::net::replayer: invalid multiplier");
+
+				if (_config.timing == mode::fixed_rate && !(_config.rate > 0))
+					throw std::invalid_argument("om::net::replayer: invalid rate");
+			}
+
+			//! replays all records of reader_ into sink_
+			template <typename Reader, typename Sink>
+			report run(Reader& reader_, Sink& sink_)
+			{
+				using clock = std::chrono::steady_clock;
+
+				report rep;
+				file::packet_record rec;
+				uint64_t first_ts = 0;
+				double error_sum = 0;
+				clock::time_point start = clock::now();
+
+				_stop = false;
+				_copy = !reader_.mapped();
+				_batch_clear();
+
+				while (!_stop && reader_.next(rec)) {
+					if (rep.packets == 0)
+						first_ts = rec.timestamp;
+
+					clock::time_point due = start + _offset(rec, first_ts, rep.packets);
+
+					if (_config.timing != mode::max_rate && !_records.empty() && due > clock::now())
+						_flush(sink_, rep, error_sum);
+
+					if (_config.timing != mode::max_rate)
+						_wait_until(due);
+
+					_batch_add(rec, due);
+					rep.packets++;
+					rep.bytes += rec.caplen;
+
+					if (_records.size() >= _config.batch_size)
+						_flush(sink_, rep, error_sum);
+				}
+
+				_flush(sink_, rep, error_sum);
+
+				rep.seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+				if (rep.packets > 0)
+					rep.mean_error_ns = error_sum / rep.packets;
+
+				return rep;
+			}
+
+			//! stops a replay running in another thread after the current packet
+			void stop()
+			{
+				_stop = true;
+			}
+
+		private:
+			config _config;
+			std::atomic_bool _stop { false };
+			std::vector<file::packet_record> _records;
+			std::vector<std::chrono::steady_clock::time_point> _due;
+			std::vector<unsigned char> _data;
+			bool _copy = true; //!< records are copied into _data, unless the reader is mapped
+
+			std::chrono::nanoseconds _offset(const file::packet_record& rec_, uint64_t first_ts_,
+				uint64_t index_) const
+			{
+				double ts = rec_.timestamp > first_ts_ ? (double) (rec_.timestamp - first_ts_) : 0;
+
+				switch (_config.timing) {
+					case mode::original:
+						return std::chrono::nanoseconds((int64_t) ts);
+					case mode::multiplier:
+						return std::chrono::nanoseconds((int64_t) (ts / _config.multiplier));
+					case mode::fixed_rate:
+						return std::chrono::nanoseconds((int64_t) (index_ * 1e9 / _config.rate));
+					default:
+						return std::chrono::nanoseconds(0);
+				}
+			}
+
+			//! sleeps until shortly before tp_, then spins for accuracy
+			static void _wait_until(std::chrono::steady_clock::time_point tp_)
+			{
+				using clock = std::chrono::steady_clock;
+				const auto spin = std::chrono::microseconds(100);
+
+				auto now = clock::now();
+
+				if (tp_ - now > spin)
+					std::this_thread::sleep_until(tp_ - spin);
+
+				while (clock::now() < tp_)
+					;
+			}
+
+			//! adds a record to the batch, copying its data if the reader may reuse its buffer
+			void _batch_add(const file::packet_record& rec_,
+				std::chrono::steady_clock::time_point due_)
+			{
+				file::packet_record copy = rec_;
+
+				if (_copy) {
+					copy.data = (const unsigned char*) (uintptr_t) _data.size(); // offset until flush
+					_data.insert(_data.end(), rec_.data, rec_.data + rec_.caplen);
+				}
+
+				_records.push_back(copy);
+				_due.push_back(due_);
+			}
+
+			void _batch_clear()
+			{
+				_records.clear();
+				_due.clear();
+				_data.clear();
+			}
+
+			template <typename Sink>
+			void _flush(Sink& sink_, report& rep_, double& error_sum_)
+			{
+				if (_records.empty())
+					return;
+
+				if (_copy) {
+					for (auto& r : _records)
+						r.data = _data.data() + (uintptr_t) r.data;
+				}
+
+				auto now = std::chrono::steady_clock::now();
+				rep_.sent += sink_.send(_records.data(), (unsigned) _records.size());
+
+				if (_config.timing != mode::max_rate) {
+					for (auto& due : _due) {
+						double err = std::abs((double) std::chrono::duration_cast<
+							std::chrono::nanoseconds>(now - due).count());
+						error_sum_ += err;
+						rep_.max_error_ns = std::max(rep_.max_error_ns, err);
+					}
+				}
+
+				_batch_clear();
+			}
+		};
+	}
+
+	namespace concurrency {
+
+		//! a thread-safe unbounded FIFO queue
+		//!
+		//! Elements are stored in a ring of fixed-size chunks: emptied chunks are kept as
+		//! spares and reused, so a queue that reaches a steady size stops calling the
+		//! allocator. The bulk operations move a whole burst under one lock acquisition, and
+		//! producers only notify when a consumer actually waits.
+		template<typename T>
+		class queue
+		{
+		public:
+			queue() = default;
+
+			queue(const queue&) = delete;
+			queue& operator=(const queue&) = delete;
+
+			//! enqueues an element
+			void enqueue(T item_)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_push(std::move(item_));
+
+				if (_waiting > 0)
+					_condition.notify_one();
+			}
+
+			//! enqueues the elements of [first_, last_)
+			template<typename InputIt>
+			void enqueue_bulk(InputIt first_, InputIt last_)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				std::size_t count = 0;
+
+				for (; first_ != last_; ++first_, count++)
+					_push(*first_);
+
+				if (_waiting > 0 && count > 0)
+					count > 1 ? _condition.notify_all() : _condition.notify_one();
+			}
+
+			//! dequeues an element, blocks if the queue is empty
+			void dequeue_wait(T& item_)
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wait(lock, -1);
+				_pop(item_);
+			}
+
+			//! dequeues an element, waits up to timeout_ms_ if the queue is empty, returns false
+			//! if it still is
+			bool dequeue_wait(T& item_, int timeout_ms_)
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+
+				if (!_wait(lock, timeout_ms_))
+					return false;
+
+				_pop(item_);
+				return true;
+			}
+
+			//! tries to dequeue an element, returns false if queue is empty
+			bool dequeue(T& item_)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				if(_size == 0)
+					return false;
+
+				_pop(item_);
+				return true;
+			}
+
+			//! dequeues up to max_ elements into out_, returns the number dequeued
+			template<typename OutputIt>
+			std::size_t dequeue_bulk(OutputIt out_, std::size_t max_)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				return _pop_bulk(out_, max_);
+			}
+
+			//! waits up to timeout_ms_ (-1 for no timeout) until the queue is not empty and
+			//! dequeues up to max_ elements into out_, returns the number dequeued
+			template<typename OutputIt>
+			std::size_t dequeue_wait_bulk(OutputIt out_, std::size_t max_, int timeout_ms_ = -1)
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+
+				if (max_ == 0 || !_wait(lock, timeout_ms_))
+					return 0;
+
+				return _pop_bulk(out_, max_);
+			}
+
+			//! checks if the queue is empty
+			bool empty() const
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				return _size == 0;
+			}
+
+			//! returns the number of queued elements
+			std::size_t size() const
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				return _size;
+			}
+
+			~queue()
+			{
+				while (_size > 0)
+					_drop_front();
+
+				for (chunk* c = _head; c; ) {
+					chunk* next = c->next;
+					delete c;
+					c = next;
+				}
+
+				for (chunk* c = _spare; c; ) {
+					chunk* next = c->next;
+					delete c;
+					c = next;
+				}
+			}
+
+		private:
+			//! elements per chunk, about 4 KiB worth
+			static const std::size_t CHUNK_SIZE = sizeof(T) >= 512 ? 8 : 4096 / sizeof(T);
+			static const std::size_t MAX_SPARES = 4;
+
+			struct chunk
+			{
+				chunk* next = nullptr;
+				typename std::aligned_storage<sizeof(T), alignof(T)>::type items[CHUNK_SIZE];
+			};
+
+			mutable std::mutex _mutex;
+			std::condition_variable _condition;
+			chunk* _head            = nullptr;
+			chunk* _tail            = nullptr;
+			chunk* _spare           = nullptr;
+			std::size_t _head_index = 0; //!< next element to pop in _head
+			std::size_t _tail_index = 0; //!< next free slot in _tail
+			std::size_t _size       = 0;
+			std::size_t _spares     = 0;
+			unsigned _waiting       = 0;
+
+			template<typename U>
+			void _push(U&& item_)
+			{
+				if (!_tail || _tail_index == CHUNK_SIZE) {
+					chunk* c = _spare ? _spare : new chunk();
+
+					if (_spare) {
+						_spare = c->next;
+						_spares--;
+						c->next = nullptr;
+					}
+
+					(_tail ? _tail->next : _head) = c;
+					_tail       = c;
+					_tail_index = 0;
+				}
+
+				new (&_tail->items[_tail_index]) T(std::forward<U>(item_));
+				_tail_index++;
+				_size++;
+			}
+
+			template<typename U>
+			void _pop(U&& out_)
+			{
+				out_ = std::move(*reinterpret_cast<T*>(&_head->items[_head_index]));
+				_drop_front();
+			}
+
+			//! destroys the front element
+			void _drop_front()
+			{
+				reinterpret_cast<T*>(&_head->items[_head_index])->~T();
+				_size--;
+
+				if (++_head_index == CHUNK_SIZE || _size == 0) {
+					chunk* c = _head;
+
+					if (_size == 0 && c == _tail) {
+						// keep the last chunk, start over at its beginning
+						_tail_index = 0;
+					} else {
+						_head = c->next;
+						_recycle(c);
+					}
+
+					_head_index = 0;
+				}
+			}
+
+			template<typename OutputIt>
+			std::size_t _pop_bulk(OutputIt& out_, std::size_t max_)
+			{
+				std::size_t count = std::min(max_, _size);
+
+				for (std::size_t i = 0; i < count; i++, ++out_)
+					_pop(*out_);
+
+				return count;
+			}
+
+			void _recycle(chunk* c_)
+			{
+				if (_spares < MAX_SPARES) {
+					c_->next = _spare;
+					_spare   = c_;
+					_spares++;
+				} else {
+					delete c_;
+				}
+			}
+
+			//! waits until the queue is not empty, returns false on timeout
+			bool _wait(std::unique_lock<std::mutex>& lock_, int timeout_ms_)
+			{
+				if (_size > 0)
+					return true;
+
+				_waiting++;
+				bool ready = true;
+
+				if (timeout_ms_ < 0)
+					_condition.wait(lock_, [this]() { return _size > 0; });
+				else
+					ready = _condition.wait_for(lock_, std::chrono::milliseconds(timeout_ms_),
+						[this]() { return _size > 0; });
+
+				_waiting--;
+				return ready;
+			}
+		};
+
+		//! a bounded lock-free queue for exactly one producer and one consumer thread
+		//!
+		//! The capacity is rounded up to a power of two. Each side keeps a cached copy of the
+		//! other side's index and only reloads the shared one when the copy says the ring is
+		//! full (producer) or empty (consumer), so a busy queue costs no cache line transfers
+		//! besides the slots themselves. The bulk operations publish a whole burst at once.
+		//!
+		//! The blocking push() and pop() variants spin briefly and then sleep on a condition
+		//! variable; the other side only takes the mutex to wake them if it sees a sleeper.
+		template<typename T>
+		class spsc_queue
+		{
+		public:
+			explicit spsc_queue(std::size_t capacity_)
+			{
+				std::size_t capacity = 1;
+
+				while (capacity < capacity_)
+					capacity <<= 1;
+
+				_mask  = capacity - 1;
+				_slots.reset(new slot_t[capacity]);
+			}
+
+			spsc_queue(const spsc_queue&) = delete;
+			spsc_queue& operator=(const spsc_queue&) = delete;
+
+			std::size_t capacity() const
+			{
+				return _mask + 1;
+			}
+
+			//! returns the number of queued items, only exact when both sides are idle
+			std::size_t size() const
+			{
+				return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+			}
+
+			bool empty() const
+			{
+				return size() == 0;
+			}
+
+			//! constructs an item in place, returns false if the queue is full (producer only)
+			template<typename... Args>
+			bool try_emplace(Args&&... args_)
+			{
+				std::size_t tail = _tail.load(std::memory_order_relaxed);
+
+				if (tail - _head_cache > _mask) {
+					_head_cache = _head.load(std::memory_order_acquire);
+
+					if (tail - _head_cache > _mask)
+						return false;
+				}
+
+				new (&_slots[tail & _mask]) T(std::forward<Args>(args_)...);
+				_publish(_tail, tail + 1, _consumer_waiting);
+				return true;
+			}
+
+			bool try_push(const T& item_)
+			{
+				return try_emplace(item_);
+			}
+
+			bool try_push(T&& item_)
+			{
+				return try_emplace(std::move(item_));
+			}
+
+			//! pushes up to count_ items from first_, returns the number pushed (producer only)
+			template<typename InputIt>
+			std::size_t try_push_bulk(InputIt first_, std::size_t count_)
+			{
+				std::size_t tail = _tail.load(std::memory_order_relaxed);
+				std::size_t free = capacity() - (tail - _head_cache);
+
+				if (free < count_) {
+					_head_cache = _head.load(std::memory_order_acquire);
+					free = capacity() - (tail - _head_cache);
+				}
+
+				std::size_t n = std::min(free, count_);
+
+				if (n == 0)
+					return 0;
+
+				for (std::size_t i = 0; i < n; i++, ++first_)
+					new (&_slots[(tail + i) & _mask]) T(*first_);
+
+				_publish(_tail, tail + n, _consumer_waiting);
+				return n;
+			}
+
+			//! pops an item, returns false if the queue is empty (consumer only)
+			bool try_pop(T& item_)
+			{
+				std::size_t head = _head.load(std::memory_order_relaxed);
+
+				if (head == _tail_cache) {
+					_tail_cache = _tail.load(std::memory_order_acquire);
+
+					if (head == _tail_cache)
+						return false;
+				}
+
+				T& slot = *reinterpret_cast<T*>(&_slots[head & _mask]);
+				item_ = std::move(slot);
+				slot.~T();
+				_publish(_head, head + 1, _producer_waiting);
+				return true;
+			}
+
+			//! pops up to max_ items into out_, returns the number popped (consumer only)
+			template<typename OutputIt>
+			std::size_t try_pop_bulk(OutputIt out_, std::size_t max_)
+			{
+				std::size_t head = _head.load(std::memory_order_relaxed);
+
+				if (_tail_cache - head < max_)
+					_tail_cache = _tail.load(std::memory_order_acquire);
+
+				std::size_t n = std::min(_tail_cache - head, max_);
+
+				if (n == 0)
+					return 0;
+
+				for (std::size_t i = 0; i < n; i++, ++out_) {
+					T& slot = *reinterpret_cast<T*>(&_slots[(head + i) & _mask]);
+					*out_ = std::move(slot);
+					slot.~T();
+				}
+
+				_publish(_head, head + n, _producer_waiting);
+				return n;
+			}
+
+			//! pushes an item, waits while the queue is full, returns false if timeout_ms_
+			//! (-1 for no timeout) expired
+			bool push(T item_, int timeout_ms_ = -1)
+			{
+				if (try_push(std::move(item_)))
+					return true;
+
+				return _wait(_producer_waiting, [this]() { return !_full(); }, timeout_ms_)
+					&& try_push(std::move(item_));
+			}
+
+			//! pushes count_ items from first_, waiting for space as needed, returns the number
+			//! pushed before timeout_ms_ (-1 for no timeout) expired
+			template<typename ForwardIt>
+			std::size_t push_bulk(ForwardIt first_, std::size_t count_, int timeout_ms_ = -1)
+			{
+				std::size_t pushed = 0;
+
+				for (;;) {
+					std::size_t n = try_push_bulk(first_, count_ - pushed);
+					std::advance(first_, n);
+
+					if ((pushed += n) == count_
+						|| !_wait(_producer_waiting, [this]() { return !_full(); }, timeout_ms_))
+						return pushed;
+				}
+			}
+
+			//! pops an item, waits while the queue is empty, returns false if timeout_ms_
+			//! (-1 for no timeout) expired
+			bool pop(T& item_, int timeout_ms_ = -1)
+			{
+				if (try_pop(item_))
+					return true;
+
+				return _wait(_consumer_waiting, [this]() { return !_empty(); }, timeout_ms_)
+					&& try_pop(item_);
+			}
+
+			//! waits until the queue is not empty and pops up to max_ items into out_, returns
+			//! the number popped or 0 if timeout_ms_ (-1 for no timeout) expired
+			template<typename OutputIt>
+			std::size_t pop_bulk(OutputIt out_, std::size_t max_, int timeout_ms_ = -1)
+			{
+				std::size_t n = try_pop_bulk(out_, max_);
+
+				if (n > 0 || max_ == 0)
+					return n;
+
+				return _wait(_consumer_waiting, [this]() { return !_empty(); }, timeout_ms_)
+					? try_pop_bulk(out_, max_) : 0;
+			}
+
+			~spsc_queue()
+			{
+				for (std::size_t i = _head.load(); i != _tail.load(); i++)
+					reinterpret_cast<T*>(&_slots[i & _mask])->~T();
+			}
+
+		private:
+			using slot_t = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+			static const unsigned SPIN_COUNT = 1024;
+
+			// each side writes its own cache line, separated by padding because an alignas(64)
+			// member would over-align every owner of the queue, which new ignores before C++17
+
+			// written by the consumer
+			std::atomic<std::size_t> _head { 0 };
+			std::size_t _tail_cache = 0;
+			char _head_padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+
+			// written by the producer
+			std::atomic<std::size_t> _tail { 0 };
+			std::size_t _head_cache = 0;
+			char _tail_padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+
+			std::atomic<bool> _producer_waiting { false };
+			std::atomic<bool> _consumer_waiting { false };
+			std::size_t _mask = 0;
+			std::unique_ptr<slot_t[]> _slots;
+			std::mutex _mutex;
+			std::condition_variable _condition;
+
+			bool _full() const
+			{
+				return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire) > _mask;
+			}
+
+			bool _empty() const
+			{
+				return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+			}
+
+			//! stores an index and wakes the other side if it sleeps
+			void _publish(std::atomic<std::size_t>& index_, std::size_t value_, std::atomic<bool>& waiting_)
+			{
+				index_.store(value_, std::memory_order_release);
+
+				// pairs with the fence in _wait(): either we see the sleeper or it sees the index
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (waiting_.load(std::memory_order_relaxed)) {
+					std::lock_guard<std::mutex> lock(_mutex);
+					_condition.notify_all();
+				}
+			}
+
+			template<typename Predicate>
+			bool _wait(std::atomic<bool>& waiting_, Predicate ready_, int timeout_ms_)
+			{
+				for (unsigned i = 0; i < SPIN_COUNT; i++)
+					if (ready_())
+						return true;
+
+				std::unique_lock<std::mutex> lock(_mutex);
+				waiting_.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				bool ready = true;
+
+				if (timeout_ms_ < 0)
+					_condition.wait(lock, ready_);
+				else
+					ready = _condition.wait_for(lock, std::chrono::milliseconds(timeout_ms_), ready_);
+
+				waiting_.store(false, std::memory_order_relaxed);
+				return ready;
+			}
+		};
+
+		//! a bounded lock-free queue for any number of producer and consumer threads
+		//!
+		//! This is Dmitry Vyukov's array-based queue: each slot carries a sequence number that
+		//! tells producers and consumers of which lap it is free or full, so threads only
+		//! contend on one CAS per operation (or per burst for the bulk operations) instead of
+		//! serializing on a mutex. The capacity is rounded up to a power of two.
+		//!
+		//! The interface follows concurrency::queue, so it can be used as the task queue of a
+		//! thread_pool (see basic_thread_pool). Blocking calls spin briefly and then sleep; the
+		//! other side only takes the mutex to wake them if there are sleepers.
+		template<typename T>
+		class mpmc_queue
+		{
+		public:
+			explicit mpmc_queue(std::size_t capacity_ = 1024)
+			{
+				std::size_t capacity = 2;
+
+				while (capacity < capacity_)
+					capacity <<= 1;
+
+				_mask = capacity - 1;
+				_cells.reset(new cell[capacity]);
+
+				for (std::size_t i = 0; i < capacity; i++)
+					_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			mpmc_queue(const mpmc_queue&) = delete;
+			mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+			std::size_t capacity() const
+			{
+				return _mask + 1;
+			}
+
+			//! returns the number of queued items, only exact when the queue is idle
+			std::size_t size() const
+			{
+				std::size_t head = _dequeue_pos.load(std::memory_order_acquire);
+				std::size_t tail = _enqueue_pos.load(std::memory_order_acquire);
+				return tail > head ? tail - head : 0;
+			}
+
+			bool empty() const
+			{
+				return size() == 0;
+			}
+
+			//! constructs an item in place, returns false if the queue is full
+			template<typename... Args>
+			bool try_emplace(Args&&... args_)
+			{
+				std::size_t pos;
+
+				if (_claim(_enqueue_pos, 0, 1, pos) == 0)
+					return false;
+
+				cell& c = _cells[pos & _mask];
+				new (&c.storage) T(std::forward<Args>(args_)...);
+				c.sequence.store(pos + 1, std::memory_order_release);
+				_wake(_consumers_waiting, _not_empty, false);
+				return true;
+			}
+
+			bool try_enqueue(T item_)
+			{
+				return try_emplace(std::move(item_));
+			}
+
+			//! enqueues an item, waits while the queue is full, returns false if timeout_ms_
+			//! (-1 for no timeout) expired
+			bool enqueue(T item_, int timeout_ms_ = -1)
+			{
+				while (!try_emplace(std::move(item_)))
+					if (!_wait(_producers_waiting, _not_full, [this]() { return _writable(); }, timeout_ms_))
+						return false;
+
+				return true;
+			}
+
+			//! enqueues up to count_ items from first_ with a single claim, returns the number
+			//! enqueued
+			template<typename InputIt>
+			std::size_t try_enqueue_bulk(InputIt first_, std::size_t count_)
+			{
+				std::size_t pos;
+				std::size_t n = _claim(_enqueue_pos, 0, count_, pos);
+
+				for (std::size_t i = 0; i < n; i++, ++first_) {
+					cell& c = _cells[(pos + i) & _mask];
+					new (&c.storage) T(*first_);
+					c.sequence.store(pos + i + 1, std::memory_order_release);
+				}
+
+				if (n > 0)
+					_wake(_consumers_waiting, _not_empty, n > 1);
+
+				return n;
+			}
+
+			//! enqueues count_ items from first_, waiting for space as needed, returns the number
+			//! enqueued before timeout_ms_ (-1 for no timeout) expired
+			template<typename ForwardIt>
+			std::size_t enqueue_bulk(ForwardIt first_, std::size_t count_, int timeout_ms_ = -1)
+			{
+				std::size_t done = 0;
+
+				for (;;) {
+					std::size_t n = try_enqueue_bulk(first_, count_ - done);
+					std::advance(first_, n);
+
+					if ((done += n) == count_
+						|| !_wait(_producers_waiting, _not_full, [this]() { return _writable(); }, timeout_ms_))
+						return done;
+				}
+			}
+
+			//! tries to dequeue an item, returns false if the queue is empty
+			bool dequeue(T& item_)
+			{
+				std::size_t pos;
+
+				if (_claim(_dequeue_pos, 1, 1, pos) == 0)
+					return false;
+
+				_take(pos, item_);
+				_wake(_producers_waiting, _not_full, false);
+				return true;
+			}
+
+			//! dequeues an item, waits while the queue is empty, returns false if timeout_ms_
+			//! (-1 for no timeout) expired
+			bool dequeue_wait(T& item_, int timeout_ms_ = -1)
+			{
+				while (!dequeue(item_))
+					if (!_wait(_consumers_waiting, _not_empty, [this]() { return _readable(); }, timeout_ms_))
+						return false;
+
+				return true;
+			}
+
+			//! dequeues up to max_ items into out_ with a single claim, returns the number dequeued
+			template<typename OutputIt>
+			std::size_t dequeue_bulk(OutputIt out_, std::size_t max_)
+			{
+				std::size_t pos;
+				std::size_t n = _claim(_dequeue_pos, 1, max_, pos);
+
+				for (std::size_t i = 0; i < n; i++, ++out_)
+					_take(pos + i, *out_);
+
+				if (n > 0)
+					_wake(_producers_waiting, _not_full, n > 1);
+
+				return n;
+			}
+
+			//! waits until the queue is not empty and dequeues up to max_ items into out_, returns
+			//! the number dequeued or 0 if timeout_ms_ (-1 for no timeout) expired
+			template<typename OutputIt>
+			std::size_t dequeue_wait_bulk(OutputIt out_, std::size_t max_, int timeout_ms_ = -1)
+			{
+				std::size_t n;
+
+				while ((n = dequeue_bulk(out_, max_)) == 0 && max_ > 0)
+					if (!_wait(_consumers_waiting, _not_empty, [this]() { return _readable(); }, timeout_ms_))
+						return 0;
+
+				return n;
+			}
+
+			~mpmc_queue()
+			{
+				for (std::size_t i = _dequeue_pos.load(); i != _enqueue_pos.load(); i++)
+					reinterpret_cast<T*>(&_cells[i & _mask].storage)->~T();
+			}
+
+		private:
+			struct cell
+			{
+				std::atomic<std::size_t> sequence;
+				typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+			};
+
+			static const unsigned SPIN_COUNT = 256;
+
+			// padding, not alignas(64), keeps the queue usable as the Queue of a thread pool
+			// that is allocated with plain new before C++17
+			std::atomic<std::size_t> _enqueue_pos { 0 };
+			char _enqueue_padding[64 - sizeof(std::atomic<std::size_t>)];
+			std::atomic<std::size_t> _dequeue_pos { 0 };
+			char _dequeue_padding[64 - sizeof(std::atomic<std::size_t>)];
+			std::atomic<unsigned> _producers_waiting { 0 };
+			std::atomic<unsigned> _consumers_waiting { 0 };
+			std::size_t _mask = 0;
+			std::unique_ptr<cell[]> _cells;
+			std::mutex _mutex;
+			std::condition_variable _not_empty;
+			std::condition_variable _not_full;
+
+			//! claims up to max_ consecutive cells at pos_ (a cell is ready for producers when
+			//! its sequence equals its position, for consumers when it equals position + 1),
+			//! returns the number claimed
+			std::size_t _claim(std::atomic<std::size_t>& index_, std::size_t lag_, std::size_t max_,
+				std::size_t& pos_)
+			{
+				pos_ = index_.load(std::memory_order_relaxed);
+
+				for (;;) {
+					std::size_t n = 0;
+
+					while (n < max_
+						&& _cells[(pos_ + n) & _mask].sequence.load(std::memory_order_acquire) == pos_ + n + lag_)
+						n++;
+
+					if (n == 0) {
+						auto diff = (std::ptrdiff_t) (_cells[pos_ & _mask].sequence.load(std::memory_order_acquire)
+							- (pos_ + lag_));
+
+						// the cell is still in use from the previous lap: full, or empty for consumers
+						if (diff < 0 || max_ == 0)
+							return 0;
+
+						pos_ = index_.load(std::memory_order_relaxed);
+					} else if (index_.compare_exchange_weak(pos_, pos_ + n, std::memory_order_relaxed)) {
+						return n;
+					}
+				}
+			}
+
+			template<typename Out>
+			void _take(std::size_t pos_, Out&& out_)
+			{
+				cell& c = _cells[pos_ & _mask];
+				T& item = *reinterpret_cast<T*>(&c.storage);
+				out_ = std::move(item);
+				item.~T();
+				c.sequence.store(pos_ + _mask + 1, std::memory_order_release);
+			}
+
+			//! returns true if the next cell is ready for the side given by lag_
+			bool _ready(const std::atomic<std::size_t>& index_, std::size_t lag_) const
+			{
+				for (;;) {
+					std::size_t pos = index_.load(std::memory_order_acquire);
+					auto diff = (std::ptrdiff_t) (_cells[pos & _mask].sequence.load(std::memory_order_acquire)
+						- (pos + lag_));
+
+					if (diff == 0)
+						return true;
+
+					if (diff < 0)
+						return false;
+				}
+			}
+
+			bool _writable() const
+			{
+				return _ready(_enqueue_pos, 0);
+			}
+
+			bool _readable() const
+			{
+				return _ready(_dequeue_pos, 1);
+			}
+
+			void _wake(std::atomic<unsigned>& waiting_, std::condition_variable& condition_, bool all_)
+			{
+				// pairs with the fence in _wait(): either we see the sleeper or it sees the cell
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (waiting_.load(std::memory_order_relaxed) == 0)
+					return;
+
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				if (all_)
+					condition_.notify_all();
+				else
+					condition_.notify_one();
+			}
+
+			template<typename Predicate>
+			bool _wait(std::atomic<unsigned>& waiting_, std::condition_variable& condition_,
+				Predicate ready_, int timeout_ms_)
+			{
+				for (unsigned i = 0; i < SPIN_COUNT; i++)
+					if (ready_())
+						return true;
+
+				std::unique_lock<std::mutex> lock(_mutex);
+				waiting_.fetch_add(1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				bool ready = true;
+
+				if (timeout_ms_ < 0)
+					condition_.wait(lock, ready_);
+				else
+					ready = condition_.wait_for(lock, std::chrono::milliseconds(timeout_ms_), ready_);
+
+				waiting_.fetch_sub(1, std::memory_order_relaxed);
+				return ready;
+			}
+		};
+
+		class thread_joiner
+		{
+		public:
+			explicit thread_joiner(std::vector<std::thread>& threads_) : _threads(threads_) { }
+
+			~thread_joiner()
+			{
+				for (auto& t : _threads)
+					if (t.joinable()) t.join();
+			}
+
+		private:
+			std::vector<std::thread>& _threads;
+		};
+
+		//! the type-erased operations of a task's functor
+		struct _task_ops
+		{
+			void (*invoke)(void* storage_);
+			void (*move)(void* dst_, void* src_) noexcept;
+			void (*destroy)(void* storage_) noexcept;
+		};
+
+		//! the functor lives in the task's buffer
+		template<typename Fx>
+		struct _task_inline_ops
+		{
+			static void invoke(void* storage_)
+			{
+				(*static_cast<Fx*>(storage_))();
+			}
+
+			static void move(void* dst_, void* src_) noexcept
+			{
+				new (dst_) Fx(std::move(*static_cast<Fx*>(src_)));
+				static_cast<Fx*>(src_)->~Fx();
+			}
+
+			static void destroy(void* storage_) noexcept
+			{
+				static_cast<Fx*>(storage_)->~Fx();
+			}
+
+			static const _task_ops table;
+		};
+
+		template<typename Fx>
+		const _task_ops _task_inline_ops<Fx>::table = { &invoke, &move, &destroy };
+
+		//! the buffer holds a pointer to the functor on the heap
+		template<typename Fx>
+		struct _task_heap_ops
+		{
+			static void invoke(void* storage_)
+			{
+				(**static_cast<Fx**>(storage_))();
+			}
+
+			static void move(void* dst_, void* src_) noexcept
+			{
+				*static_cast<Fx**>(dst_) = *static_cast<Fx**>(src_);
+			}
+
+			static void destroy(void* storage_) noexcept
+			{
+				delete *static_cast<Fx**>(storage_);
+			}
+
+			static const _task_ops table;
+		};
+
+		template<typename Fx>
+		const _task_ops _task_heap_ops<Fx>::table = { &invoke, &move, &destroy };
+
+		//! a move-only void() functor with an inline buffer of Size bytes
+		//!
+		//! Unlike std::function, which only stores about two pointers without allocating,
+		//! functors of up to Size bytes (that are nothrow movable) live inside the task, so
+		//! typical lambdas with a handful of captures never touch the allocator. Larger
+		//! functors fall back to the heap. Being move-only, a task can also own move-only
+		//! captures such as a std::unique_ptr or a promise.
+		template<std::size_t Size>
+		class basic_task
+		{
+		public:
+			//! returns true if Fx is stored without allocating
+			template<typename Fx>
+			static constexpr bool fits()
+			{
+				return sizeof(Fx) <= Size && alignof(Fx) <= alignof(std::max_align_t)
+					&& std::is_nothrow_move_constructible<Fx>::value;
+			}
+
+			basic_task() noexcept = default;
+
+			basic_task(std::nullptr_t) noexcept { }
+
+			template<typename Fx, typename = typename std::enable_if<
+				!std::is_same<typename std::decay<Fx>::type, basic_task>::value>::type>
+			basic_task(Fx&& f_)
+			{
+				_assign<typename std::decay<Fx>::type>(std::forward<Fx>(f_));
+			}
+
+			basic_task(basic_task&& other_) noexcept
+			{
+				_take(other_);
+			}
+
+			basic_task& operator=(basic_task&& other_) noexcept
+			{
+				if (this != &other_) {
+					_reset();
+					_take(other_);
+				}
+
+				return *this;
+			}
+
+			basic_task& operator=(std::nullptr_t) noexcept
+			{
+				_reset();
+				return *this;
+			}
+
+			basic_task(const basic_task&) = delete;
+			basic_task& operator=(const basic_task&) = delete;
+
+			explicit operator bool() const noexcept
+			{
+				return _ops != nullptr;
+			}
+
+			//! throws std::bad_function_call if the task is empty
+			void operator()()
+			{
+				if (!_ops)
+					throw std::bad_function_call();
+
+				_ops->invoke(&_storage);
+			}
+
+			~basic_task()
+			{
+				_reset();
+			}
+
+		private:
+			typename std::aligned_storage<Size < sizeof(void*) ? sizeof(void*) : Size,
+				alignof(std::max_align_t)>::type _storage;
+			const _task_ops* _ops = nullptr;
+
+			template<typename Fx, typename F>
+			typename std::enable_if<fits<Fx>()>::type _assign(F&& f_)
+			{
+				new (&_storage) Fx(std::forward<F>(f_));
+				_ops = &_task_inline_ops<Fx>::table;
+			}
+
+			template<typename Fx, typename F>
+			typename std::enable_if<!fits<Fx>()>::type _assign(F&& f_)
+			{
+				*reinterpret_cast<Fx**>(&_storage) = new Fx(std::forward<F>(f_));
+				_ops = &_task_heap_ops<Fx>::table;
+			}
+
+			void _take(basic_task& other_) noexcept
+			{
+				if (other_._ops) {
+					other_._ops->move(&_storage, &other_._storage);
+					_ops = other_._ops;
+					other_._ops = nullptr;
+				}
+			}
+
+			void _reset() noexcept
+			{
+				if (_ops) {
+					_ops->destroy(&_storage);
+					_ops = nullptr;
+				}
+			}
+		};
+
+		//! the task type of thread_pool, lambdas with up to 64 bytes of captures do not allocate
+		using task = basic_task<64>;
+
+		//! a thread-local cache of heap objects, so that objects allocated on one thread and
+		//! released on another are recycled instead of returned to the allocator
+		template<typename T>
+		class _object_cache
+		{
+		public:
+			static T* acquire()
+			{
+				auto& free = _local()._free;
+
+				if (free.empty())
+					return new T();
+
+				T* object = free.back();
+				free.pop_back();
+				return object;
+			}
+
+			//! the caller resets the object's state
+			static void release(T* object_)
+			{
+				auto& free = _local()._free;
+
+				if (free.size() < CAPACITY)
+					free.push_back(object_);
+				else
+					delete object_;
+			}
+
+			~_object_cache()
+			{
+				for (auto* object : _free)
+					delete object;
+			}
+
+		private:
+			static const std::size_t CAPACITY = 1024;
+
+			std::vector<T*> _free;
+
+			_object_cache()
+			{
+				_free.reserve(CAPACITY);
+			}
+
+			static _object_cache& _local()
+			{
+				static thread_local _object_cache cache;
+				return cache;
+			}
+		};
+
+		//! runs submitted functors immediately on the calling thread
+		struct inline_executor
+		{
+			template<typename Fx>
+			void submit(Fx f_)
+			{
+				f_();
+			}
+		};
+
+		//! the part of a future's shared state that does not depend on the result type
+		//!
+		//! The state is reference counted and completes exactly once. Waiting threads only take
+		//! the mutex if they actually block, and a completing thread only takes it if it sees a
+		//! waiter.
+		class _future_state_base
+		{
+		public:
+			//! notified when a state completes, implemented by the states of continuations
+			//! and combinators
+			class callback
+			{
+			public:
+				virtual void _ready(_future_state_base& state_) = 0;
+
+			protected:
+				~callback() = default;
+			};
+
+			_future_state_base() = default;
+
+			_future_state_base(const _future_state_base&) = delete;
+			_future_state_base& operator=(const _future_state_base&) = delete;
+
+			void add_ref()
+			{
+				_refs.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void release()
+			{
+				if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					delete this;
+			}
+
+			bool ready() const
+			{
+				return _status.load(std::memory_order_acquire) & DONE;
+			}
+
+			void wait()
+			{
+				if (ready())
+					return;
+
+				std::unique_lock<std::mutex> lock(_mutex);
+
+				if (_status.fetch_or(WAITING, std::memory_order_acq_rel) & DONE)
+					return;
+
+				_condition.wait(lock, [this]() { return ready(); });
+			}
+
+			//! returns false if the state did not complete within timeout_ms_
+			bool wait_for(unsigned timeout_ms_)
+			{
+				if (ready())
+					return true;
+
+				std::unique_lock<std::mutex> lock(_mutex);
+
+				if (_status.fetch_or(WAITING, std::memory_order_acq_rel) & DONE)
+					return true;
+
+				return _condition.wait_for(lock, std::chrono::milliseconds(timeout_ms_),
+					[this]() { return ready(); });
+			}
+
+			void set_exception(std::exception_ptr exception_)
+			{
+				_exception = std::move(exception_);
+				_complete();
+			}
+
+			const std::exception_ptr& exception() const
+			{
+				return _exception;
+			}
+
+			bool has_callback() const
+			{
+				return _status.load(std::memory_order_acquire) & CALLBACK;
+			}
+
+			//! calls callback_->_ready() once the state is complete, right away if it already is
+			//!
+			//! A state has room for a single callback, throws std::logic_error if it is taken.
+			void on_ready(callback* callback_)
+			{
+				if (_status.load(std::memory_order_relaxed) & CALLBACK)
+					throw std::logic_error("future: already has a continuation");
+
+				_callback = callback_;
+
+				if (_status.fetch_or(CALLBACK, std::memory_order_acq_rel) & DONE)
+					callback_->_ready(*this);
+			}
+
+		protected:
+			virtual ~_future_state_base() = default;
+
+			void _complete()
+			{
+				unsigned status = _status.fetch_or(DONE, std::memory_order_acq_rel);
+
+				if (status & WAITING) {
+					std::lock_guard<std::mutex> lock(_mutex);
+					_condition.notify_all();
+				}
+
+				// runs on the completing thread, e.g. the worker that ran the task
+				if (status & CALLBACK)
+					_callback->_ready(*this);
+			}
+
+		private:
+			enum : unsigned
+			{
+				CALLBACK = 1,
+				WAITING  = 2,
+				DONE     = 4
+			};
+
+			std::atomic<unsigned> _refs { 1 };
+			std::atomic<unsigned> _status { 0 };
+			std::exception_ptr _exception;
+			callback* _callback = nullptr;
+			std::mutex _mutex;
+			std::condition_variable _condition;
+		};
+
+		//! holds the result inline, so it costs no allocation of its own
+		template<typename T>
+		class _future_state : public _future_state_base
+		{
+		public:
+			void set_value(T value_)
+			{
+				new (&_storage) T(std::move(value_));
+				_has_value = true;
+				_complete();
+			}
+
+			T& value()
+			{
+				return *reinterpret_cast<T*>(&_storage);
+			}
+
+			//! rethrows the exception of a failed state, moves the result out otherwise
+			T get()
+			{
+				if (exception())
+					std::rethrow_exception(exception());
+
+				return std::move(value());
+			}
+
+		protected:
+			~_future_state()
+			{
+				if (_has_value)
+					value().~T();
+			}
+
+		private:
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+			bool _has_value = false;
+		};
+
+		template<>
+		class _future_state<void> : public _future_state_base
+		{
+		public:
+			void set_value()
+			{
+				_complete();
+			}
+
+			void get()
+			{
+				if (exception())
+					std::rethrow_exception(exception());
+			}
+		};
+
+		//! completes state_ with the result of f_(args_...) or the exception it throws
+		template<typename R>
+		struct _fulfil
+		{
+			template<typename Fx, typename... Args>
+			static void apply(_future_state<R>& state_, Fx& f_, Args&&... args_)
+			{
+				try {
+					state_.set_value(f_(std::forward<Args>(args_)...));
+				} catch (...) {
+					state_.set_exception(std::current_exception());
+				}
+			}
+		};
+
+		template<>
+		struct _fulfil<void>
+		{
+			template<typename Fx, typename... Args>
+			static void apply(_future_state<void>& state_, Fx& f_, Args&&... args_)
+			{
+				try {
+					f_(std::forward<Args>(args_)...);
+				} catch (...) {
+					state_.set_exception(std::current_exception());
+					return;
+				}
+
+				state_.set_value();
+			}
+		};
+
+		//! the result type of a continuation of a future<T>
+		template<typename T, typename Fx>
+		struct _continuation_result
+		{
+			using type = decltype(std::declval<Fx&>()(std::declval<T>()));
+		};
+
+		template<typename Fx>
+		struct _continuation_result<void, Fx>
+		{
+			using type = decltype(std::declval<Fx&>()());
+		};
+
+		//! a task of a thread_pool, the functor lives in the state of its future
+		template<typename R, typename Fx>
+		class _task_state : public _future_state<R>
+		{
+		public:
+			explicit _task_state(Fx f_) : _f(std::move(f_)) { }
+
+			void run()
+			{
+				_fulfil<R>::apply(*this, _f);
+				this->release();
+			}
+
+		private:
+			Fx _f;
+		};
+
+		//! the queued part of a thread_pool::async() task, fails the future if it is destroyed
+		//! without running, e.g. by shutdown(shutdown_mode::cancel)
+		template<typename R, typename Fx>
+		class _task_runner
+		{
+		public:
+			explicit _task_runner(_task_state<R, Fx>* state_) : _state(state_) { }
+
+			_task_runner(_task_runner&& other_) noexcept : _state(other_._state)
+			{
+				other_._state = nullptr;
+			}
+
+			_task_runner(const _task_runner&) = delete;
+			_task_runner& operator=(const _task_runner&) = delete;
+
+			void operator()()
+			{
+				auto* state = _state;
+				_state = nullptr;
+				state->run();
+			}
+
+			~_task_runner()
+			{
+				if (_state) {
+					_state->set_exception(std::make_exception_ptr(
+						std::runtime_error("thread_pool: task cancelled")));
+					_state->release();
+				}
+			}
+
+		private:
+			_task_state<R, Fx>* _state;
+		};
+
+		//! the state of a continuation, it owns the state of the antecedent future
+		template<typename T, typename R, typename Fx, typename Executor>
+		class _then_state : public _future_state<R>, public _future_state_base::callback
+		{
+		public:
+			_then_state(_future_state<T>* prev_, Fx f_, Executor* executor_)
+				: _prev(prev_), _f(std::move(f_)), _executor(executor_) { }
+
+			void _ready(_future_state_base&) override
+			{
+				_executor->submit([this]() { _run(); });
+			}
+
+		private:
+			_future_state<T>* _prev;
+			Fx _f;
+			Executor* _executor;
+
+			template<typename U = T>
+			typename std::enable_if<!std::is_void<U>::value>::type _call()
+			{
+				_fulfil<R>::apply(*this, _f, std::move(_prev->value()));
+			}
+
+			template<typename U = T>
+			typename std::enable_if<std::is_void<U>::value>::type _call()
+			{
+				_fulfil<R>::apply(*this, _f);
+			}
+
+			void _run()
+			{
+				// a failed antecedent skips the continuation and fails this state too
+				if (_prev->exception())
+					this->set_exception(_prev->exception());
+				else
+					_call();
+
+				_prev->release();
+				this->release();
+			}
+		};
+
+		template<typename T>
+		class future;
+
+		template<typename T>
+		future<T> _make_future(_future_state<T>* state_);
+
+		template<typename T>
+		_future_state<T>* _release_future(future<T>& future_);
+
+		//! the result of a thread_pool task or a promise
+		//!
+		//! A future is a single reference counted allocation that holds the result inline, the
+		//! functor of a task and, for then(), the continuation. A continuation runs on the
+		//! thread that completes the antecedent, or on the calling thread if it is already
+		//! complete, unless an executor (e.g. a thread_pool) is given.
+		template<typename T>
+		class future
+		{
+		public:
+			future() = default;
+
+			future(future&& other_) noexcept : _state(other_._state)
+			{
+				other_._state = nullptr;
+			}
+
+			future& operator=(future&& other_) noexcept
+			{
+				std::swap(_state, other_._state);
+				return *this;
+			}
+
+			future(const future&) = delete;
+			future& operator=(const future&) = delete;
+
+			//! returns false for default constructed futures and futures consumed by then()
+			bool valid() const
+			{
+				return _state != nullptr;
+			}
+
+			bool ready() const
+			{
+				return _checked()->ready();
+			}
+
+			void wait() const
+			{
+				_checked()->wait();
+			}
+
+			//! returns false if the result is not ready after timeout_ms_
+			bool wait_for(unsigned timeout_ms_) const
+			{
+				return _checked()->wait_for(timeout_ms_);
+			}
+
+			//! waits for the result and moves it out, rethrows the exception of a failed task
+			T get()
+			{
+				_checked()->wait();
+				return _state->get();
+			}
+
+			//! chains f_, which is called with the result, and returns the future of its result
+			//!
+			//! f_ runs inline on the completing thread, so it should be cheap. If the future
+			//! fails, f_ is not called and the returned future fails with the same exception.
+			//! Consumes this future.
+			template<typename Fx>
+			future<typename _continuation_result<T, Fx>::type> then(Fx f_)
+			{
+				static inline_executor executor;
+				return then(executor, std::move(f_));
+			}
+
+			//! like then(f_), but f_ is submitted to executor_, which must outlive the chain
+			template<typename Executor, typename Fx>
+			future<typename _continuation_result<T, Fx>::type> then(Executor& executor_, Fx f_)
+			{
+				using R = typename _continuation_result<T, Fx>::type;
+
+				auto* prev = _checked();
+
+				if (prev->has_callback())
+					throw std::logic_error("future: already has a continuation");
+
+				auto* state = new _then_state<T, R, Fx, Executor>(prev, std::move(f_), &executor_);
+				state->add_ref(); // released when the continuation has run
+				_state = nullptr;
+				prev->on_ready(state);
+				return future<R>(state);
+			}
+
+			~future()
+			{
+				if (_state)
+					_state->release();
+			}
+
+		private:
+			template<typename U>
+			friend class future;
+
+			template<typename U>
+			friend future<U> _make_future(_future_state<U>* state_);
+
+			template<typename U>
+			friend _future_state<U>* _release_future(future<U>& future_);
+
+			_future_state<T>* _state = nullptr;
+
+			explicit future(_future_state<T>* state_) : _state(state_) { }
+
+			_future_state<T>* _checked() const
+			{
+				if (!_state)
+					throw std::logic_error("future: no state");
+
+				return _state;
+			}
+		};
+
+		template<typename T>
+		future<T> _make_future(_future_state<T>* state_)
+		{
+			return future<T>(state_);
+		}
+
+		//! takes the state (and its reference) out of future_
+		template<typename T>
+		_future_state<T>* _release_future(future<T>& future_)
+		{
+			auto* state = future_._checked();
+
+			if (state->has_callback())
+				throw std::logic_error("future: already has a continuation");
+
+			future_._state = nullptr;
+			return state;
+		}
+
+		//! the producing side of a future for results that do not come from a thread_pool task
+		template<typename T>
+		class promise
+		{
+		public:
+			promise() : _state(new _future_state<T>()) { }
+
+			promise(promise&& other_) noexcept : _state(other_._state)
+			{
+				other_._state = nullptr;
+			}
+
+			promise& operator=(promise&& other_) noexcept
+			{
+				std::swap(_state, other_._state);
+				return *this;
+			}
+
+			promise(const promise&) = delete;
+			promise& operator=(const promise&) = delete;
+
+			//! returns the future of this promise, may be called once
+			future<T> get_future()
+			{
+				if (_retrieved)
+					throw std::logic_error("promise: future already retrieved");
+
+				_retrieved = true;
+				_state->add_ref();
+				return _make_future(_state);
+			}
+
+			template<typename... Args>
+			void set_value(Args&&... args_)
+			{
+				_checked()->set_value(std::forward<Args>(args_)...);
+				_release();
+			}
+
+			void set_exception(std::exception_ptr exception_)
+			{
+				_checked()->set_exception(std::move(exception_));
+				_release();
+			}
+
+			//! fails the future if no result was set
+			~promise()
+			{
+				if (_state)
+					set_exception(std::make_exception_ptr(std::runtime_error("promise: broken promise")));
+			}
+
+		private:
+			_future_state<T>* _state;
+			bool _retrieved = false;
+
+			_future_state<T>* _checked()
+			{
+				if (!_state)
+					throw std::logic_error("promise: already satisfied");
+
+				return _state;
+			}
+
+			void _release()
+			{
+				_state->release();
+				_state = nullptr;
+			}
+		};
+
+		//! collects the results of the antecedents of when_all()
+		template<typename T>
+		struct _when_all_collect
+		{
+			using result_type = std::vector<T>;
+
+			static void apply(_future_state<result_type>& state_, std::vector<_future_state<T>*>& all_)
+			{
+				result_type results;
+				results.reserve(all_.size());
+
+				for (auto* s : all_)
+					results.push_back(std::move(s->value()));
+
+				state_.set_value(std::move(results));
+			}
+		};
+
+		template<>
+		struct _when_all_collect<void>
+		{
+			using result_type = void;
+
+			static void apply(_future_state<void>& state_, std::vector<_future_state<void>*>&)
+			{
+				state_.set_value();
+			}
+		};
+
+		template<typename T>
+		class _when_all_state : public _future_state<typename _when_all_collect<T>::result_type>,
+			public _future_state_base::callback
+		{
+		public:
+			explicit _when_all_state(std::vector<_future_state<T>*> all_)
+				: _all(std::move(all_)), _pending(_all.size() + 1) { }
 
+			void start()
 			{
-				T t;
+				for (auto* s : _all)
+					s->on_ready(this);
+
+				// the extra count keeps the state from completing while callbacks are registered
+				_ready(*this);
+			}
+
+			void _ready(_future_state_base&) override
+			{
+				if (_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return;
+
+				// fails with the exception of the first failed antecedent
+				auto failed = std::find_if(_all.begin(), _all.end(),
+					[](_future_state<T>* s_) { return (bool) s_->exception(); });
+
+				if (failed != _all.end())
+					this->set_exception((*failed)->exception());
+				else
+					_when_all_collect<T>::apply(*this, _all);
+
+				for (auto* s : _all)
+					s->release();
+
+				this->release();
+			}
+
+		private:
+			std::vector<_future_state<T>*> _all;
+			std::atomic<std::size_t> _pending;
+		};
+
+		//! returns a future that completes when all futures_ are complete, with the results
+		//! in the order of futures_ (no value for future<void>)
+		//!
+		//! If any future fails, the returned future fails with the first exception in the
+		//! order of futures_. Consumes futures_.
+		template<typename T>
+		future<typename _when_all_collect<T>::result_type> when_all(std::vector<future<T>> futures_)
+		{
+			std::vector<_future_state<T>*> all;
+			all.reserve(futures_.size());
+
+			for (auto& f : futures_)
+				all.push_back(_release_future(f));
+
+			auto* state = new _when_all_state<T>(std::move(all));
+			state->add_ref(); // released when all antecedents are complete
+			state->start();
+			return _make_future<typename _when_all_collect<T>::result_type>(state);
+		}
+
+		template<typename T>
+		struct when_any_result
+		{
+			//! the index of the first complete future, or npos if there were no futures
+			std::size_t index;
+
+			std::vector<future<T>> futures;
+
+			static const std::size_t npos = (std::size_t) -1;
+		};
+
+		template<typename T>
+		const std::size_t when_any_result<T>::npos;
+
+		template<typename T>
+		class _when_any_state : public _future_state<when_any_result<T>>,
+			public _future_state_base::callback
+		{
+		public:
+			explicit _when_any_state(std::vector<future<T>> futures_)
+				: _futures(std::move(futures_)), _pending(_futures.size() + 1) { }
+
+			void start()
+			{
+				for (auto& f : _futures)
+					_states.push_back(_release_future(f));
+
+				// the futures handed out keep their own references
+				for (std::size_t i = 0; i < _futures.size(); i++) {
+					_states[i]->add_ref();
+					_futures[i] = _make_future(_states[i]);
+				}
+
+				if (_futures.empty()) {
+					this->set_value(when_any_result<T> { when_any_result<T>::npos, {} });
+					_done = true;
+				}
+
+				for (auto* s : _states)
+					s->on_ready(this);
+
+				_finish();
+			}
+
+			void _ready(_future_state_base& state_) override
+			{
+				if (!_done.exchange(true, std::memory_order_acq_rel)) {
+					auto index = std::find(_states.begin(), _states.end(), &state_) - _states.begin();
+					this->set_value(when_any_result<T> { (std::size_t) index, std::move(_futures) });
+				}
+
+				_finish();
+			}
+
+		private:
+			std::vector<future<T>> _futures;
+			std::vector<_future_state<T>*> _states;
+			std::atomic<bool> _done { false };
+			std::atomic<std::size_t> _pending;
+
+			//! drops the reference held for one callback, or for start()
+			void _finish()
+			{
+				if (_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return;
+
+				for (auto* s : _states)
+					s->release();
+
+				this->release();
+			}
+		};
+
+		//! returns a future that completes as soon as one of futures_ completes, with its index
+		//! and all futures_
+		//!
+		//! The returned futures can be waited on and read, but not continued with then().
+		template<typename T>
+		future<when_any_result<T>> when_any(std::vector<future<T>> futures_)
+		{
+			auto* state = new _when_any_state<T>(std::move(futures_));
+			state->add_ref(); // released when every antecedent has called back
+			state->start();
+			return _make_future<when_any_result<T>>(state);
+		}
+
+		//! a Chase-Lev work-stealing deque of pointers
+		//!
+		//! The owner thread pushes and takes at the bottom (LIFO), other threads steal from the
+		//! top (FIFO). The ring grows when full; replaced rings are kept until the deque is
+		//! destroyed because a thief may still read from them.
+		template<typename T>
+		class _work_deque
+		{
+		public:
+			explicit _work_deque(std::size_t capacity_ = 256)
+			{
+				_rings.emplace_back(new ring(capacity_));
+				_ring.store(_rings.back().get(), std::memory_order_relaxed);
+			}
+
+			_work_deque(const _work_deque&) = delete;
+			_work_deque& operator=(const _work_deque&) = delete;
+
+			//! returns the approximate number of items
+			std::size_t size() const
+			{
+				int64_t b = _bottom.load(std::memory_order_relaxed);
+				int64_t t = _top.load(std::memory_order_relaxed);
+				return b > t ? (std::size_t) (b - t) : 0;
+			}
+
+			//! owner only
+			void push(T* item_)
+			{
+				int64_t b = _bottom.load(std::memory_order_relaxed);
+				int64_t t = _top.load(std::memory_order_acquire);
+				ring* r   = _ring.load(std::memory_order_relaxed);
+
+				if (b - t > (int64_t) r->mask)
+					r = _grow(r, b, t);
+
+				r->put(b, item_);
+				std::atomic_thread_fence(std::memory_order_release);
+				_bottom.store(b + 1, std::memory_order_relaxed);
+			}
+
+			//! owner only, returns nullptr if the deque is empty
+			T* take()
+			{
+				int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+				ring* r   = _ring.load(std::memory_order_relaxed);
+				_bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				int64_t t = _top.load(std::memory_order_relaxed);
+
+				if (t > b) {
+					_bottom.store(b + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+
+				T* item = r->get(b);
+
+				// the last item, race against thieves for it
+				if (t == b) {
+					if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+							std::memory_order_relaxed))
+						item = nullptr;
+
+					_bottom.store(b + 1, std::memory_order_relaxed);
+				}
+
+				return item;
+			}
+
+			//! any thread, returns nullptr if the deque is empty or another thread won the race
+			T* steal()
+			{
+				int64_t t = _top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				int64_t b = _bottom.load(std::memory_order_acquire);
+
+				if (t >= b)
+					return nullptr;
+
+				T* item = _ring.load(std::memory_order_acquire)->get(t);
+
+				if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+						std::memory_order_relaxed))
+					return nullptr;
+
+				return item;
+			}
+
+		private:
+			struct ring
+			{
+				std::size_t mask;
+				std::unique_ptr<std::atomic<T*>[]> slots;
+
+				explicit ring(std::size_t capacity_)
+				{
+					std::size_t capacity = 2;
+
+					while (capacity < capacity_)
+						capacity <<= 1;
+
+					mask = capacity - 1;
+					slots.reset(new std::atomic<T*>[capacity]);
+				}
+
+				T* get(int64_t i_) const
+				{
+					return slots[(std::size_t) i_ & mask].load(std::memory_order_relaxed);
+				}
+
+				void put(int64_t i_, T* item_)
+				{
+					slots[(std::size_t) i_ & mask].store(item_, std::memory_order_relaxed);
+				}
+			};
+
+			// padded rather than alignas(64), so that a deque can be a member of a type allocated
+			// with plain new before C++17; top and bottom still never share a cache line
+			std::atomic<int64_t> _top { 0 };
+			char _top_padding[64 - sizeof(std::atomic<int64_t>)];
+			std::atomic<int64_t> _bottom { 0 };
+			char _bottom_padding[64 - sizeof(std::atomic<int64_t>)];
+			std::atomic<ring*> _ring;
+			std::vector<std::unique_ptr<ring>> _rings;
+
+			ring* _grow(ring* old_, int64_t bottom_, int64_t top_)
+			{
+				_rings.emplace_back(new ring((old_->mask + 1) * 2));
+				ring* r = _rings.back().get();
+
+				for (int64_t i = top_; i < bottom_; i++)
+					r->put(i, old_->get(i));
+
+				_ring.store(r, std::memory_order_release);
+				return r;
+			}
+		};
+
+		//! identifies the pool and worker index of the calling thread, if it is a pool worker
+		struct _worker_context
+		{
+			const void* pool;
+			unsigned index;
+		};
+
+		inline _worker_context& _current_worker()
+		{
+			static thread_local _worker_context context { nullptr, 0 };
+			return context;
+		}
+
+		//! hints the cpu that the caller is spinning
+		inline void _cpu_relax()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#elif defined(__aarch64__)
+			asm volatile("yield");
+#else
+			std::this_thread::yield();
+#endif
+		}
+
+		//! how a thread_pool handles queued tasks when it shuts down
+		enum class shutdown_mode
+		{
+			drain, //!< runs all queued tasks, including the ones they submit
+			cancel //!< discards the tasks that have not started
+		};
+
+		//! a fixed set of worker threads that run submitted functors, with work stealing
+		//!
+		//! Every worker owns a Chase-Lev deque. Tasks submitted by a worker of the pool go to
+		//! its own deque and are run LIFO, which keeps fork/join recursion cache-local; tasks
+		//! submitted by other threads go to the shared Queue. An idle worker first takes from
+		//! its deque, then from the shared queue, then steals the oldest task of a random other
+		//! worker.
+		//!
+		//! A worker that finds nothing spins for a while and then parks on a condition
+		//! variable. The spin budget adapts per worker: it grows when parks are cut short by new
+		//! work and shrinks when parks time out, so bursty loads avoid the park/wake round trip
+		//! and an idle pool costs no cpu. Parks time out after park_timeout_ms, which bounds the
+		//! delay of any missed wakeup.
+		//!
+		//! Tasks are stored as concurrency::task, so submitting a small functor does not
+		//! allocate; the deque nodes are recycled through thread-local caches.
+		//!
+		//! Workers are pinned by config::placement or config::cpus. Workers confined to one
+		//! numa node steal from workers of the same node first.
+		//!
+		//! Queue is a queue of concurrency::task with the enqueue(), dequeue_bulk(), empty() and
+		//! size() members of concurrency::queue, e.g. mpmc_queue<task> for less contention
+		//! between many submitting threads.
+		template<typename Queue>
+		class basic_thread_pool
+		{
+		public:
+			struct config
+			{
+				unsigned threads         = std::thread::hardware_concurrency();
+				unsigned max_spin        = 1 << 14; //!< upper bound of the adaptive spin budget
+				unsigned park_timeout_ms = 20;
+				sys::placement placement = sys::placement::none;
+				std::vector<int> cpus    = {}; //!< cpu for worker i, takes precedence over placement
+			};
+
+			//! a snapshot of the pool's counters
+			struct metrics
+			{
+				std::size_t queued = 0;  //!< tasks waiting in the shared queue and all deques
+				unsigned active    = 0;  //!< workers running a task
+				unsigned parked    = 0;  //!< workers parked right now
+				uint64_t executed  = 0;
+				uint64_t stolen    = 0;  //!< tasks taken from another worker's deque
+				uint64_t parks     = 0;
+				uint64_t wakes     = 0;  //!< notifications sent to parked workers
+			};
+
+			explicit basic_thread_pool(unsigned thread_count_ = std::thread::hardware_concurrency())
+				: basic_thread_pool(_config_for(thread_count_)) { }
+
+			explicit basic_thread_pool(const config& config_)
+				: _config(config_), _joiner(_threads)
+			{
+				_config.threads = std::max(1u, _config.threads);
+
+				std::vector<sys::cpu_set> cpus(_config.threads);
+
+				if (_config.placement != sys::placement::none || !_config.cpus.empty())
+					cpus = sys::cpu_topology::local().place(_config.threads, _config.placement, _config.cpus);
+
+				for (unsigned i = 0; i < _config.threads; i++)
+					_workers.emplace_back(new worker(i, _config.max_spin, cpus[i]));
+
+				try {
+					for (unsigned i = 0; i < _config.threads; i++)
+						_threads.emplace_back(&basic_thread_pool::_worker_thread, this, i);
+				} catch(...) {
+					shutdown(shutdown_mode::cancel);
+					throw;
+				}
+			}
+
+			//! drains the pool, see shutdown()
+			~basic_thread_pool()
+			{
+				shutdown(shutdown_mode::drain);
+			}
+
+			std::size_t size() const
+			{
+				return _workers.size();
+			}
+
+			template<typename Fx>
+			void submit(Fx f_)
+			{
+				_worker_context& context = _current_worker();
+
+				if (context.pool == this) {
+					task_t* node = _object_cache<task_t>::acquire();
+					*node = task_t(std::move(f_));
+					_workers[context.index]->tasks.push(node);
+				} else {
+					_task_queue.enqueue(task_t(std::move(f_)));
+				}
+
+				_wake();
+			}
+
+			//! like submit(), but returns the future of f_'s result
+			//!
+			//! The functor and the result share one allocation with the future's state, the
+			//! queued task only carries a pointer to it.
+			template<typename Fx>
+			future<decltype(std::declval<Fx&>()())> async(Fx f_)
+			{
+				using R = decltype(std::declval<Fx&>()());
+
+				auto* state = new _task_state<R, Fx>(std::move(f_));
+				state->add_ref(); // released when the task has run or is cancelled
+				submit(_task_runner<R, Fx>(state));
+				return _make_future<R>(state);
+			}
+
+			//! runs one queued task on the calling thread, returns false if there was none
+			//!
+			//! A task that waits for tasks it submitted can help with this instead of blocking
+			//! a worker.
+			bool try_run_one()
+			{
+				_worker_context& context = _current_worker();
+				unsigned self = context.pool == this ? context.index : (unsigned) _workers.size();
+				return _run_one(self);
+			}
+
+			//! stops the workers and joins them, must not be called from a worker
+			//!
+			//! With shutdown_mode::drain the workers first run every queued task, including the
+			//! tasks those submit. With shutdown_mode::cancel they finish the tasks they are
+			//! running and the remaining tasks are destroyed without running. Tasks must not be
+			//! submitted from other threads once shutdown() has been called. Calling it again
+			//! has no effect.
+			void shutdown(shutdown_mode mode_ = shutdown_mode::drain)
+			{
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+
+					if (_stopping)
+						return;
+
+					_cancel   = mode_ == shutdown_mode::cancel;
+					_stopping = true;
+				}
+
+				_condition.notify_all();
+
+				for (auto& t : _threads)
+					if (t.joinable())
+						t.join();
+
+				for (auto& w : _workers)
+					while (task_t* task = w->tasks.take())
+						delete task;
+
+				task_t task;
+
+				while (_task_queue.dequeue(task))
+					;
+			}
+
+			metrics statistics() const
+			{
+				metrics m;
+				m.queued = _task_queue.size();
+				m.wakes  = _wakes.load(std::memory_order_relaxed);
+				m.parked = _sleepers.load(std::memory_order_relaxed);
+
+				for (auto& w : _workers) {
+					m.queued   += w->tasks.size();
+					m.active   += w->busy.load(std::memory_order_relaxed) ? 1 : 0;
+					m.executed += w->executed.load(std::memory_order_relaxed);
+					m.stolen   += w->stolen.load(std::memory_order_relaxed);
+					m.parks    += w->parks.load(std::memory_order_relaxed);
+				}
+
+				return m;
+			}
+
+		private:
+			using task_t = task;
+
+			//! per worker state, the counters are only written by the worker itself
+			struct worker
+			{
+				_work_deque<task_t> tasks;
+				uint64_t rng;
+				unsigned spin;
+				std::atomic<bool> busy { false };
+				std::atomic<uint64_t> executed { 0 };
+				std::atomic<uint64_t> stolen { 0 };
+				std::atomic<uint64_t> parks { 0 };
+				sys::cpu_set cpus; //!< empty if the worker is not pinned
+				int node = -1;     //!< numa node of all of cpus, -1 if unpinned or mixed
+
+				worker(unsigned index_, unsigned max_spin_, sys::cpu_set cpus_)
+					: rng(0x9e3779b97f4a7c15ULL * (index_ + 1)), spin(std::min(max_spin_, 256u)),
+					  cpus(std::move(cpus_))
+				{
+					for (int cpu : cpus.cpus()) {
+						int n = sys::cpu_topology::local().node_of(cpu);
+						node = cpu == cpus[0] || n == node ? n : -1;
+
+						if (node < 0)
+							break;
+					}
+				}
+
+				void count(std::atomic<uint64_t>& counter_)
+				{
+					counter_.store(counter_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				}
+			};
+
+			static const std::size_t BATCH_SIZE = 16;
+
+			config _config;
+			Queue _task_queue;
+			std::vector<std::unique_ptr<worker>> _workers;
+			std::mutex _mutex;
+			std::condition_variable _condition;
+			std::atomic<unsigned> _sleepers { 0 };
+			std::atomic<unsigned> _signals { 0 }; //!< notifications not yet taken by a sleeper
+			std::atomic<uint64_t> _wakes { 0 };
+			std::atomic<bool> _stopping { false };
+			bool _cancel = false;
+			std::vector<std::thread> _threads;
+			thread_joiner _joiner;
+
+			static config _config_for(unsigned thread_count_)
+			{
+				config c;
+				c.threads = thread_count_;
+				return c;
+			}
+
+			//! self_ is the index of the calling worker or size() for other threads
+			bool _run_one(unsigned self_)
+			{
+				worker* w = self_ < _workers.size() ? _workers[self_].get() : nullptr;
+
+				if (w) {
+					if (task_t* task = w->tasks.take()) {
+						_run(w, task);
+						return true;
+					}
+				}
+
+				// a worker takes a burst from the shared queue with one lock and keeps the rest
+				// in its deque, where other workers can steal them
+				task_t batch[BATCH_SIZE];
+				std::size_t count = _task_queue.dequeue_bulk(batch, w ? BATCH_SIZE : 1);
+
+				if (count > 0) {
+					// reversed, so that the owner's LIFO takes run them in submission order
+					for (std::size_t i = count - 1; i > 0; i--) {
+						task_t* node = _object_cache<task_t>::acquire();
+						*node = std::move(batch[i]);
+						w->tasks.push(node);
+					}
+
+					if (count > 1)
+						_wake();
+
+					if (w)
+						w->count(w->executed);
+
+					batch[0]();
+					return true;
+				}
+
+				return _steal(self_, w);
+			}
+
+			bool _steal(unsigned self_, worker* w_)
+			{
+				std::size_t count = _workers.size();
+				uint64_t seed = w_ ? _next_random(*w_)
+					: (uint64_t) std::hash<std::thread::id>()(std::this_thread::get_id());
+
+				// start at a random victim and try each other worker once, workers pinned to a
+				// numa node try the victims on their own node first
+				int node = w_ ? w_->node : -1;
+
+				for (std::size_t i = 0, start = seed % count; i < (node < 0 ? count : 2 * count); i++) {
+					std::size_t victim = (start + i) % count;
+
+					if (victim == self_ || (node >= 0 && (i < count) != (_workers[victim]->node == node)))
+						continue;
+
+					if (task_t* task = _workers[victim]->tasks.steal()) {
+						if (w_)
+							w_->count(w_->stolen);
+
+						_run(w_, task);
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			static uint64_t _next_random(worker& w_)
+			{
+				// xorshift64
+				w_.rng ^= w_.rng << 13;
+				w_.rng ^= w_.rng >> 7;
+				w_.rng ^= w_.rng << 17;
+				return w_.rng;
+			}
+
+			static void _run(worker* w_, task_t* task_)
+			{
+				// recycles the deque node, also if the task throws into try_run_one()'s caller
+				struct recycle
+				{
+					task_t* node;
+
+					~recycle()
+					{
+						*node = nullptr;
+						_object_cache<task_t>::release(node);
+					}
+				} guard { task_ };
+
+				if (w_)
+					w_->count(w_->executed);
+
+				(*task_)();
+			}
+
+			bool _has_work() const
+			{
+				if (!_task_queue.empty())
+					return true;
+
+				for (auto& w : _workers)
+					if (w->tasks.size() > 0)
+						return true;
+
+				return false;
+			}
+
+			//! returns true if the calling worker may exit: the pool is cancelled, or it is
+			//! drained and no other worker runs a task that could submit more
+			bool _may_exit() const
+			{
+				if (_cancel)
+					return true;
+
+				if (_has_work())
+					return false;
+
+				for (auto& w : _workers)
+					if (w->busy.load(std::memory_order_seq_cst))
+						return false;
+
+				// a worker that finished a task after the first check may have submitted more
+				return !_has_work();
+			}
+
+			void _wake()
+			{
+				// pairs with the fence in _park(): either we see the sleeper or it sees the task
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				// skip the mutex if every sleeper already has a wakeup on its way
+				if (_signals.load(std::memory_order_relaxed) >= _sleepers.load(std::memory_order_relaxed))
+					return;
+
+				std::lock_guard<std::mutex> lock(_mutex);
 
-				if (_use_buffer) {
-					while (!_eof()) {
-						_stream.read((char*) &t, sizeof(T));
-						_data.push_back(t);
-					}
-					_iter = std::begin(_data);
+				if (_signals.load(std::memory_order_relaxed) < _sleepers.load(std::memory_order_relaxed)) {
+					_signals.fetch_add(1, std::memory_order_relaxed);
+					_wakes.fetch_add(1, std::memory_order_relaxed);
+					_condition.notify_one();
 				}
 			}
 
-			bool next(T& t_)
+			//! parks the calling worker, returns true if it was woken before the timeout
+			bool _park(worker& w_)
 			{
-				if (_use_buffer)
-					t_ = *(_iter++);
-				else
-					_stream.read((char*) &t_, sizeof(T));
+				std::unique_lock<std::mutex> lock(_mutex);
+				_sleepers.fetch_add(1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				w_.count(w_.parks);
 
-				return !done();
+				bool woken = _condition.wait_for(lock, std::chrono::milliseconds(_config.park_timeout_ms),
+					[this]() { return _stopping || _has_work(); });
+
+				if (_signals.load(std::memory_order_relaxed) > 0)
+					_signals.fetch_sub(1, std::memory_order_relaxed);
+
+				_sleepers.fetch_sub(1, std::memory_order_relaxed);
+				return woken;
 			}
 
-			void reset()
+			//! runs one task, returns false if there was none
+			bool _work(unsigned index_, worker& w_)
 			{
-				if (_use_buffer)
-					_iter = std::begin(_data);
-				else
-					_reset();
+				// announce the attempt before taking a task, see _may_exit()
+				w_.busy.store(true, std::memory_order_seq_cst);
+				bool ran = _run_one(index_);
+				w_.busy.store(false, std::memory_order_release);
+				return ran;
 			}
 
-			bool done()
+			void _worker_thread(unsigned index_)
 			{
-				return _use_buffer ? _iter == _data.end() : _eof();
-			}
+				_current_worker() = _worker_context { this, index_ };
+				worker& w = *_workers[index_];
 
-			virtual ~simple_binary_reader() = default;
+				// pinned before running anything, so memory the tasks touch first is node local
+				if (!w.cpus.empty())
+					w.cpus.pin();
 
-		private:
-			bool _use_buffer;
-			std::vector<T> _data;
-			typename std::vector<T>::const_iterator _iter;
+				for (;;) {
+					bool stopping = _stopping.load(std::memory_order_acquire);
+
+					if (stopping && _cancel)
+						return;
+
+					if (_work(index_, w))
+						continue;
+
+					if (stopping) {
+						if (_may_exit())
+							return;
+
+						// other workers still run tasks that may submit more
+						std::this_thread::yield();
+						continue;
+					}
+
+					bool found = false;
+
+					for (unsigned i = 0; i < w.spin && !found; i++) {
+						_cpu_relax();
+
+						// the check takes locks and touches other workers' cache lines, so only
+						// every few iterations
+						if (i % 16 == 15)
+							found = _has_work() || _stopping.load(std::memory_order_relaxed);
+					}
+
+					if (found)
+						continue;
+
+					// a park that ends with work means spinning a bit longer would have caught it
+					if (_park(w))
+						w.spin = std::min(_config.max_spin, std::max(16u, w.spin * 2));
+					else
+						w.spin /= 2;
+				}
+			}
 		};
 
-		template <typename T>
-		class simple_binary_writer : public _file_stream
+		template<typename Queue>
+		const std::size_t basic_thread_pool<Queue>::BATCH_SIZE;
+
+		using thread_pool = basic_thread_pool<queue<task>>;
+
+		//! runs chunk_(i) for every i in [0, count_), on the calling thread and on up to size()
+		//! workers of pool_
+		//!
+		//! The chunks are claimed one at a time from a shared counter, so faster threads take
+		//! more of them. The caller works through the chunks itself and then helps with other
+		//! tasks of the pool until the chunks claimed by others are done; it never waits for a
+		//! helper task to start, so nested use from inside the pool's tasks cannot deadlock. The
+		//! first exception thrown by a chunk skips the remaining chunks and is rethrown.
+		template<typename Pool, typename Fx>
+		void _parallel_chunks(Pool& pool_, std::size_t count_, Fx chunk_)
 		{
-		public:
-			explicit simple_binary_writer(const std::string& file_name_)
-				: _file_stream(file_name_, std::ios::binary | std::ios::out) { }
+			if (count_ <= 1) {
+				if (count_ == 1)
+					chunk_(0);
 
-			//! writes t_ to the file
-			void write(const T& t_)
+				return;
+			}
+
+			// shared with the helper tasks, which may start after the caller returned
+			struct state
 			{
-				_stream.write((char*)&t_, sizeof(T));
+				std::size_t count;
+				Fx chunk;
+				std::atomic<std::size_t> next { 0 };
+				std::atomic<std::size_t> done { 0 };
+				std::atomic<bool> failed { false };
+				std::exception_ptr error;
+
+				state(std::size_t count_, Fx chunk_) : count(count_), chunk(std::move(chunk_)) { }
+
+				void run()
+				{
+					for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; ) {
+						if (!failed.load(std::memory_order_relaxed)) {
+							try {
+								chunk(i);
+							} catch (...) {
+								if (!failed.exchange(true))
+									error = std::current_exception();
+							}
+						}
+
+						done.fetch_add(1, std::memory_order_release);
+					}
+				}
+			};
+
+			std::shared_ptr<state> s = std::make_shared<state>(count_, std::move(chunk_));
+			std::size_t helpers = std::min<std::size_t>(pool_.size(), count_ - 1);
+
+			for (std::size_t i = 0; i < helpers; i++)
+				pool_.submit([s]() { s->run(); });
+
+			s->run();
+
+			while (s->done.load(std::memory_order_acquire) < count_)
+				if (!pool_.try_run_one())
+					std::this_thread::yield();
+
+			if (s->error)
+				std::rethrow_exception(s->error);
+		}
+
+		//! returns grain_, or if it is 0 a chunk size that gives each worker of pool_ about
+		//! eight chunks of the count_ elements for load balancing
+		template<typename Pool>
+		std::size_t _grain_size(const Pool& pool_, std::size_t count_, std::size_t grain_)
+		{
+			std::size_t chunks = 8 * std::max<std::size_t>(1, pool_.size());
+			return grain_ > 0 ? grain_ : std::max<std::size_t>(1, count_ / chunks);
+		}
+
+		//! calls f_(i) for each index in [first_, last_) on pool_ and the calling thread, in
+		//! chunks of grain_ indices (0 picks a size), see _parallel_chunks()
+		template<typename Pool, typename Index, typename Fx>
+		typename std::enable_if<std::is_integral<Index>::value>::type
+		parallel_for(Pool& pool_, Index first_, Index last_, Fx f_, std::size_t grain_ = 0)
+		{
+			if (!(first_ < last_))
+				return;
+
+			std::size_t count = (std::size_t) (last_ - first_);
+			std::size_t grain = _grain_size(pool_, count, grain_);
+
+			_parallel_chunks(pool_, (count + grain - 1) / grain, [&](std::size_t chunk_) {
+				Index end = (Index) (first_ + std::min(count, (chunk_ + 1) * grain));
+
+				for (Index i = (Index) (first_ + chunk_ * grain); i < end; i++)
+					f_(i);
+			});
+		}
+
+		//! calls f_(element) for each element of the random access range [first_, last_), see
+		//! parallel_for() over indices
+		template<typename Pool, typename It, typename Fx>
+		typename std::enable_if<!std::is_integral<It>::value>::type
+		parallel_for(Pool& pool_, It first_, It last_, Fx f_, std::size_t grain_ = 0)
+		{
+			parallel_for(pool_, std::size_t(0), (std::size_t) (last_ - first_),
+				[&](std::size_t i_) { f_(first_[i_]); }, grain_);
+		}
+
+		//! writes f_(element) for each element of the random access range [first_, last_) to
+		//! the random access range at out_, returns the end of the output
+		template<typename Pool, typename It, typename OutputIt, typename Fx>
+		OutputIt parallel_transform(Pool& pool_, It first_, It last_, OutputIt out_, Fx f_,
+			std::size_t grain_ = 0)
+		{
+			std::size_t count = (std::size_t) (last_ - first_);
+
+			parallel_for(pool_, std::size_t(0), count,
+				[&](std::size_t i_) { out_[i_] = f_(first_[i_]); }, grain_);
+
+			return out_ + count;
+		}
+
+		//! combines map_(i) for each index in [first_, last_) with reduce_, starting from
+		//! identity_
+		//!
+		//! Every chunk is reduced on its own and the partial results are combined in index
+		//! order, so reduce_ must be associative but need not be commutative.
+		template<typename Pool, typename Index, typename T, typename Map, typename Reduce>
+		typename std::enable_if<std::is_integral<Index>::value, T>::type
+		parallel_reduce(Pool& pool_, Index first_, Index last_, T identity_, Map map_, Reduce reduce_,
+			std::size_t grain_ = 0)
+		{
+			if (!(first_ < last_))
+				return identity_;
+
+			std::size_t count = (std::size_t) (last_ - first_);
+			std::size_t grain = _grain_size(pool_, count, grain_);
+			std::vector<T> partial((count + grain - 1) / grain, identity_);
+
+			_parallel_chunks(pool_, partial.size(), [&](std::size_t chunk_) {
+				Index end = (Index) (first_ + std::min(count, (chunk_ + 1) * grain));
+				T value = identity_;
+
+				for (Index i = (Index) (first_ + chunk_ * grain); i < end; i++)
+					value = reduce_(std::move(value), map_(i));
+
+				partial[chunk_] = std::move(value);
+			});
+
+			T result = std::move(identity_);
+
+			for (auto& value : partial)
+				result = reduce_(std::move(result), std::move(value));
+
+			return result;
+		}
+
+		//! combines the elements of the random access range [first_, last_) with reduce_,
+		//! starting from identity_, see parallel_reduce() over indices
+		template<typename Pool, typename It, typename T, typename Reduce>
+		typename std::enable_if<!std::is_integral<It>::value, T>::type
+		parallel_reduce(Pool& pool_, It first_, It last_, T identity_, Reduce reduce_,
+			std::size_t grain_ = 0)
+		{
+			return parallel_reduce(pool_, std::size_t(0), (std::size_t) (last_ - first_),
+				std::move(identity_), [&](std::size_t i_) -> decltype(*first_) { return first_[i_]; },
+				reduce_, grain_);
+		}
+
+		//! sorts the random access range [first_, last_) with comp_
+		//!
+		//! Runs of grain_ elements (0 picks about one run per worker, at least 4096 elements)
+		//! are sorted in parallel with std::sort and then merged pairwise, the pairs of each
+		//! round in parallel. Not stable.
+		template<typename Pool, typename It, typename Compare>
+		void parallel_sort(Pool& pool_, It first_, It last_, Compare comp_, std::size_t grain_ = 0)
+		{
+			std::size_t count = (std::size_t) (last_ - first_);
+			std::size_t grain = grain_ > 0 ? grain_
+				: std::max<std::size_t>(4096, count / std::max<std::size_t>(1, pool_.size()));
+			std::size_t runs = (count + grain - 1) / grain;
+
+			_parallel_chunks(pool_, runs, [&](std::size_t run_) {
+				std::sort(first_ + run_ * grain, first_ + std::min(count, (run_ + 1) * grain), comp_);
+			});
+
+			for (std::size_t width = grain; width < count; width *= 2) {
+				_parallel_chunks(pool_, (count + 2 * width - 1) / (2 * width), [&](std::size_t pair_) {
+					std::size_t begin = pair_ * 2 * width;
+					std::size_t mid   = std::min(count, begin + width);
+
+					if (mid < count)
+						std::inplace_merge(first_ + begin, first_ + mid,
+							first_ + std::min(count, begin + 2 * width), comp_);
+				});
 			}
-		};
-	}
+		}
 
-	namespace concurrency {
+		//! sorts the random access range [first_, last_) in ascending order
+		template<typename Pool, typename It>
+		void parallel_sort(Pool& pool_, It first_, It last_)
+		{
+			parallel_sort(pool_, first_, last_, std::less<typename std::iterator_traits<It>::value_type>());
+		}
 
-		//! a simple thread-safe wrapper around std::queue
-		template<typename T>
-		class queue
+#ifdef __linux__
+		//! a ring of variable-length records in shared memory for passing messages between
+		//! processes (or threads) without system calls
+		//!
+		//! The ring lives in a memfd, other processes attach to it through an inherited or passed
+		//! file descriptor. Records start on cache line boundaries and are consumed in place.
+		//! There is one consumer and either one or many producers. A side only sleeps on a futex
+		//! in the shared memory when the ring is empty (consumer) or full (producer), and the other
+		//! side only calls futex_wake when it sees a sleeper, so a busy ring costs no syscalls.
+		class shm_ring : public sys::file_descriptor
 		{
 		public:
-			queue() = default;
+			enum class producers { single, multiple };
 
-			//! enqueues an element
-			void enqueue(T item_)
+			static const std::size_t ALIGNMENT = 64;
+			static const std::size_t RECORD_HEADER_SIZE = 16;
+
+			//! creates a ring with capacity_ bytes (rounded up to a power of two, at least 4 KiB)
+			shm_ring(const std::string& name_, std::size_t capacity_,
+				producers producers_ = producers::single)
 			{
-				std::lock_guard<std::mutex> lock(_mutex);
-				_queue.push(std::move(item_));
-				_condition.notify_one();
+				std::size_t capacity = 4096;
+
+				while (capacity < capacity_)
+					capacity <<= 1;
+
+				if ((_fd = ::memfd_create(name_.c_str(), MFD_CLOEXEC)) == -1)
+					throw std::runtime_error("shm_ring: could not create: errno: "
+						+ std::to_string(errno));
+
+				if (::ftruncate(_fd, (off_t) (_data_offset() + capacity))) {
+					int err = errno;
+					::close(_fd);
+					throw std::runtime_error("shm_ring: could not resize: errno: "
+						+ std::to_string(err));
+				}
+
+				_map(_data_offset() + capacity);
+
+				_header = new (_base) header();
+				_header->magic          = MAGIC;
+				_header->capacity       = capacity;
+				_header->multi_producer = producers_ == producers::multiple;
+				_init();
 			}
 
-			//! dequeues an element, blocks if the queue is empty
-			void dequeue_wait(T& item_)
+			//! attaches to the ring of another shm_ring through a copy of its file descriptor
+			explicit shm_ring(int fd_)
 			{
-				std::unique_lock<std::mutex> lock(_mutex);
-				_condition.wait(lock, [this]() { return !_queue.empty(); });
-				item_ = std::move(_queue.front());
-				_queue.pop();
+				struct stat st {};
+
+				if ((_fd = ::fcntl(fd_, F_DUPFD_CLOEXEC, 0)) == -1 || ::fstat(_fd, &st))
+					throw std::runtime_error("shm_ring: could not attach: errno: "
+						+ std::to_string(errno));
+
+				if ((std::size_t) st.st_size < _data_offset()) {
+					::close(_fd);
+					throw std::invalid_argument("shm_ring: not a ring");
+				}
+
+				_map((std::size_t) st.st_size);
+				_header = (header*) _base;
+
+				if (_header->magic != MAGIC
+					|| _data_offset() + _header->capacity != (std::size_t) st.st_size) {
+					_unmap();
+					throw std::invalid_argument("shm_ring: not a ring");
+				}
+
+				_init();
 			}
 
-			//! tries to dequeue an element, returns false if queue is empty
-			bool dequeue(T& item_)
+			shm_ring(const shm_ring&) = delete;
+			shm_ring& operator=(const shm_ring&) = delete;
+
+			//! returns the size of the record area in bytes
+			std::size_t capacity() const
 			{
-				std::lock_guard<std::mutex> lock(_mutex);
+				return _capacity;
+			}
+
+			//! returns the largest record payload accepted by send()
+			std::size_t max_record_size() const
+			{
+				return _capacity / 2 - RECORD_HEADER_SIZE;
+			}
+
+			//! returns true if no records are reserved or committed
+			bool empty() const
+			{
+				return _header->head.load(std::memory_order_acquire)
+					== _header->tail.load(std::memory_order_acquire);
+			}
+
+			//! copies a record into the ring, returns false if the ring is full
+			bool try_send(const void* data_, uint32_t len_)
+			{
+				if (len_ > max_record_size())
+					throw std::invalid_argument("shm_ring: record too large");
+
+				uint64_t size = _slot_size(len_), pos, pad;
 
-				if(_queue.empty())
+				if (!_reserve(size, pos, pad))
 					return false;
 
-				item_ = std::move(_queue.front());
-				_queue.pop();
+				if (pad > 0)
+					_commit(pos, 0, true);
+
+				std::memcpy(_record(pos + pad) + RECORD_HEADER_SIZE, data_, len_);
+				_commit(pos + pad, len_, false);
+				_wake(_header->consumer_wait);
 				return true;
 			}
 
-			//! checks if the queue is empty
-			bool empty() const
+			//! copies a record into the ring, waits up to timeout_ms_ (-1: forever) while it is full
+			//!
+			//! Returns false on timeout.
+			bool send(const void* data_, uint32_t len_, int timeout_ms_ = -1)
 			{
-				std::lock_guard<std::mutex> lock(_mutex);
-				return _queue.empty();
+				auto start = std::chrono::steady_clock::now();
+
+				for (unsigned spins = 0; !try_send(data_, len_); spins++) {
+					if (spins < SPINS)
+						continue;
+
+					int remaining = _remaining_ms(start, timeout_ms_);
+
+					if (remaining == 0)
+						return false;
+
+					_wait(_header->producer_wait, [this, len_]() {
+						return _header->tail.load(std::memory_order_relaxed)
+							+ 2 * _slot_size(len_) - _header->head.load(std::memory_order_relaxed)
+							<= _capacity;
+					}, remaining);
+				}
+
+				return true;
 			}
 
-		private:
-			mutable std::mutex _mutex;
-			std::queue<T> _queue;
-			std::condition_variable _condition;
-		};
+			//! consumes up to max_ committed records without waiting, calls
+			//! handler_(const unsigned char* data, uint32_t len) for each record in place
+			//!
+			//! The record memory is handed back to producers when the call returns. Returns the
+			//! number of records consumed.
+			template<typename Fx>
+			unsigned try_receive(Fx handler_, unsigned max_ = ~0u)
+			{
+				uint64_t head  = _header->head.load(std::memory_order_relaxed);
+				uint64_t start = head;
+				unsigned count = 0;
 
-		class thread_joiner
-		{
-		public:
-			explicit thread_joiner(std::vector<std::thread>& threads_) : _threads(threads_) { }
+				while (count < max_) {
+					unsigned char* rec = _record(head);
+					auto* tag = (std::atomic<uint64_t>*) rec;
 
-			~thread_joiner()
+					if (tag->load(std::memory_order_acquire) != head + 1)
+						break;
+
+					uint32_t len, flags;
+					std::memcpy(&len, rec + 8, sizeof(len));
+					std::memcpy(&flags, rec + 12, sizeof(flags));
+
+					uint64_t size = flags & FLAG_PADDING ? _capacity - (head & _mask)
+						: _slot_size(len);
+
+					if (!(flags & FLAG_PADDING)) {
+						handler_((const unsigned char*) rec + RECORD_HEADER_SIZE, len);
+						count++;
+					}
+
+					head += size;
+				}
+
+				if (head != start) {
+					_clear(start, head);
+					_header->head.store(head, std::memory_order_release);
+					_wake(_header->producer_wait);
+				}
+
+				return count;
+			}
+
+			//! like try_receive() but waits up to timeout_ms_ (-1: forever) for the first record,
+			//! returns 0 on timeout
+			template<typename Fx>
+			unsigned receive(Fx handler_, int timeout_ms_ = -1, unsigned max_ = ~0u)
 			{
-				for (auto& t : _threads)
-					if (t.joinable()) t.join();
+				auto start = std::chrono::steady_clock::now();
+
+				for (unsigned spins = 0; ; spins++) {
+					unsigned n = try_receive(handler_, max_);
+
+					if (n > 0)
+						return n;
+
+					if (spins < SPINS)
+						continue;
+
+					int remaining = _remaining_ms(start, timeout_ms_);
+
+					if (remaining == 0)
+						return 0;
+
+					_wait(_header->consumer_wait, [this]() { return _committed(); }, remaining);
+				}
+			}
+
+			~shm_ring()
+			{
+				_unmap();
 			}
 
 		private:
-			std::vector<std::thread>& _threads;
-		};
+			static const uint64_t MAGIC = 0x676e69726d68736fULL; // "oshmring"
+			static const uint32_t FLAG_PADDING = 1;
+			static const unsigned SPINS = 256;
 
-		class thread_pool
-		{
-		public:
-			explicit thread_pool(unsigned thread_count_ = std::thread::hardware_concurrency())
-				: _done(false), _joiner(_threads)
+			//! the sleepers of one side: with many producers several may sleep at once
+			struct sleepers
 			{
-				try {
-					for (unsigned i = 0; i < thread_count_; i++)
-						_threads.emplace_back(&thread_pool::_worker_thread, this);
-				} catch(...) {
-					_done = true;
-					throw;
+				std::atomic<uint32_t> count { 0 }; //!< threads inside _wait()
+				std::atomic<uint32_t> seq { 0 };   //!< the futex word, bumped by every wake
+			};
+
+			//! the shared control block, followed by the record area
+			struct header
+			{
+				uint64_t magic          = 0;
+				uint64_t capacity       = 0;
+				uint32_t multi_producer = 0;
+
+				alignas(64) std::atomic<uint64_t> head { 0 };
+				sleepers producer_wait;
+
+				alignas(64) std::atomic<uint64_t> tail { 0 };
+				sleepers consumer_wait;
+			};
+
+			unsigned char* _base = nullptr;
+			std::size_t _map_size = 0;
+			header* _header = nullptr;
+			unsigned char* _data = nullptr;
+			std::size_t _capacity = 0;
+			uint64_t _mask = 0;
+			uint64_t _cached_head = 0; // single producer only, saves reading the consumer's line
+
+			static constexpr std::size_t _data_offset()
+			{
+				return (sizeof(header) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+			}
+
+			static uint64_t _slot_size(uint32_t len_)
+			{
+				return (RECORD_HEADER_SIZE + len_ + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+			}
+
+			static int _remaining_ms(std::chrono::steady_clock::time_point start_, int timeout_ms_)
+			{
+				if (timeout_ms_ < 0)
+					return -1;
+
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start_).count();
+				return elapsed >= timeout_ms_ ? 0 : (int) (timeout_ms_ - elapsed);
+			}
+
+			void _map(std::size_t size_)
+			{
+				void* base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+
+				if (base == MAP_FAILED) {
+					int err = errno;
+					::close(_fd);
+					_fd = -1;
+					throw std::runtime_error("shm_ring: could not map: errno: "
+						+ std::to_string(err));
 				}
+
+				_base = (unsigned char*) base;
+				_map_size = size_;
 			}
 
-			~thread_pool()
+			void _unmap()
 			{
-				_done = true;
+				if (_base)
+					::munmap(_base, _map_size);
+
+				if (_fd != -1)
+					::close(_fd);
+
+				_base = nullptr;
+				_fd = -1;
 			}
 
-			template<typename Fx>
-			void submit(Fx f_)
+			void _init()
 			{
-				_task_queue.enqueue(std::function<void()>(f_));
+				_data     = _base + _data_offset();
+				_capacity = (std::size_t) _header->capacity;
+				_mask     = _capacity - 1;
+				_cached_head = _header->head.load(std::memory_order_acquire);
 			}
 
-		private:
-			std::atomic_bool _done;
-			queue<std::function<void()>> _task_queue;
-			std::vector<std::thread> _threads;
-			thread_joiner _joiner;
+			unsigned char* _record(uint64_t pos_) const
+			{
+				return _data + (pos_ & _mask);
+			}
 
-			void _worker_thread()
+			//! returns true if the record at the head is committed
+			bool _committed() const
 			{
-				while (!_done) {
-					std::function<void()> task;
+				uint64_t head = _header->head.load(std::memory_order_relaxed);
+				return ((std::atomic<uint64_t>*) _record(head))->load(std::memory_order_acquire)
+					== head + 1;
+			}
 
-					if (_task_queue.dequeue(task)) {
-						task();
-					} else {
-						std::this_thread::yield();
+			//! reserves size_ bytes (plus padding up to the end of the record area if the record
+			//! would wrap), sets pos_ to the reserved position
+			bool _reserve(uint64_t size_, uint64_t& pos_, uint64_t& pad_)
+			{
+				uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+
+				for (;;) {
+					uint64_t off = tail & _mask;
+					pad_ = off + size_ > _capacity ? _capacity - off : 0;
+
+					if (!_header->multi_producer) {
+						if (tail + pad_ + size_ - _cached_head > _capacity) {
+							_cached_head = _header->head.load(std::memory_order_acquire);
+
+							if (tail + pad_ + size_ - _cached_head > _capacity)
+								return false;
+						}
+
+						_header->tail.store(tail + pad_ + size_, std::memory_order_relaxed);
+						break;
 					}
+
+					uint64_t head = _header->head.load(std::memory_order_acquire);
+
+					if (tail + pad_ + size_ - head > _capacity)
+						return false;
+
+					if (_header->tail.compare_exchange_weak(tail, tail + pad_ + size_,
+						std::memory_order_relaxed))
+						break;
+				}
+
+				pos_ = tail;
+				return true;
+			}
+
+			//! publishes the record at pos_ to the consumer
+			void _commit(uint64_t pos_, uint32_t len_, bool padding_)
+			{
+				unsigned char* rec = _record(pos_);
+				uint32_t flags = padding_ ? FLAG_PADDING : 0;
+				std::memcpy(rec + 8, &len_, sizeof(len_));
+				std::memcpy(rec + 12, &flags, sizeof(flags));
+				((std::atomic<uint64_t>*) rec)->store(pos_ + 1, std::memory_order_release);
+			}
+
+			//! clears the tag of every cache line in [begin_, end_), so that stale bytes are never
+			//! mistaken for a committed record header
+			void _clear(uint64_t begin_, uint64_t end_)
+			{
+				for (uint64_t pos = begin_; pos < end_; pos += ALIGNMENT)
+					((std::atomic<uint64_t>*) _record(pos))->store(0, std::memory_order_relaxed);
+			}
+
+			//! sleeps on s_ until woken, ready_() becomes true or timeout_ms_ elapses
+			//!
+			//! A wake bumps the sequence number, so one read before ready_() makes FUTEX_WAIT
+			//! return at once if a wake slipped in between.
+			template<typename Fx>
+			void _wait(sleepers& s_, Fx ready_, int timeout_ms_)
+			{
+				s_.count.fetch_add(1, std::memory_order_seq_cst);
+				uint32_t seq = s_.seq.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (!ready_()) {
+					struct timespec ts { timeout_ms_ / 1000, (long) (timeout_ms_ % 1000) * 1000000 };
+					::syscall(SYS_futex, (uint32_t*) &s_.seq, FUTEX_WAIT, seq,
+						timeout_ms_ < 0 ? nullptr : &ts, nullptr, 0);
+				}
+
+				s_.count.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			//! wakes all sleepers of the other side, if there are any
+			void _wake(sleepers& s_)
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (s_.count.load(std::memory_order_relaxed) > 0) {
+					s_.seq.fetch_add(1, std::memory_order_release);
+					::syscall(SYS_futex, (uint32_t*) &s_.seq, FUTEX_WAKE, INT32_MAX, nullptr,
+						nullptr, 0);
 				}
 			}
 		};
+#endif
 	}
 
 	namespace etc {
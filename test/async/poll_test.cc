@@ -17,4 +17,36 @@ TEST_CASE("async::poll", "[async][poll]")
 
 		REQUIRE_NOTHROW(poll.block());
 	}
+
+	SECTION("dispatches to the callback of each fd")
+	{
+		om::async::poll poll;
+		std::vector<int> pipes(2 * 16);
+		std::vector<int> called(16, 0);
+		unsigned total = 0;
+
+		for (unsigned i = 0; i < 16; i++) {
+			REQUIRE(::pipe(&pipes[2 * i]) == 0);
+			poll.add_fd(pipes[2 * i], [&, i](int fd_, om::async::poll::event) {
+				char c;
+				CHECK(::read(fd_, &c, 1) == 1);
+				CHECK(fd_ == pipes[2 * i]);
+				called[i]++;
+
+				if (++total == 16)
+					poll.stop();
+			});
+		}
+
+		for (unsigned i = 0; i < 16; i++)
+			CHECK(::write(pipes[2 * i + 1], "x", 1) == 1);
+
+		poll.block();
+
+		for (unsigned i = 0; i < 16; i++)
+			CHECK(called[i] == 1);
+
+		for (int fd : pipes)
+			::close(fd);
+	}
 }
@@ -0,0 +1,296 @@
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+#ifdef __linux__
+
+TEST_CASE("async::reactor", "[async][reactor]")
+{
+	async::reactor reactor(4);
+	int fds[2];
+	REQUIRE(::pipe(fds) == 0);
+	sys::set_nonblocking(fds[0]);
+
+	SECTION("level triggered")
+	{
+		unsigned calls = 0;
+		reactor.add(fds[0], async::reactor::in, [&calls](int, uint32_t events_) {
+			CHECK((events_ & async::reactor::in));
+			calls++;
+		});
+
+		CHECK(reactor.size() == 1);
+		CHECK(reactor.contains(fds[0]));
+		CHECK_THROWS(reactor.add(fds[0], async::reactor::in, [](int, uint32_t) { }));
+		CHECK(reactor.run_once(0) == 0);
+
+		CHECK(::write(fds[1], "ab", 2) == 2);
+		CHECK(reactor.run_once(0) == 1);
+		CHECK(reactor.run_once(0) == 1); // still readable
+		CHECK(calls == 2);
+
+		reactor.remove(fds[0]);
+		CHECK(reactor.size() == 0);
+		CHECK(reactor.run_once(0) == 0);
+		CHECK_THROWS(reactor.remove(fds[0]));
+	}
+
+	SECTION("edge triggered")
+	{
+		unsigned calls = 0;
+		reactor.add(fds[0], async::reactor::in, [&calls](int, uint32_t) { calls++; },
+			async::reactor::trigger::edge);
+
+		CHECK(::write(fds[1], "ab", 2) == 2);
+		CHECK(reactor.run_once(0) == 1);
+		CHECK(reactor.run_once(0) == 0); // no new data
+		CHECK(::write(fds[1], "c", 1) == 1);
+		CHECK(reactor.run_once(0) == 1);
+
+		reactor.modify(fds[0], async::reactor::in);
+		CHECK(reactor.run_once(0) == 1);
+		CHECK(calls == 3);
+	}
+
+	SECTION("handlers remove fds")
+	{
+		std::vector<int> evs;
+
+		for (int i = 0; i < 16; i++)
+			evs.push_back(::eventfd(1, EFD_NONBLOCK));
+
+		unsigned calls = 0;
+
+		for (int fd : evs) {
+			reactor.add(fd, async::reactor::in, [&](int, uint32_t) {
+				calls++;
+
+				// remove every fd, including the one being dispatched
+				for (int other : evs)
+					if (reactor.contains(other))
+						reactor.remove(other);
+			});
+		}
+
+		CHECK(reactor.run_once(0) == 1);
+		CHECK(calls == 1);
+		CHECK(reactor.size() == 0);
+
+		for (int fd : evs)
+			::close(fd);
+	}
+
+	SECTION("handlers add fds")
+	{
+		std::vector<int> extra;
+		unsigned calls = 0;
+
+		// the new fds grow the handler table while this handler runs
+		reactor.add(fds[0], async::reactor::in, [&reactor, &extra, &calls](int, uint32_t) {
+			for (int i = 0; i < 64; i++) {
+				extra.push_back(::eventfd(0, EFD_NONBLOCK));
+				reactor.add(extra.back(), async::reactor::in, [](int, uint32_t) { });
+			}
+
+			calls++;
+		});
+
+		CHECK(::write(fds[1], "a", 1) == 1);
+		CHECK(reactor.run_once(0) == 1);
+		CHECK(calls == 1);
+		CHECK(reactor.size() == 65);
+
+		for (int fd : extra) {
+			reactor.remove(fd);
+			::close(fd);
+		}
+	}
+
+	SECTION("stop from another thread")
+	{
+		std::thread t([&reactor]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			reactor.stop();
+		});
+
+		auto start = etc::now();
+		reactor.run();
+		t.join();
+		CHECK(etc::seconds_since(start) < 1);
+	}
+
+	::close(fds[0]);
+	::close(fds[1]);
+}
+
+TEST_CASE("async::reactor post", "[async][reactor]")
+{
+	async::reactor reactor;
+	std::thread::id loop_thread;
+	std::atomic<unsigned> run { 0 };
+	bool all_on_loop = true;
+	const unsigned posters = 4, per_poster = 10000;
+
+	std::thread loop([&]() {
+		loop_thread = std::this_thread::get_id();
+		reactor.run();
+	});
+
+	std::vector<std::thread> threads;
+
+	for (unsigned p = 0; p < posters; p++) {
+		threads.emplace_back([&]() {
+			for (unsigned i = 0; i < per_poster; i++)
+				reactor.post([&]() {
+					all_on_loop = all_on_loop && std::this_thread::get_id() == loop_thread;
+					run++;
+				});
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	auto start = etc::now();
+
+	while (run < posters * per_poster && etc::seconds_since(start) < 5)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	reactor.stop();
+	loop.join();
+
+	CHECK(run == posters * per_poster);
+	CHECK(all_on_loop);
+}
+
+TEST_CASE("async::reactor_group", "[async][reactor]")
+{
+	async::reactor_group::config cfg;
+	cfg.size = 3;
+	cfg.pin_threads = false;
+	cfg.assign = GENERATE(async::reactor_group::assignment::round_robin,
+		async::reactor_group::assignment::hash);
+
+	async::reactor_group group(cfg);
+	std::vector<std::thread::id> loop_threads(group.size());
+	std::atomic<unsigned> ready { 0 };
+
+	for (unsigned i = 0; i < group.size(); i++)
+		group.post(i, [&, i]() { loop_threads[i] = std::this_thread::get_id(); ready++; });
+
+	group.start();
+
+	while (ready < group.size())
+		std::this_thread::yield();
+
+	std::vector<int> fds;
+	std::vector<unsigned> assigned;
+	std::atomic<unsigned> events { 0 };
+	std::atomic<bool> wrong_thread { false };
+
+	for (unsigned i = 0; i < 12; i++) {
+		int fd = ::eventfd(0, EFD_NONBLOCK);
+		fds.push_back(fd);
+		auto index = std::make_shared<unsigned>(0);
+
+		*index = group.add(fd, async::reactor::in, [&, index](int fd_, uint32_t) {
+			uint64_t val;
+			CHECK(::read(fd_, &val, sizeof(val)) == sizeof(val));
+
+			if (std::this_thread::get_id() != loop_threads[*index])
+				wrong_thread = true;
+
+			events++;
+		});
+
+		assigned.push_back(*index);
+	}
+
+	if (cfg.assign == async::reactor_group::assignment::round_robin)
+		CHECK(assigned == std::vector<unsigned>({ 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2 }));
+
+	for (int fd : fds) {
+		uint64_t one = 1;
+		CHECK(::write(fd, &one, sizeof(one)) == sizeof(one));
+	}
+
+	auto start = etc::now();
+
+	while (events < fds.size() && etc::seconds_since(start) < 5)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	CHECK(events == fds.size());
+	CHECK(!wrong_thread);
+
+	// tasks posted by a loop during shutdown still run
+	std::atomic<unsigned> late { 0 };
+	group.post(0, [&]() {
+		group.at(0).stop();
+		group.post(1, [&]() { group.post(2, [&]() { late++; }); });
+	});
+
+	group.stop();
+	CHECK(late == 1);
+
+	for (unsigned i = 0; i < fds.size(); i++) {
+		group.at(assigned[i]).remove(fds[i]);
+		::close(fds[i]);
+	}
+}
+
+TEST_CASE("async::reactor_group add errors", "[async][reactor]")
+{
+	async::reactor_group::config cfg;
+	cfg.size = 2;
+	cfg.pin_threads = false;
+	cfg.assign = async::reactor_group::assignment::hash;
+
+	async::reactor_group group(cfg);
+	group.start();
+
+	int fd = ::eventfd(0, EFD_NONBLOCK);
+	std::atomic<unsigned> errors { 0 };
+	int error_fd = -1;
+	std::exception_ptr error;
+
+	// runs on the loop's thread, checked on this one once the loop has stopped
+	auto on_error = [&](int fd_, std::exception_ptr error_) {
+		error_fd = fd_;
+		error = error_;
+		errors++;
+	};
+
+	auto noop = [](int, uint32_t) { };
+	unsigned index = group.add(fd, async::reactor::in, noop, async::reactor::trigger::level, on_error);
+
+	// the same loop, where the fd is already registered
+	CHECK(group.add(fd, async::reactor::in, noop, async::reactor::trigger::level, on_error) == index);
+
+	auto start = etc::now();
+
+	while (errors == 0 && etc::seconds_since(start) < 5)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	CHECK(errors == 1);
+
+	// the loop survived the failed registration
+	std::atomic<bool> ran { false };
+	group.post(index, [&]() { ran = true; });
+
+	start = etc::now();
+
+	while (!ran && etc::seconds_since(start) < 5)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	CHECK(ran);
+
+	group.stop();
+	group.at(index).remove(fd);
+	::close(fd);
+
+	CHECK(error_fd == fd);
+	CHECK_THROWS_AS(std::rethrow_exception(error), std::runtime_error);
+}
+
+#endif
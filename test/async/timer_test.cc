@@ -0,0 +1,152 @@
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("async::timer_wheel", "[async][timer]")
+{
+	async::timer_wheel wheel(1, 64);
+	uint64_t start = wheel.current();
+	std::vector<int> fired;
+
+	SECTION("one-shot, periodic and far timers")
+	{
+		async::timer a([&fired](async::timer&) { fired.push_back(1); });
+		async::timer b([&fired](async::timer&) { fired.push_back(2); });
+		async::timer c([&fired](async::timer&) { fired.push_back(3); });
+
+		wheel.schedule(a, 5);
+		wheel.schedule(b, 10, 10);
+		wheel.schedule(c, 200); // more than one revolution
+		CHECK(wheel.size() == 3);
+		CHECK(a.active());
+
+		CHECK(wheel.advance_to(start + 4) == 0);
+		CHECK(wheel.advance_to(start + 5) == 1);
+		CHECK(!a.active());
+		CHECK(wheel.advance_to(start + 35) == 3);
+		CHECK(fired == std::vector<int>({ 1, 2, 2, 2 }));
+		CHECK(b.active());
+
+		wheel.advance_to(start + 199);
+		CHECK(std::count(fired.begin(), fired.end(), 3) == 0);
+		wheel.advance_to(start + 200);
+		CHECK(std::count(fired.begin(), fired.end(), 3) == 1);
+		CHECK(wheel.size() == 1);
+	}
+
+	SECTION("cancel and reschedule")
+	{
+		async::timer a([&fired](async::timer&) { fired.push_back(1); });
+		async::timer b([&fired](async::timer&) { fired.push_back(2); });
+
+		wheel.schedule(a, 5);
+		wheel.schedule(b, 5);
+		wheel.cancel(a);
+		CHECK(!a.active());
+		wheel.schedule(b, 7); // moves b
+		CHECK(wheel.size() == 1);
+
+		wheel.advance_to(start + 6);
+		CHECK(fired.empty());
+		wheel.advance_to(start + 7);
+		CHECK(fired == std::vector<int>({ 2 }));
+
+		{
+			async::timer scoped([&fired](async::timer&) { fired.push_back(3); });
+			wheel.schedule(scoped, 1);
+		}
+
+		CHECK(wheel.size() == 0);
+		CHECK(wheel.advance_to(start + 100) == 0);
+	}
+
+	SECTION("callbacks modify timers of the same slot")
+	{
+		async::timer a, b, c;
+		a.set_callback([&](async::timer&) { fired.push_back(1); wheel.cancel(b); wheel.cancel(c); });
+		b.set_callback([&](async::timer&) { fired.push_back(2); wheel.cancel(a); wheel.cancel(c); });
+		c.set_callback([&](async::timer& self_) { fired.push_back(3); wheel.schedule(self_, 1); });
+
+		wheel.schedule(a, 3);
+		wheel.schedule(b, 3);
+		wheel.schedule(c, 3);
+		CHECK(wheel.advance_to(start + 3) == 1);
+		CHECK(fired.size() == 1);
+		CHECK(wheel.size() == 0);
+
+		wheel.schedule(c, 3, 5); // periodic, but rescheduled by its callback
+		wheel.advance_to(start + 6);
+		CHECK(c.active());
+		CHECK(c.period() == 0);
+	}
+
+	SECTION("next timeout")
+	{
+		async::timer a;
+		CHECK(wheel.next_timeout_ms() == -1);
+		wheel.schedule(a, 50);
+		int timeout = wheel.next_timeout_ms();
+		CHECK(timeout > 0);
+		CHECK(timeout <= 50);
+	}
+}
+
+#ifdef __linux__
+
+TEST_CASE("async::reactor timers", "[async][timer]")
+{
+	async::reactor reactor;
+	unsigned ticks = 0;
+
+	async::timer periodic([&](async::timer& self_) {
+		if (++ticks == 3)
+			reactor.cancel(self_);
+	});
+
+	async::timer stop([&reactor](async::timer&) { reactor.stop(); });
+
+	reactor.schedule(periodic, 5, 5);
+	reactor.schedule(stop, 40);
+
+	auto start = etc::now();
+	reactor.run();
+	double seconds = etc::seconds_since(start);
+
+	CHECK(ticks == 3);
+	CHECK(seconds >= 0.035);
+	CHECK(seconds < 1);
+}
+
+TEST_CASE("async::reactor timers scheduled after a long wait", "[async][timer]")
+{
+	async::reactor reactor;
+	int fd = ::eventfd(0, EFD_NONBLOCK);
+	bool fired = false;
+	async::timer timer([&fired](async::timer&) { fired = true; });
+	std::chrono::steady_clock::time_point scheduled;
+
+	reactor.add(fd, async::reactor::in, [&](int, uint32_t) {
+		uint64_t val;
+		CHECK(::read(fd, &val, sizeof(val)) == sizeof(val));
+		scheduled = std::chrono::steady_clock::now();
+		reactor.schedule(timer, 100);
+	});
+
+	reactor.run_once(0);
+
+	// the wheel was last advanced before this, as after a long blocking epoll_wait()
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	uint64_t one = 1;
+	CHECK(::write(fd, &one, sizeof(one)) == sizeof(one));
+
+	while (!fired)
+		reactor.run_once(1000);
+
+	CHECK(std::chrono::steady_clock::now() - scheduled >= std::chrono::milliseconds(95));
+
+	reactor.remove(fd);
+	::close(fd);
+}
+
+#endif
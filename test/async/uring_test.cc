@@ -0,0 +1,176 @@
+
+#include <memory>
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+#ifdef OM_HAVE_IO_URING
+
+static const char* URING_TEST_FILE = "/tmp/libom2_uring_test.bin";
+
+TEST_CASE("async::uring", "[async][uring]")
+{
+	std::unique_ptr<async::uring> ring;
+
+	try {
+		ring.reset(new async::uring(32));
+	} catch (const std::runtime_error& e) {
+		WARN("skipping uring test: " << e.what());
+		return;
+	}
+
+	std::vector<async::uring::completion> completions;
+	auto collect = [&completions](const async::uring::completion& c_) { completions.push_back(c_); };
+
+	SECTION("recv/send")
+	{
+		const unsigned short port = 47005;
+		net::socket rx(net::socket::type::dgram);
+		rx.bind("0.0.0.0", port);
+
+		struct sockaddr_in dst {};
+		dst.sin_family = AF_INET;
+		dst.sin_port = htons(port);
+		dst.sin_addr.s_addr = net::ip4_addr::from_string("127.0.0.1").to_uint32();
+
+		net::socket tx(net::socket::type::dgram);
+		REQUIRE(::connect(tx.fd(), (struct sockaddr*) &dst, sizeof(dst)) == 0);
+
+		unsigned char out[] = { 1, 2, 3, 4 }, in[16] = { 0 };
+
+		CHECK(ring->prep_recv(rx.fd(), in, sizeof(in), 1));
+		CHECK(ring->prep_send(tx.fd(), out, sizeof(out), 2));
+		CHECK(ring->submit() == 2);
+
+		while (completions.size() < 2)
+			ring->wait(collect);
+
+		for (auto& c : completions)
+			CHECK(c.res == 4);
+
+		CHECK(in[3] == 4);
+
+		SECTION("recv_multishot")
+		{
+#ifdef IORING_RECV_MULTISHOT
+			unsigned char buffers[4][32];
+			CHECK(ring->prep_provide_buffers(buffers, 32, 4, 7, 0, 10));
+			CHECK(ring->prep_recv_multishot(rx.fd(), 7, 11));
+			ring->submit();
+
+			for (unsigned i = 0; i < 3; i++)
+				::send(tx.fd(), out, i + 1, 0);
+
+			completions.clear();
+			std::vector<uint16_t> ids;
+
+			while (ids.size() < 3) {
+				ring->wait(collect);
+
+				for (auto& c : completions) {
+					if (c.user_data != 11)
+						continue;
+
+					if (c.res == -EINVAL) {
+						WARN("multishot recv not supported");
+						return;
+					}
+
+					CHECK(c.has_buffer());
+					CHECK(c.more());
+					CHECK(c.res == (int) ids.size() + 1);
+					ids.push_back(c.buffer_id());
+				}
+
+				completions.clear();
+			}
+
+			CHECK(ids[0] != ids[1]);
+			CHECK(ids[1] != ids[2]);
+#endif
+		}
+	}
+
+	SECTION("accept")
+	{
+		net::tcp_listener listener(net::ip4_addr::from_string("127.0.0.1"));
+		CHECK(ring->prep_accept(listener.fd(), 3));
+		ring->submit();
+
+		net::tcp_stream client;
+		client.connect(net::ip4_addr::from_string("127.0.0.1"), listener.port());
+
+		ring->wait(collect);
+		REQUIRE(completions.size() == 1);
+		CHECK(completions[0].user_data == 3);
+		CHECK(completions[0].res >= 0);
+		net::tcp_stream accepted(completions[0].res);
+	}
+
+	SECTION("read/write")
+	{
+		int fd = ::open(URING_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		REQUIRE(fd != -1);
+
+		std::vector<unsigned char> out(8192), in(8192);
+
+		for (std::size_t i = 0; i < out.size(); i++)
+			out[i] = (unsigned char) i;
+
+		CHECK(ring->prep_write(fd, out.data(), 4096, 0, 1));
+		CHECK(ring->prep_write(fd, out.data() + 4096, 4096, 4096, 2));
+		ring->submit();
+
+		while (completions.size() < 2)
+			ring->wait(collect);
+
+		CHECK(completions[0].res == 4096);
+		CHECK(completions[1].res == 4096);
+		completions.clear();
+
+		SECTION("read")
+		{
+			CHECK(ring->prep_read(fd, in.data(), 8192, 0, 3));
+			ring->wait(collect);
+			REQUIRE(completions.size() == 1);
+			CHECK(completions[0].res == 8192);
+			CHECK(in == out);
+		}
+
+		SECTION("registered buffers and files")
+		{
+			struct iovec iov { in.data(), in.size() };
+			ring->register_buffers(&iov, 1);
+			ring->register_files(&fd, 1);
+
+			CHECK(ring->prep_read_fixed(0, in.data() + 100, 1000, 100, 0, 4));
+			ring->set_flags(IOSQE_FIXED_FILE);
+			ring->wait(collect);
+
+			REQUIRE(completions.size() == 1);
+			CHECK(completions[0].res == 1000);
+			CHECK(std::equal(in.begin() + 100, in.begin() + 1100, out.begin() + 100));
+
+			ring->unregister_files();
+			ring->unregister_buffers();
+		}
+
+		::close(fd);
+		std::remove(URING_TEST_FILE);
+	}
+
+	SECTION("sq_space_left")
+	{
+		unsigned char buf[1];
+		unsigned prepared = 0;
+
+		while (ring->prep_read(0, buf, 0, 0, 0))
+			prepared++;
+
+		CHECK(prepared == 32);
+		CHECK(ring->sq_space_left() == 0);
+	}
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include <string>
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("concurrency::future", "[concurrency][future]")
+{
+	concurrency::thread_pool pool(2);
+
+	SECTION("async")
+	{
+		auto f = pool.async([]() { return 42; });
+		CHECK(f.valid());
+		CHECK(f.get() == 42);
+
+		auto v = pool.async([]() { });
+		CHECK_NOTHROW(v.get());
+		CHECK(v.ready());
+
+		auto s = pool.async([]() { return std::string(100, 'x'); });
+		CHECK(s.get().size() == 100);
+	}
+
+	SECTION("exceptions")
+	{
+		auto f = pool.async([]() -> int { throw std::runtime_error("failed"); });
+		CHECK_THROWS_AS(f.get(), std::runtime_error);
+
+		// the continuation is skipped, the exception propagates
+		bool called = false;
+		auto g = pool.async([]() -> int { throw std::runtime_error("failed"); })
+			.then([&called](int v_) { called = true; return v_; });
+		CHECK_THROWS_AS(g.get(), std::runtime_error);
+		CHECK(!called);
+
+		CHECK_THROWS_AS(concurrency::future<int>().get(), std::logic_error);
+	}
+
+	SECTION("then")
+	{
+		auto f = pool.async([]() { return 20; })
+			.then([](int v_) { return v_ + 1; })
+			.then([](int v_) { return std::to_string(v_ * 2); });
+		CHECK(f.get() == "42");
+
+		// continuations of a ready future run on the calling thread
+		auto ready = pool.async([]() { return std::this_thread::get_id(); });
+		ready.wait();
+		auto id = ready.then([](std::thread::id) { return std::this_thread::get_id(); }).get();
+		CHECK(id == std::this_thread::get_id());
+
+		unsigned count = 0;
+		auto v = pool.async([]() { }).then([&count]() { count++; });
+		v.get();
+		CHECK(count == 1);
+
+		auto on_pool = pool.async([]() { return 1; }).then(pool, [](int v_) { return v_ + 1; });
+		CHECK(on_pool.get() == 2);
+
+		CHECK(!concurrency::future<int>().valid());
+	}
+
+	SECTION("promise")
+	{
+		concurrency::promise<int> p;
+		auto f = p.get_future();
+		CHECK_THROWS_AS(p.get_future(), std::logic_error);
+		CHECK(!f.wait_for(1));
+
+		std::thread t([&p]() { p.set_value(7); });
+		CHECK(f.get() == 7);
+		t.join();
+
+		concurrency::future<void> broken;
+		{
+			concurrency::promise<void> q;
+			broken = q.get_future();
+		}
+		CHECK_THROWS_AS(broken.get(), std::runtime_error);
+	}
+
+	SECTION("when_all")
+	{
+		std::vector<concurrency::future<int>> futures;
+
+		for (int i = 0; i < 16; i++)
+			futures.push_back(pool.async([i]() { return i * i; }));
+
+		auto all = concurrency::when_all(std::move(futures)).get();
+		REQUIRE(all.size() == 16);
+
+		for (int i = 0; i < 16; i++)
+			CHECK(all[i] == i * i);
+
+		std::vector<concurrency::future<void>> voids;
+		std::atomic<unsigned> count { 0 };
+
+		for (int i = 0; i < 8; i++)
+			voids.push_back(pool.async([&count]() { count++; }));
+
+		concurrency::when_all(std::move(voids)).get();
+		CHECK(count == 8);
+
+		CHECK(concurrency::when_all(std::vector<concurrency::future<int>>()).get().empty());
+
+		std::vector<concurrency::future<int>> failing;
+		failing.push_back(pool.async([]() { return 1; }));
+		failing.push_back(pool.async([]() -> int { throw std::runtime_error("failed"); }));
+		CHECK_THROWS_AS(concurrency::when_all(std::move(failing)).get(), std::runtime_error);
+	}
+
+	SECTION("when_any")
+	{
+		concurrency::promise<int> slow;
+		std::vector<concurrency::future<int>> futures;
+		futures.push_back(slow.get_future());
+		futures.push_back(pool.async([]() { return 2; }));
+
+		auto any = concurrency::when_any(std::move(futures)).get();
+		CHECK(any.index == 1);
+		REQUIRE(any.futures.size() == 2);
+		CHECK(any.futures[1].get() == 2);
+		CHECK(!any.futures[0].ready());
+		CHECK_THROWS_AS(any.futures[0].then([](int v_) { return v_; }), std::logic_error);
+
+		slow.set_value(1);
+		CHECK(any.futures[0].get() == 1);
+
+		auto none = concurrency::when_any(std::vector<concurrency::future<int>>()).get();
+		CHECK(none.index == concurrency::when_any_result<int>::npos);
+	}
+}
@@ -0,0 +1,123 @@
+#include <thread>
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("concurrency::mpmc_queue", "[concurrency][mpmc_queue]")
+{
+	SECTION("single thread")
+	{
+		concurrency::mpmc_queue<int> queue(3);
+		CHECK(queue.capacity() == 4);
+		CHECK(queue.empty());
+
+		for (int i = 0; i < 4; i++)
+			CHECK(queue.try_enqueue(i));
+
+		CHECK(!queue.try_enqueue(4));
+		CHECK(queue.size() == 4);
+
+		int item = -1;
+		CHECK(queue.dequeue(item));
+		CHECK(item == 0);
+
+		int out[8];
+		CHECK(queue.dequeue_bulk(out, 8) == 3);
+		CHECK(out[0] == 1);
+		CHECK(out[2] == 3);
+		CHECK(!queue.dequeue(item));
+
+		int in[6] = { 0, 1, 2, 3, 4, 5 };
+		CHECK(queue.try_enqueue_bulk(in, 6) == 4);
+		CHECK(queue.try_enqueue_bulk(in, 6) == 0);
+		CHECK(queue.dequeue_bulk(out, 2) == 2);
+		CHECK(queue.try_enqueue_bulk(in + 4, 2) == 2);
+		CHECK(queue.dequeue_bulk(out, 8) == 4);
+		CHECK(out[3] == 5);
+	}
+
+	SECTION("timeouts")
+	{
+		concurrency::mpmc_queue<int> queue(2);
+		int item;
+		CHECK(!queue.dequeue_wait(item, 1));
+
+		int out[2];
+		CHECK(queue.dequeue_wait_bulk(out, 2, 1) == 0);
+
+		CHECK(queue.enqueue(1, 1));
+		CHECK(queue.enqueue(2, 1));
+		CHECK(!queue.enqueue(3, 1));
+
+		int in[2] = { 3, 4 };
+		CHECK(queue.enqueue_bulk(in, 2, 1) == 0);
+	}
+
+	SECTION("producers and consumers")
+	{
+		const unsigned threads = 4, per_thread = 50000;
+		concurrency::mpmc_queue<unsigned> queue(64);
+		std::atomic<uint64_t> sum { 0 };
+		std::atomic<unsigned> count { 0 };
+		std::vector<std::thread> workers;
+
+		for (unsigned t = 0; t < threads; t++) {
+			workers.emplace_back([&queue, t]() {
+				unsigned burst[5];
+
+				for (unsigned i = 0; i < per_thread; ) {
+					if (t % 2) {
+						queue.enqueue(t * per_thread + i++);
+					} else {
+						unsigned n = std::min(5u, per_thread - i);
+
+						for (unsigned j = 0; j < n; j++)
+							burst[j] = t * per_thread + i + j;
+
+						queue.enqueue_bulk(burst, n);
+						i += n;
+					}
+				}
+			});
+
+			workers.emplace_back([&queue, &sum, &count, t]() {
+				unsigned out[8];
+
+				while (count < threads * per_thread) {
+					std::size_t n = t % 2 ? queue.dequeue_wait_bulk(out, 8, 10)
+						: queue.dequeue_wait(out[0], 10);
+
+					for (std::size_t i = 0; i < n; i++)
+						sum += out[i];
+
+					count += n;
+				}
+			});
+		}
+
+		for (auto& w : workers)
+			w.join();
+
+		uint64_t total = (uint64_t) threads * per_thread;
+		CHECK(count == total);
+		CHECK(sum == total * (total - 1) / 2);
+		CHECK(queue.empty());
+	}
+
+	SECTION("thread_pool task queue")
+	{
+		concurrency::basic_thread_pool<concurrency::mpmc_queue<concurrency::task>> pool(2);
+		std::vector<concurrency::future<int>> futures;
+
+		for (int i = 0; i < 100; i++)
+			futures.push_back(pool.async([i]() { return i; }));
+
+		int sum = 0;
+
+		for (auto& f : futures)
+			sum += f.get();
+
+		CHECK(sum == 4950);
+	}
+}
@@ -0,0 +1,116 @@
+#include <catch.h>
+#include <numeric>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("concurrency::parallel", "[concurrency::parallel]")
+{
+	concurrency::thread_pool pool(3);
+
+	SECTION("parallel_for over indices and elements")
+	{
+		std::vector<int> hits(10007, 0);
+		concurrency::parallel_for(pool, 0, (int) hits.size(), [&hits](int i_) { hits[i_]++; });
+		CHECK(std::count(hits.begin(), hits.end(), 1) == (long) hits.size());
+
+		concurrency::parallel_for(pool, hits.begin(), hits.end(), [](int& hit_) { hit_ *= 3; }, 100);
+		CHECK(std::count(hits.begin(), hits.end(), 3) == (long) hits.size());
+
+		int calls = 0;
+		concurrency::parallel_for(pool, 5, 5, [&calls](int) { calls++; });
+		concurrency::parallel_for(pool, -3, 2, [&calls](int i_) { calls += i_ < 0; }, 1);
+		CHECK(calls == 3);
+	}
+
+	SECTION("parallel_transform")
+	{
+		std::vector<int> in(5000);
+		std::vector<long> out(in.size());
+		std::iota(in.begin(), in.end(), 0);
+
+		auto end = concurrency::parallel_transform(pool, in.begin(), in.end(), out.begin(),
+			[](int v_) { return (long) v_ * v_; });
+
+		std::vector<long> expected(in.size());
+		std::transform(in.begin(), in.end(), expected.begin(), [](int v_) { return (long) v_ * v_; });
+
+		CHECK(end == out.end());
+		CHECK(out == expected);
+	}
+
+	SECTION("parallel_reduce keeps the order of the chunks")
+	{
+		std::vector<uint64_t> values(100000);
+		std::iota(values.begin(), values.end(), 1);
+
+		CHECK(concurrency::parallel_reduce(pool, values.begin(), values.end(), uint64_t(0),
+			[](uint64_t a_, uint64_t b_) { return a_ + b_; }) == 100000ULL * 100001 / 2);
+
+		// string concatenation is associative but not commutative
+		std::string s = concurrency::parallel_reduce(pool, 0, 26, std::string(),
+			[](int i_) { return std::string(1, (char) ('a' + i_)); },
+			[](std::string a_, const std::string& b_) { return a_ + b_; }, 2);
+		CHECK(s == "abcdefghijklmnopqrstuvwxyz");
+
+		CHECK(concurrency::parallel_reduce(pool, 3, 3, 7, [](int) { return 1; },
+			[](int a_, int b_) { return a_ + b_; }) == 7);
+	}
+
+	SECTION("parallel_sort")
+	{
+		for (std::size_t n : { 0, 1, 1000, 20000, 100003 }) {
+			std::vector<uint32_t> values(n);
+			uint32_t x = 12345;
+
+			for (auto& v : values)
+				v = x = x * 1103515245 + 12345;
+
+			std::vector<uint32_t> expected = values;
+			std::sort(expected.begin(), expected.end());
+
+			concurrency::parallel_sort(pool, values.begin(), values.end());
+			CHECK(values == expected);
+		}
+
+		std::vector<int> values(50000);
+		std::iota(values.begin(), values.end(), 0);
+		concurrency::parallel_sort(pool, values.begin(), values.end(), std::greater<int>(), 1000);
+		CHECK(std::is_sorted(values.begin(), values.end(), std::greater<int>()));
+	}
+
+	SECTION("nested loops do not deadlock")
+	{
+		concurrency::thread_pool single(1);
+		std::atomic<int> count { 0 };
+
+		concurrency::parallel_for(single, 0, 8, [&](int) {
+			concurrency::parallel_for(single, 0, 8, [&](int) {
+				concurrency::parallel_for(single, 0, 8, [&](int) { count++; }, 1);
+			}, 1);
+		}, 1);
+
+		CHECK(count == 512);
+
+		auto sum = pool.async([&pool]() {
+			return concurrency::parallel_reduce(pool, 0, 100, 0, [&pool](int i_) {
+				return concurrency::parallel_reduce(pool, 0, i_, 0, [](int) { return 1; },
+					[](int a_, int b_) { return a_ + b_; }, 3);
+			}, [](int a_, int b_) { return a_ + b_; }, 1);
+		});
+
+		CHECK(sum.get() == 4950);
+	}
+
+	SECTION("exceptions are rethrown")
+	{
+		CHECK_THROWS_AS(concurrency::parallel_for(pool, 0, 1000, [](int i_) {
+			if (i_ == 10)
+				throw std::runtime_error("failed");
+		}, 1), std::runtime_error);
+
+		// the pool is still usable
+		CHECK(concurrency::parallel_reduce(pool, 0, 10, 0, [](int i_) { return i_; },
+			[](int a_, int b_) { return a_ + b_; }) == 45);
+	}
+}
@@ -40,3 +40,107 @@ TEST_CASE("concurrency::queue", "[concurrency::queue]")
 	consumer.join();
 	producer.join();
 }
+
+TEST_CASE("concurrency::queue bulk", "[concurrency::queue]")
+{
+	concurrency::queue<int> queue;
+
+	SECTION("bulk operations cross chunk boundaries in order") {
+		std::vector<int> in(10000);
+		std::vector<int> out;
+
+		for (std::size_t i = 0; i < in.size(); i++)
+			in[i] = int(i);
+
+		queue.enqueue_bulk(in.begin(), in.begin() + 3000);
+		queue.enqueue(3000);
+		queue.enqueue_bulk(in.begin() + 3001, in.end());
+		CHECK(queue.size() == in.size());
+
+		std::size_t n;
+		int buffer[777];
+
+		while ((n = queue.dequeue_bulk(buffer, 777)) > 0)
+			out.insert(out.end(), buffer, buffer + n);
+
+		CHECK(out == in);
+		CHECK(queue.empty());
+
+		int item = 0;
+		queue.enqueue(42);
+		CHECK(queue.dequeue(item));
+		CHECK(item == 42);
+	}
+
+	SECTION("dequeue_wait_bulk times out on an empty queue") {
+		int buffer[4];
+		CHECK(queue.dequeue_wait_bulk(buffer, 4, 10) == 0);
+
+		queue.enqueue(1);
+		queue.enqueue(2);
+		CHECK(queue.dequeue_wait_bulk(buffer, 4, 10) == 2);
+		CHECK(buffer[0] == 1);
+		CHECK(buffer[1] == 2);
+	}
+
+	SECTION("multiple producers and consumers") {
+		const int producers = 3, consumers = 3, per_producer = 20000;
+		std::atomic<long> sum(0);
+		std::atomic<int> received(0);
+		std::vector<std::thread> threads;
+
+		for (int p = 0; p < producers; p++) {
+			threads.emplace_back([&queue, p]() {
+				std::vector<int> batch;
+
+				for (int i = 1; i <= per_producer; i++) {
+					batch.push_back(i);
+
+					if (batch.size() == 64 || i == per_producer) {
+						queue.enqueue_bulk(batch.begin(), batch.end());
+						batch.clear();
+					}
+				}
+			});
+		}
+
+		for (int c = 0; c < consumers; c++) {
+			threads.emplace_back([&]() {
+				int buffer[32];
+
+				while (received.load() < producers * per_producer) {
+					std::size_t n = queue.dequeue_wait_bulk(buffer, 32, 5);
+
+					for (std::size_t i = 0; i < n; i++)
+						sum += buffer[i];
+
+					received += int(n);
+				}
+			});
+		}
+
+		for (auto& t : threads)
+			t.join();
+
+		CHECK(received.load() == producers * per_producer);
+		CHECK(sum.load() == long(producers) * per_producer * (per_producer + 1) / 2);
+	}
+}
+
+TEST_CASE("concurrency::queue destroys what it holds", "[concurrency::queue]")
+{
+	std::shared_ptr<int> tracked = std::make_shared<int>(1);
+
+	{
+		concurrency::queue<std::unique_ptr<std::shared_ptr<int>>> queue;
+
+		for (int i = 0; i < 5000; i++)
+			queue.enqueue(std::unique_ptr<std::shared_ptr<int>>(new std::shared_ptr<int>(tracked)));
+
+		std::unique_ptr<std::shared_ptr<int>> item;
+		CHECK(queue.dequeue(item));
+		CHECK(tracked.use_count() == 5001);
+	}
+
+	CHECK(tracked.use_count() == 1);
+}
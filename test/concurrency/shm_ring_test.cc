@@ -0,0 +1,177 @@
+#include <catch.h>
+#include <om/om.h>
+#include <sys/wait.h>
+
+using namespace om;
+
+#ifdef __linux__
+
+TEST_CASE("concurrency::shm_ring", "[shm_ring]")
+{
+	SECTION("records wrap around in order")
+	{
+		concurrency::shm_ring ring("om_test", 4096);
+		CHECK(ring.capacity() == 4096);
+		CHECK(ring.empty());
+
+		unsigned char buf[1500];
+		unsigned sent = 0, received = 0;
+
+		while (received < 1000) {
+			for (; sent < 1000; sent++) {
+				unsigned len = sent % 7 * 211 + 1;
+				std::memset(buf, (int) (sent & 0xff), len);
+
+				if (!ring.try_send(buf, len))
+					break;
+			}
+
+			ring.try_receive([&received](const unsigned char* data_, uint32_t len_) {
+				CHECK(len_ == received % 7 * 211 + 1);
+				CHECK(data_[0] == (received & 0xff));
+				CHECK(data_[len_ - 1] == (received & 0xff));
+				received++;
+			});
+		}
+
+		CHECK(ring.empty());
+		CHECK(ring.try_receive([](const unsigned char*, uint32_t) { }) == 0);
+	}
+
+	SECTION("full ring, oversized records and timeouts")
+	{
+		concurrency::shm_ring ring("om_test", 4096);
+		unsigned char buf[4096] = { 0 };
+		unsigned count = 0;
+
+		CHECK_THROWS(ring.try_send(buf, (uint32_t) ring.max_record_size() + 1));
+
+		while (ring.try_send(buf, 100))
+			count++;
+
+		CHECK(count == 4096 / 128);
+		CHECK(!ring.send(buf, 100, 10));
+		CHECK(ring.receive([](const unsigned char*, uint32_t) { }, 10, 1) == 1);
+		CHECK(ring.send(buf, 100, 10));
+		CHECK(ring.receive([](const unsigned char*, uint32_t) { }, 10) == count);
+		CHECK(ring.receive([](const unsigned char*, uint32_t) { }, 10) == 0);
+
+		int fd = ::memfd_create("om_test", MFD_CLOEXEC);
+		CHECK_THROWS(concurrency::shm_ring(fd));
+		::close(fd);
+	}
+
+	SECTION("between processes")
+	{
+		concurrency::shm_ring ring("om_test", 1 << 16);
+		const unsigned count = 100000;
+
+		pid_t pid = ::fork();
+		REQUIRE(pid != -1);
+
+		if (pid == 0) {
+			concurrency::shm_ring producer(ring.fd());
+
+			for (uint32_t i = 0; i < count; i++)
+				producer.send(&i, sizeof(i));
+
+			::_exit(0);
+		}
+
+		uint32_t expected = 0;
+		bool in_order = true;
+
+		while (expected < count) {
+			unsigned n = ring.receive([&](const unsigned char* data_, uint32_t len_) {
+				uint32_t value;
+				std::memcpy(&value, data_, sizeof(value));
+				in_order = in_order && len_ == sizeof(value) && value == expected;
+				expected++;
+			}, 2000);
+
+			if (n == 0)
+				break;
+		}
+
+		int status = 0;
+		::waitpid(pid, &status, 0);
+
+		CHECK(expected == count);
+		CHECK(in_order);
+		CHECK(WIFEXITED(status));
+	}
+
+	SECTION("multiple producers")
+	{
+		concurrency::shm_ring ring("om_test", 8192, concurrency::shm_ring::producers::multiple);
+		const unsigned producers = 4, count = 20000;
+		std::vector<std::thread> threads;
+
+		for (uint32_t p = 0; p < producers; p++) {
+			threads.emplace_back([&ring, p, count]() {
+				concurrency::shm_ring producer(ring.fd());
+
+				for (uint32_t i = 0; i < count; i++) {
+					uint32_t msg[2] = { p, i };
+					producer.send(msg, (uint32_t) (sizeof(msg) + i % 3 * 40));
+				}
+			});
+		}
+
+		std::vector<uint32_t> next(producers, 0);
+		unsigned total = 0;
+		bool in_order = true;
+
+		while (total < producers * count) {
+			unsigned n = ring.receive([&](const unsigned char* data_, uint32_t) {
+				uint32_t msg[2];
+				std::memcpy(msg, data_, sizeof(msg));
+				in_order = in_order && msg[1] == next[msg[0]]++;
+			}, 2000);
+
+			if (n == 0)
+				break;
+
+			total += n;
+		}
+
+		for (auto& t : threads)
+			t.join();
+
+		CHECK(total == producers * count);
+		CHECK(in_order);
+	}
+
+	SECTION("a producer timing out does not hide another sleeping producer")
+	{
+		concurrency::shm_ring ring("om_test", 4096, concurrency::shm_ring::producers::multiple);
+		concurrency::shm_ring a(ring.fd()), b(ring.fd());
+		unsigned char buf[100] = { 0 };
+
+		while (a.try_send(buf, sizeof(buf))) { }
+
+		std::atomic<long> waited_ms { -1 };
+
+		std::thread sleeper([&a, &buf, &waited_ms]() {
+			auto start = std::chrono::steady_clock::now();
+			a.send(buf, sizeof(buf), 3000);
+			waited_ms = (long) std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		for (int i = 0; i < 3; i++)
+			CHECK(!b.send(buf, sizeof(buf), 5));
+
+		auto drained = std::chrono::steady_clock::now();
+		ring.try_receive([](const unsigned char*, uint32_t) { });
+		sleeper.join();
+
+		// woken by the consumer, not by its own timeout
+		CHECK(waited_ms >= 0);
+		CHECK(std::chrono::steady_clock::now() - drained < std::chrono::milliseconds(1000));
+	}
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include <memory>
+#include <thread>
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("concurrency::spsc_queue", "[concurrency][spsc_queue]")
+{
+	SECTION("single thread")
+	{
+		concurrency::spsc_queue<int> queue(5);
+		CHECK(queue.capacity() == 8);
+		CHECK(queue.empty());
+
+		for (int i = 0; i < 8; i++)
+			CHECK(queue.try_push(i));
+
+		CHECK(!queue.try_push(8));
+		CHECK(queue.size() == 8);
+
+		int item = -1;
+		CHECK(queue.try_pop(item));
+		CHECK(item == 0);
+		CHECK(queue.try_push(8));
+
+		int out[16];
+		CHECK(queue.try_pop_bulk(out, 16) == 8);
+
+		for (int i = 0; i < 8; i++)
+			CHECK(out[i] == i + 1);
+
+		CHECK(!queue.try_pop(item));
+		CHECK(queue.try_pop_bulk(out, 16) == 0);
+
+		int in[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+		CHECK(queue.try_push_bulk(in, 10) == 8);
+		CHECK(queue.try_push_bulk(in, 10) == 0);
+		CHECK(queue.try_pop_bulk(out, 3) == 3);
+		CHECK(out[2] == 2);
+	}
+
+	SECTION("timeouts")
+	{
+		concurrency::spsc_queue<int> queue(2);
+		int item;
+		CHECK(!queue.pop(item, 1));
+
+		int out[4];
+		CHECK(queue.pop_bulk(out, 4, 1) == 0);
+
+		CHECK(queue.push(1, 1));
+		CHECK(queue.push(2, 1));
+		CHECK(!queue.push(3, 1));
+
+		int in[4] = { 3, 4, 5, 6 };
+		CHECK(queue.push_bulk(in, 4, 1) == 0);
+	}
+
+	SECTION("move only items are destroyed")
+	{
+		auto tracked = std::make_shared<int>(1);
+		{
+			concurrency::spsc_queue<std::unique_ptr<std::shared_ptr<int>>> queue(4);
+			CHECK(queue.try_emplace(new std::shared_ptr<int>(tracked)));
+			CHECK(queue.try_emplace(new std::shared_ptr<int>(tracked)));
+
+			std::unique_ptr<std::shared_ptr<int>> item;
+			CHECK(queue.try_pop(item));
+			CHECK(tracked.use_count() == 3);
+		}
+		CHECK(tracked.use_count() == 1);
+	}
+
+	SECTION("producer and consumer")
+	{
+		const unsigned count = 200000;
+		concurrency::spsc_queue<unsigned> queue(64);
+
+		std::thread producer([&queue]() {
+			unsigned burst[7];
+
+			for (unsigned i = 0; i < count; ) {
+				if (i % 3 == 0) {
+					queue.push(i++);
+				} else {
+					unsigned n = std::min(7u, count - i);
+
+					for (unsigned j = 0; j < n; j++)
+						burst[j] = i + j;
+
+					queue.push_bulk(burst, n);
+					i += n;
+				}
+			}
+		});
+
+		unsigned expected = 0;
+		bool ordered = true;
+		unsigned out[16];
+
+		while (expected < count) {
+			if (expected % 2) {
+				unsigned item;
+				queue.pop(item);
+				ordered &= item == expected++;
+			} else {
+				std::size_t n = queue.pop_bulk(out, 16);
+
+				for (std::size_t i = 0; i < n; i++)
+					ordered &= out[i] == expected++;
+			}
+		}
+
+		producer.join();
+		CHECK(ordered);
+		CHECK(queue.empty());
+	}
+}
@@ -0,0 +1,63 @@
+#include <memory>
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("concurrency::task", "[concurrency][task]")
+{
+	SECTION("inline and heap storage")
+	{
+		char small[48] = { 1 };
+		char large[128] = { 2 };
+		auto small_f = [small]() { return small[0]; };
+		auto large_f = [large]() { return large[0]; };
+
+		CHECK(concurrency::task::fits<decltype(small_f)>());
+		CHECK(!concurrency::task::fits<decltype(large_f)>());
+
+		int sum = 0;
+		concurrency::task a([&sum, small]() { sum += small[0]; });
+		concurrency::task b([&sum, large]() { sum += large[0]; });
+		a();
+		b();
+		CHECK(sum == 3);
+
+		// moving keeps both kinds working
+		concurrency::task c(std::move(a)), d(std::move(b));
+		CHECK(!a);
+		CHECK(!b);
+		c();
+		d();
+		CHECK(sum == 6);
+	}
+
+	SECTION("move only captures")
+	{
+		auto value = std::make_shared<int>(5);
+		std::unique_ptr<std::shared_ptr<int>> owned(new std::shared_ptr<int>(value));
+		int seen = 0;
+
+		struct reader
+		{
+			std::unique_ptr<std::shared_ptr<int>> p;
+			int& seen;
+
+			void operator()() { seen = **p; }
+		};
+
+		concurrency::task t(reader { std::move(owned), seen });
+		CHECK(value.use_count() == 2);
+
+		concurrency::task u;
+		CHECK(!u);
+		CHECK_THROWS_AS(u(), std::bad_function_call);
+
+		u = std::move(t);
+		u();
+		CHECK(seen == 5);
+
+		u = nullptr;
+		CHECK(value.use_count() == 1);
+	}
+}
@@ -21,3 +21,174 @@ TEST_CASE("concurrency::thread_pool", "[concurrency::thread_pool]")
 	CHECK(done1);
 	CHECK(done2);
 }
+
+static unsigned long fib(concurrency::thread_pool& pool_, unsigned n_)
+{
+	if (n_ < 12)
+		return n_ < 2 ? n_ : fib(pool_, n_ - 1) + fib(pool_, n_ - 2);
+
+	// the child goes to this worker's deque, idle workers steal it
+	auto child = pool_.async([&pool_, n_]() { return fib(pool_, n_ - 2); });
+	unsigned long a = fib(pool_, n_ - 1);
+
+	while (!child.ready())
+		if (!pool_.try_run_one())
+			std::this_thread::yield();
+
+	return a + child.get();
+}
+
+TEST_CASE("concurrency::thread_pool work stealing", "[concurrency::thread_pool]")
+{
+	concurrency::thread_pool pool(4);
+	CHECK(pool.size() == 4);
+
+	SECTION("fork/join")
+	{
+		auto result = pool.async([&pool]() { return fib(pool, 22); });
+		CHECK(result.get() == 17711);
+	}
+
+	SECTION("tasks submitted by tasks")
+	{
+		std::atomic<unsigned> count { 0 };
+
+		for (unsigned i = 0; i < 64; i++)
+			pool.submit([&pool, &count]() {
+				for (unsigned j = 0; j < 64; j++)
+					pool.submit([&count]() { count++; });
+			});
+
+		while (count < 64 * 64)
+			std::this_thread::yield();
+
+		CHECK(count == 64 * 64);
+	}
+
+	SECTION("helping from other threads")
+	{
+		std::atomic<unsigned> count { 0 };
+
+		for (unsigned i = 0; i < 100; i++)
+			pool.submit([&count]() { count++; });
+
+		while (count < 100)
+			pool.try_run_one();
+
+		CHECK(count == 100);
+	}
+}
+
+TEST_CASE("concurrency::thread_pool shutdown and metrics", "[concurrency::thread_pool]")
+{
+	SECTION("drain")
+	{
+		std::atomic<unsigned> count { 0 };
+		{
+			concurrency::thread_pool pool(2);
+
+			for (unsigned i = 0; i < 100; i++)
+				pool.submit([&pool, &count]() {
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+					pool.submit([&count]() { count++; });
+					count++;
+				});
+
+			// the destructor drains like shutdown(shutdown_mode::drain)
+		}
+		CHECK(count == 200);
+	}
+
+	SECTION("cancel")
+	{
+		std::atomic<unsigned> count { 0 };
+		concurrency::thread_pool pool(1);
+		std::atomic<bool> started { false };
+
+		pool.submit([&started]() {
+			started = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		});
+
+		for (unsigned i = 0; i < 100; i++)
+			pool.submit([&count]() { count++; });
+
+		while (!started)
+			std::this_thread::yield();
+
+		pool.shutdown(concurrency::shutdown_mode::cancel);
+		CHECK(count == 0);
+		CHECK(pool.statistics().queued == 0);
+		CHECK_NOTHROW(pool.shutdown());
+	}
+
+#ifdef __linux__
+	SECTION("pinned workers")
+	{
+		concurrency::thread_pool::config config;
+		config.threads   = 2;
+		config.placement = sys::placement::per_core;
+		concurrency::thread_pool pool(config);
+
+		sys::cpu_set allowed = sys::cpu_set::current();
+
+		for (unsigned i = 0; i < 20; i++) {
+			sys::cpu_set cpus = pool.async([]() { return sys::cpu_set::current(); }).get();
+			CHECK(cpus.size() == 1);
+			CHECK(allowed.contains(cpus[0]));
+		}
+	}
+
+#endif
+	SECTION("metrics")
+	{
+		concurrency::thread_pool::config config;
+		config.threads         = 2;
+		config.park_timeout_ms = 5;
+		concurrency::thread_pool pool(config);
+
+		std::atomic<bool> release { false };
+		pool.submit([&release]() {
+			while (!release)
+				std::this_thread::yield();
+		});
+
+		for (unsigned i = 0; i < 50 && pool.statistics().active == 0; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		CHECK(pool.statistics().active >= 1);
+		release = true;
+
+		for (unsigned i = 0; i < 10; i++)
+			pool.async([]() { }).get();
+
+		// idle workers park instead of spinning
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		auto m = pool.statistics();
+		CHECK(m.executed == 11);
+		CHECK(m.queued == 0);
+		CHECK(m.parks > 0);
+		CHECK(m.parked >= 1);
+	}
+}
+
+TEST_CASE("concurrency::thread_pool cancelled futures", "[concurrency::thread_pool]")
+{
+	concurrency::thread_pool pool(1);
+	std::atomic<bool> started { false };
+
+	auto running = pool.async([&started]() {
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		return 1;
+	});
+
+	auto queued = pool.async([]() { return 2; });
+
+	while (!started)
+		std::this_thread::yield();
+
+	pool.shutdown(concurrency::shutdown_mode::cancel);
+	CHECK(running.get() == 1);
+	CHECK_THROWS_AS(queued.get(), std::runtime_error);
+}
@@ -0,0 +1,94 @@
+
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+static const char* PCAP_TEST_FILE = "/tmp/libom2_pcap_test.pcap";
+
+//! writes a classic pcap file with two records in big-endian byte order
+static void write_big_endian_pcap(uint32_t magic_, uint32_t last_caplen_ = 100,
+	uint32_t snaplen_ = 65535)
+{
+	std::vector<char> b;
+	auto u16 = [&b](uint16_t v_) { char x[2]; sys::write_uint16(v_, x); b.insert(b.end(), x, x + 2); };
+	auto u32 = [&b](uint32_t v_) { char x[4]; sys::write_uint32(v_, x); b.insert(b.end(), x, x + 4); };
+
+	u32(magic_); u16(2); u16(4); u32(0); u32(0); u32(snaplen_); u32(1);
+	u32(1549505963); u32(250); u32(4); u32(64);
+	b.insert(b.end(), { 0x01, 0x02, 0x03, 0x04 });
+	u32(1549505964); u32(0); u32(2); u32(2);
+	b.insert(b.end(), { 0x05, 0x06 });
+	u32(1549505965); u32(0); u32(last_caplen_); u32(100); // truncated record
+
+	std::ofstream f(PCAP_TEST_FILE, std::ios::binary | std::ios::trunc);
+	f.write(b.data(), b.size());
+}
+
+TEST_CASE("file::pcap", "[file][pcap]")
+{
+	SECTION("pcap_reader")
+	{
+		CHECK_THROWS(file::pcap_reader("does/not/exist.pcap"));
+		CHECK_THROWS(file::pcap_reader("test/data/test.test_format"));
+	}
+
+	SECTION("read")
+	{
+		auto m = GENERATE(file::pcap_reader::mode::mmap, file::pcap_reader::mode::chunked);
+		auto magic = GENERATE((uint32_t) file::pcap_reader::MAGIC_MICROSECONDS,
+			(uint32_t) file::pcap_reader::MAGIC_NANOSECONDS);
+
+		write_big_endian_pcap(magic);
+
+		file::pcap_reader reader(PCAP_TEST_FILE, m, 16);
+		file::packet_record rec;
+
+		CHECK(reader.link_type() == 1);
+		CHECK(reader.snaplen() == 65535);
+
+		REQUIRE(reader.next(rec));
+		CHECK(rec.caplen == 4);
+		CHECK(rec.len == 64);
+		CHECK(rec.data[0] == 0x01);
+		CHECK(rec.data[3] == 0x04);
+		CHECK(rec.timestamp == 1549505963000000000ULL
+			+ (magic == file::pcap_reader::MAGIC_NANOSECONDS ? 250 : 250000));
+
+		REQUIRE(reader.next(rec));
+		CHECK(rec.caplen == 2);
+		CHECK(rec.data[1] == 0x06);
+		CHECK(rec.timestamp == 1549505964000000000ULL);
+
+		CHECK(!reader.next(rec));
+		CHECK(reader.done());
+
+		SECTION("reset")
+		{
+			reader.reset();
+			CHECK(!reader.done());
+
+			unsigned count = 0;
+			while (reader.next(rec)) count++;
+			CHECK(count == 2);
+		}
+	}
+
+	SECTION("corrupt record length")
+	{
+		auto m = GENERATE(file::pcap_reader::mode::mmap, file::pcap_reader::mode::chunked);
+		auto snaplen = GENERATE(65535u, 0xffffffffu); // the latter bounds nothing
+
+		write_big_endian_pcap(file::pcap_reader::MAGIC_MICROSECONDS, 0xfffffff0, snaplen);
+
+		file::pcap_reader reader(PCAP_TEST_FILE, m, 16);
+		file::packet_record rec;
+
+		CHECK(reader.next(rec));
+		CHECK(reader.next(rec));
+		CHECK_THROWS_AS(reader.next(rec), std::runtime_error);
+		CHECK(!reader.next(rec));
+	}
+
+	std::remove(PCAP_TEST_FILE);
+}
@@ -0,0 +1,178 @@
+
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+static const char* PCAPNG_TEST_FILE = "/tmp/libom2_pcapng_test.pcapng";
+
+static void write_bytes(const std::string& file_name_, const std::vector<unsigned char>& bytes_)
+{
+	std::ofstream f(file_name_, std::ios::binary | std::ios::trunc);
+	f.write((const char*) bytes_.data(), bytes_.size());
+}
+
+static std::vector<unsigned char> read_bytes(const std::string& file_name_)
+{
+	std::ifstream f(file_name_, std::ios::binary);
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(f),
+		std::istreambuf_iterator<char>());
+}
+
+//! a big-endian section with one interface (2^-10 s resolution by default) and one enhanced
+//! packet block
+static std::vector<unsigned char> big_endian_section(uint8_t tsresol_ = 0x8a)
+{
+	std::vector<unsigned char> b;
+	auto u16 = [&b](uint16_t v_) { char x[2]; sys::write_uint16(v_, x); b.insert(b.end(), x, x + 2); };
+	auto u32 = [&b](uint32_t v_) { char x[4]; sys::write_uint32(v_, x); b.insert(b.end(), x, x + 4); };
+
+	u32(0x0a0d0d0a); u32(28); u32(0x1a2b3c4d); u16(1); u16(0); u32(0xffffffff); u32(0xffffffff);
+	u32(28);
+
+	u32(1); u32(32); u16(1); u16(0); u32(96);
+	u16(9); u16(1); b.push_back(tsresol_); b.push_back(0); b.push_back(0); b.push_back(0);
+	u32(0);
+	u32(32);
+
+	u32(2); u32(16); // unknown block type, skipped
+	u32(0xdeadbeef);
+	u32(16);
+
+	u32(6); u32(36); u32(0); u32(0); u32(2048); u32(3); u32(60);
+	b.push_back(0xaa); b.push_back(0xbb); b.push_back(0xcc); b.push_back(0);
+	u32(36);
+
+	return b;
+}
+
+TEST_CASE("file::pcapng", "[file][pcapng]")
+{
+	unsigned char pkt1[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+	unsigned char pkt2[] = { 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18 };
+	unsigned char pkt3[] = { 0x21, 0x22, 0x23 };
+
+	{
+		file::pcapng_writer writer(PCAPNG_TEST_FILE, 64);
+		CHECK(writer.add_interface(1, 65535, 6, "eth0") == 0);
+		CHECK(writer.add_interface(1, 4, 9) == 1);
+		writer.write(0, 1549505963123456000ULL, pkt1, sizeof(pkt1), 1500);
+		writer.write(1, 1549505963123456789ULL, pkt2, 4, sizeof(pkt2), 0x1);
+		writer.write_simple(pkt3, sizeof(pkt3));
+	}
+
+	SECTION("pcapng_reader")
+	{
+		CHECK_THROWS(file::pcapng_reader("does/not/exist.pcapng"));
+		CHECK_THROWS(file::pcapng_reader("test/data/test.test_format"));
+		CHECK_THROWS(file::pcapng_reader("test/data/test.test_format",
+			file::pcapng_reader::mode::chunked));
+	}
+
+	SECTION("read")
+	{
+		auto m = GENERATE(file::pcapng_reader::mode::mmap, file::pcapng_reader::mode::chunked);
+		file::pcapng_reader reader(PCAPNG_TEST_FILE, m, 16);
+		file::packet_record rec;
+
+		REQUIRE(reader.next(rec));
+		CHECK(reader.interfaces().size() == 2);
+		CHECK(reader.interfaces()[0].name == "eth0");
+		CHECK(reader.interfaces()[0].snaplen == 65535);
+		CHECK(reader.interfaces()[1].tsresol == 9);
+		CHECK(rec.interface_id == 0);
+		CHECK(rec.timestamp == 1549505963123456000ULL);
+		CHECK(rec.caplen == sizeof(pkt1));
+		CHECK(rec.len == 1500);
+		CHECK(rec.flags == 0);
+		CHECK(std::memcmp(rec.data, pkt1, sizeof(pkt1)) == 0);
+
+		REQUIRE(reader.next(rec));
+		CHECK(rec.interface_id == 1);
+		CHECK(rec.timestamp == 1549505963123456789ULL);
+		CHECK(rec.caplen == 4);
+		CHECK(rec.len == sizeof(pkt2));
+		CHECK(rec.flags == 0x1);
+		CHECK(std::memcmp(rec.data, pkt2, 4) == 0);
+
+		REQUIRE(reader.next(rec));
+		CHECK(rec.interface_id == 0);
+		CHECK(rec.caplen == sizeof(pkt3));
+		CHECK(std::memcmp(rec.data, pkt3, sizeof(pkt3)) == 0);
+
+		CHECK(!reader.next(rec));
+		CHECK(reader.done());
+
+		SECTION("reset")
+		{
+			reader.reset();
+			CHECK(!reader.done());
+
+			unsigned count = 0;
+			while (reader.next(rec)) count++;
+			CHECK(count == 3);
+		}
+	}
+
+	SECTION("read - big endian and multiple sections")
+	{
+		auto bytes = big_endian_section();
+		auto little = read_bytes(PCAPNG_TEST_FILE);
+		bytes.insert(bytes.end(), little.begin(), little.end());
+		bytes.insert(bytes.end(), { 0x06, 0x00, 0x00, 0x00, 0x40 }); // truncated block
+		write_bytes(PCAPNG_TEST_FILE, bytes);
+
+		auto m = GENERATE(file::pcapng_reader::mode::mmap, file::pcapng_reader::mode::chunked);
+		file::pcapng_reader reader(PCAPNG_TEST_FILE, m, 16);
+		file::packet_record rec;
+
+		REQUIRE(reader.next(rec));
+		CHECK(reader.interfaces().size() == 1);
+		CHECK(reader.interfaces()[0].tsresol == 0x8a);
+		CHECK(rec.timestamp == 2000000000);
+		CHECK(rec.caplen == 3);
+		CHECK(rec.len == 60);
+		CHECK(rec.data[0] == 0xaa);
+		CHECK(rec.data[2] == 0xcc);
+
+		REQUIRE(reader.next(rec));
+		CHECK(reader.interfaces().size() == 2);
+		CHECK(rec.timestamp == 1549505963123456000ULL);
+
+		CHECK(reader.next(rec));
+		CHECK(reader.next(rec));
+		CHECK_THROWS_AS(reader.next(rec), std::runtime_error);
+		CHECK(!reader.next(rec));
+		CHECK(reader.done());
+	}
+
+	SECTION("read - timestamp resolution out of range")
+	{
+		auto tsresol = GENERATE((uint8_t) 20, (uint8_t) 0xc0);
+		write_bytes(PCAPNG_TEST_FILE, big_endian_section(tsresol));
+
+		file::pcapng_reader reader(PCAPNG_TEST_FILE);
+		file::packet_record rec;
+		CHECK_THROWS_AS(reader.next(rec), std::runtime_error);
+
+		CHECK_THROWS_AS(file::pcapng_writer(PCAPNG_TEST_FILE).add_interface(1, 65535, tsresol),
+			std::invalid_argument);
+	}
+
+	SECTION("pcapng::to_nanoseconds")
+	{
+		CHECK(file::pcapng::to_nanoseconds(1, 6) == 1000);
+		CHECK(file::pcapng::to_nanoseconds(1, 9) == 1);
+		CHECK(file::pcapng::to_nanoseconds(1000, 12) == 1);
+		CHECK(file::pcapng::to_nanoseconds(1024, 0x8a) == 1000000000);
+		CHECK(file::pcapng::from_nanoseconds(1000000000, 0x8a) == 1024);
+		CHECK(file::pcapng::from_nanoseconds(1500, 6) == 1);
+		CHECK(file::pcapng::to_nanoseconds(10000000000ULL, 19) == 1);
+		CHECK(file::pcapng::valid_tsresol(19));
+		CHECK(file::pcapng::valid_tsresol(0xbf));
+		CHECK(!file::pcapng::valid_tsresol(20));
+		CHECK(!file::pcapng::valid_tsresol(0xc0));
+	}
+
+	std::remove(PCAPNG_TEST_FILE);
+}
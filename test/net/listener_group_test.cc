@@ -0,0 +1,71 @@
+
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+#ifdef __linux__
+
+TEST_CASE("net::listener_group", "[net][listener_group]")
+{
+	const auto localhost = net::ip4_addr::from_string("127.0.0.1");
+	const unsigned senders = 32, per_sender = 4; // stays below the default receive buffer
+
+	net::listener_group::config cfg;
+	cfg.size = 4;
+	cfg.poll_timeout = 10;
+	cfg.cpu_steering = GENERATE(false, true);
+
+	net::listener_group group(localhost, 0, cfg);
+	REQUIRE(group.size() == 4);
+	REQUIRE(group.port() != 0);
+
+	std::atomic<unsigned> total { 0 };
+	std::atomic<bool> wrong_thread { false };
+	std::vector<std::thread::id> thread_ids(group.size());
+
+	group.start([&](unsigned index_, const net::datagram_batch& batch_) {
+		// each index is only ever served by one thread
+		if (thread_ids[index_] == std::thread::id()) {
+			thread_ids[index_] = std::this_thread::get_id();
+		} else if (thread_ids[index_] != std::this_thread::get_id()) {
+			wrong_thread = true;
+		}
+
+		total += batch_.size();
+	});
+
+	unsigned char payload[32] = { 0 };
+
+	for (unsigned i = 0; i < senders; i++) {
+		net::socket tx(net::socket::type::dgram);
+
+		for (unsigned j = 0; j < per_sender; j++)
+			tx.send_to("127.0.0.1", group.port(), payload, sizeof(payload));
+	}
+
+	auto start = etc::now();
+
+	while (total < senders * per_sender && etc::seconds_since(start) < 2)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	group.stop();
+
+	CHECK(total == senders * per_sender);
+	CHECK(!wrong_thread);
+
+	uint64_t sum = 0;
+	unsigned used = 0;
+
+	for (unsigned i = 0; i < group.size(); i++) {
+		sum += group.received(i);
+		used += group.received(i) > 0;
+	}
+
+	CHECK(sum == senders * per_sender);
+
+	if (!cfg.cpu_steering)
+		CHECK(used > 1); // flows are spread by hash
+}
+
+#endif
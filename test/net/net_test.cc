@@ -65,6 +65,11 @@ TEST_CASE("net", "[net]")
 		CHECK_THROWS(net::parse_host_port("127.0.0.1/3222"));
         CHECK_THROWS(net::parse_host_port("127.0.0.1"));
         CHECK_THROWS(net::parse_host_port("12732"));
+
+		auto test2 = net::parse_host_port("[::1]:53");
+		CHECK(test2.first == "::1");
+		CHECK(test2.second == 53);
+		CHECK_THROWS(net::parse_host_port("[::1]"));
 	}
 
 	SECTION("parse an arp packet")
@@ -0,0 +1,169 @@
+
+#include <memory>
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+#ifdef __linux__
+
+static std::unique_ptr<net::packet_capture> open_capture(const net::packet_capture::config& cfg_)
+{
+	try {
+		return std::unique_ptr<net::packet_capture>(new net::packet_capture("lo", cfg_));
+	} catch (const std::runtime_error& e) {
+		WARN("skipping packet_capture test: " << e.what());
+		return nullptr;
+	}
+}
+
+static unsigned count_udp(const net::packet_capture::frame* frames_, unsigned count_,
+	uint16_t dest_port_, bool outgoing_ = false)
+{
+	unsigned matched = 0;
+
+	for (unsigned i = 0; i < count_; i++) {
+		const net::packet_capture::frame& f = frames_[i];
+
+		if ((!outgoing_ && f.pkttype == PACKET_OUTGOING) || f.caplen < 42)
+			continue;
+
+		net::ethernet_header eth(f.data);
+		net::ip4_header ip(f.data + eth.len());
+
+		if (eth.ether_type() != 0x0800 || ip.proto() != 17)
+			continue;
+
+		net::udp_header udp(f.data + eth.len() + ip.len());
+
+		if (udp.dest_port() == dest_port_ && ip.dest_addr() == net::ip4_addr::from_string("127.0.0.1"))
+			matched++;
+	}
+
+	return matched;
+}
+
+TEST_CASE("net::packet_capture", "[net][packet_capture]")
+{
+	const uint16_t port = 47001;
+	const unsigned count = 16;
+	unsigned char payload[64] = { 0 };
+
+	net::packet_capture::config cfg;
+	cfg.block_size  = 1 << 16;
+	cfg.block_count = 8;
+	cfg.block_timeout = 5;
+
+	SECTION("packet_capture")
+	{
+		CHECK_THROWS(net::packet_capture("does-not-exist0", cfg));
+	}
+
+	SECTION("dispatch")
+	{
+		auto cap = open_capture(cfg);
+
+		if (!cap)
+			return;
+
+		net::socket sock(net::socket::type::dgram);
+
+		for (unsigned i = 0; i < count; i++)
+			sock.send_to("127.0.0.1", port, payload, sizeof(payload));
+
+		unsigned matched = 0;
+		auto start = etc::now();
+
+		while (matched < count && etc::seconds_since(start) < 2)
+			cap->dispatch([&matched, port](const net::packet_capture::frame* f_, unsigned n_) {
+				matched += count_udp(f_, n_, port);
+			}, 100);
+
+		CHECK(matched == count);
+
+		auto st = cap->statistics();
+		CHECK(st.frames >= count);
+		CHECK(st.blocks > 0);
+		CHECK(st.bytes > 0);
+		CHECK(st.packets >= count);
+	}
+
+	SECTION("a throwing handler still releases the block")
+	{
+		auto cap = open_capture(cfg);
+
+		if (!cap)
+			return;
+
+		net::socket sock(net::socket::type::dgram);
+		sock.send_to("127.0.0.1", port, payload, sizeof(payload));
+
+		unsigned matched = 0;
+		auto start = etc::now();
+
+		while (matched == 0 && etc::seconds_since(start) < 2) {
+			try {
+				cap->dispatch([&matched, port](const net::packet_capture::frame* f_, unsigned n_) {
+					matched += count_udp(f_, n_, port);
+
+					if (n_ > 0)
+						throw std::runtime_error("handler failed");
+				}, 100);
+			} catch (const std::runtime_error&) { }
+		}
+
+		REQUIRE(matched == 1);
+		auto st = cap->statistics();
+		CHECK(st.blocks > 0);
+
+		// the block is not delivered again, the next datagram is
+		for (unsigned i = 0; i < count; i++)
+			sock.send_to("127.0.0.1", port, payload, sizeof(payload));
+
+		start = etc::now();
+
+		while (matched < 1 + count && etc::seconds_since(start) < 2)
+			cap->dispatch([&matched, port](const net::packet_capture::frame* f_, unsigned n_) {
+				matched += count_udp(f_, n_, port);
+			}, 100);
+
+		CHECK(matched == 1 + count);
+		CHECK(cap->statistics().frames >= st.frames + count);
+	}
+
+	SECTION("fanout")
+	{
+		cfg.fanout_mode  = net::packet_capture::fanout::lb;
+		cfg.fanout_group = (uint16_t) (::getpid() & 0xffff);
+
+		auto cap1 = open_capture(cfg);
+		auto cap2 = open_capture(cfg);
+
+		if (!cap1 || !cap2)
+			return;
+
+		net::socket sock(net::socket::type::dgram);
+
+		for (unsigned i = 0; i < count; i++)
+			sock.send_to("127.0.0.1", port, payload, sizeof(payload));
+
+		unsigned matched1 = 0, matched2 = 0;
+		auto start = etc::now();
+
+		// loopback frames are seen twice (outgoing and incoming), both are load-balanced
+		while (matched1 + matched2 < 2 * count && etc::seconds_since(start) < 2) {
+			cap1->dispatch([&matched1, port](const net::packet_capture::frame* f_, unsigned n_) {
+				matched1 += count_udp(f_, n_, port, true);
+			}, 10);
+			cap2->dispatch([&matched2, port](const net::packet_capture::frame* f_, unsigned n_) {
+				matched2 += count_udp(f_, n_, port, true);
+			}, 10);
+		}
+
+		CHECK(matched1 + matched2 == 2 * count);
+		CHECK(matched1 > 0);
+		CHECK(matched2 > 0);
+	}
+}
+
+#endif
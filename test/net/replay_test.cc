@@ -0,0 +1,164 @@
+
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+static const char* REPLAY_TEST_FILE = "/tmp/libom2_replay_test.pcapng";
+
+//! writes count_ Ethernet/IPv4/UDP frames spaced 1 ms apart, each carrying its index as payload
+static void write_udp_capture(unsigned count_)
+{
+	file::pcapng_writer writer(REPLAY_TEST_FILE);
+	writer.add_interface();
+
+	for (unsigned i = 0; i < count_; i++) {
+		unsigned char frame[14 + 20 + 8 + 4] = { 0 };
+
+		net::ethernet_header eth;
+		eth.set_ether_type(0x0800);
+		eth.write(frame);
+
+		net::ip4_header ip;
+		ip.set_proto(17);
+		ip.set_total_len(20 + 8 + 4);
+		ip.write(frame + 14);
+
+		net::udp_header udp;
+		udp.set_src_port(1000);
+		udp.set_dest_port(2000);
+		udp.set_payload_length(8 + 4);
+		udp.write(frame + 34);
+
+		sys::write_uint32(i, (char*) frame + 42);
+		writer.write(0, 1549505963000000000ULL + i * 1000000ULL, frame, sizeof(frame));
+	}
+
+	unsigned char arp[42] = { 0 };
+	arp[12] = 0x08; arp[13] = 0x06;
+	writer.write(0, 1549505963000000000ULL + count_ * 1000000ULL, arp, sizeof(arp));
+}
+
+TEST_CASE("net::replayer", "[net][replay]")
+{
+	const unsigned count = 20;
+	const unsigned short port = 47002;
+
+	write_udp_capture(count);
+
+	net::socket rx(net::socket::type::dgram);
+	rx.bind("0.0.0.0", port);
+
+	struct timeval tv { 1, 0 };
+	::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	net::socket tx(net::socket::type::dgram);
+	net::udp_payload_sink sink(tx, "127.0.0.1", port);
+
+	auto receive_all = [&rx]() {
+		unsigned char buf[64];
+
+		for (unsigned i = 0; i < count; i++) {
+			CHECK(rx.receive(buf, sizeof(buf)) == 4);
+			CHECK(sys::read_uint32((const char*) buf) == i);
+		}
+	};
+
+	SECTION("replayer")
+	{
+		net::replayer::config cfg;
+		cfg.timing = net::replayer::mode::fixed_rate;
+		CHECK_THROWS(net::replayer(cfg));
+		cfg.timing = net::replayer::mode::multiplier;
+		cfg.multiplier = 0;
+		CHECK_THROWS(net::replayer(cfg));
+	}
+
+	SECTION("max_rate")
+	{
+		net::replayer::config cfg;
+		cfg.timing = net::replayer::mode::max_rate;
+		file::pcapng_reader reader(REPLAY_TEST_FILE);
+
+		auto rep = net::replayer(cfg).run(reader, sink);
+		CHECK(rep.packets == count + 1);
+		CHECK(rep.sent == count);
+		CHECK(sink.skipped() == 1);
+		CHECK(sink.dropped() == 0);
+		CHECK(rep.pps() > 0);
+		receive_all();
+	}
+
+	SECTION("mapped records are sent without a copy")
+	{
+		struct recording_sink
+		{
+			std::vector<const unsigned char*> data;
+
+			unsigned send(const file::packet_record* recs_, unsigned count_)
+			{
+				for (unsigned i = 0; i < count_; i++)
+					data.push_back(recs_[i].data);
+
+				return count_;
+			}
+		} recorder;
+
+		net::replayer::config cfg;
+		cfg.timing = net::replayer::mode::max_rate;
+		file::pcapng_reader reader(REPLAY_TEST_FILE);
+		REQUIRE(reader.mapped());
+
+		CHECK(net::replayer(cfg).run(reader, recorder).sent == count + 1);
+		REQUIRE(recorder.data.size() == count + 1);
+
+		reader.reset();
+		file::packet_record rec;
+
+		for (auto* data : recorder.data) {
+			REQUIRE(reader.next(rec));
+			CHECK(data == rec.data);
+		}
+	}
+
+	SECTION("original")
+	{
+		file::pcapng_reader reader(REPLAY_TEST_FILE);
+
+		auto rep = net::replayer().run(reader, sink);
+		CHECK(rep.sent == count);
+		CHECK(rep.seconds >= 0.019);
+		CHECK(rep.mean_error_ns < 5000000);
+		receive_all();
+	}
+
+	SECTION("multiplier")
+	{
+		net::replayer::config cfg;
+		cfg.timing = net::replayer::mode::multiplier;
+		cfg.multiplier = 4;
+		file::pcapng_reader reader(REPLAY_TEST_FILE);
+
+		auto rep = net::replayer(cfg).run(reader, sink);
+		CHECK(rep.sent == count);
+		CHECK(rep.seconds >= 0.005);
+		CHECK(rep.seconds < 0.019);
+		receive_all();
+	}
+
+	SECTION("fixed_rate")
+	{
+		net::replayer::config cfg;
+		cfg.timing = net::replayer::mode::fixed_rate;
+		cfg.rate = 2000;
+		file::pcapng_reader reader(REPLAY_TEST_FILE);
+
+		auto rep = net::replayer(cfg).run(reader, sink);
+		CHECK(rep.sent == count);
+		CHECK(rep.seconds >= 0.0099);
+		CHECK(rep.pps() < 2500);
+		receive_all();
+	}
+
+	std::remove(REPLAY_TEST_FILE);
+}
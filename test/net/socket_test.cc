@@ -1,9 +1,274 @@
 
 #include <catch.h>
+#include <om/om.h>
 
+using namespace om;
 
 TEST_CASE("net::socket", "[net][socket]")
 {
+	SECTION("receive_batch/send_batch")
+	{
+		const unsigned short port = 47003;
+		const auto localhost = net::ip4_addr::from_string("127.0.0.1");
 
+		net::socket rx(net::socket::type::dgram);
+		rx.bind("0.0.0.0", port);
+		net::socket tx(net::socket::type::dgram);
 
+		net::datagram_batch out(8, 64);
+		net::datagram_batch in(4, 64);
+		unsigned char buf[64] = { 0 };
+
+		CHECK(out.capacity() == 8);
+		CHECK(out.empty());
+
+		for (unsigned i = 0; i < 6; i++) {
+			buf[0] = (unsigned char) i;
+			CHECK(out.push(buf, i + 1, localhost, port));
+		}
+
+		CHECK(!out.push(buf, 65, localhost, port));
+		CHECK(out.size() == 6);
+		CHECK(out.addr(0) == localhost);
+		CHECK(out.port(0) == port);
+		CHECK(tx.send_batch(out) == 6);
+
+		CHECK(rx.receive_batch(in) == 4);
+
+		for (unsigned i = 0; i < 4; i++) {
+			CHECK(in.len(i) == i + 1);
+			CHECK(in.data(i)[0] == i);
+			CHECK(in.addr(i) == localhost);
+		}
+
+		CHECK(rx.receive_batch(in) == 2);
+		CHECK(in.len(1) == 6);
+		CHECK(rx.receive_batch(in, MSG_DONTWAIT) == 0);
+		CHECK(in.empty());
+	}
+
+	SECTION("send_segmented/receive_coalesced")
+	{
+		const unsigned short port = 47004;
+		const auto localhost = net::ip4_addr::from_string("127.0.0.1");
+
+		net::socket rx(net::socket::type::dgram);
+		rx.bind("0.0.0.0", port);
+		net::socket tx(net::socket::type::dgram);
+
+		auto gro = GENERATE(false, true);
+
+		if (gro && !rx.enable_gro())
+			WARN("UDP_GRO not supported");
+
+		// their control messages come before UDP_GRO's
+		rx.enable_timestamps();
+		rx.enable_drop_counter();
+
+		std::vector<unsigned char> out(10 * 1000 + 500);
+
+		for (std::size_t i = 0; i < out.size(); i++)
+			out[i] = (unsigned char) (i / 1000);
+
+		CHECK(tx.send_segmented(localhost, port, out.data(), (unsigned) out.size(), 1000)
+			== out.size());
+
+		unsigned char in[65536];
+		unsigned received = 0, datagrams = 0;
+
+		while (received < out.size()) {
+			uint16_t segment_size = 0;
+			net::ip4_addr ip;
+			uint16_t src_port = 0;
+
+			unsigned len = rx.receive_coalesced(in, sizeof(in), segment_size, ip, src_port);
+			CHECK(ip == localhost);
+			REQUIRE(segment_size > 0);
+
+			for (unsigned off = 0; off < len; off += segment_size, datagrams++) {
+				unsigned seg_len = std::min<unsigned>(segment_size, len - off);
+				CHECK(seg_len == (datagrams == 10 ? 500 : 1000));
+				CHECK(in[off] == datagrams);
+			}
+
+			received += len;
+		}
+
+		CHECK(received == out.size());
+		CHECK(datagrams == 11);
+		CHECK(rx.statistics().datagrams == 11);
+		CHECK(rx.statistics().bytes == out.size());
+
+		// an empty datagram is one datagram with a segment size of 0
+		CHECK(tx.send_to("127.0.0.1", port, out.data(), 0) == 0);
+
+		uint16_t segment_size = 0;
+		net::ip4_addr ip;
+		uint16_t src_port = 0;
+
+		CHECK(rx.receive_coalesced(in, sizeof(in), segment_size, ip, src_port) == 0);
+		CHECK(segment_size == 0);
+		CHECK(rx.statistics().datagrams == 12);
+	}
+
+	SECTION("connected send/receive_from with endpoints")
+	{
+		net::socket rx(net::socket::type::dgram);
+		rx.bind(net::endpoint::from_string("127.0.0.1", 0));
+		auto rx_ep = rx.local_endpoint();
+		REQUIRE(rx_ep.is_ip4());
+		REQUIRE(rx_ep.port() != 0);
+		CHECK(rx_ep.address() == "127.0.0.1");
+
+		net::socket tx(net::socket::type::dgram);
+		tx.connect(rx_ep);
+
+		unsigned char buf[16] = { 1, 2, 3 };
+		CHECK(tx.send(buf, 3) == 3);
+		CHECK(tx.send_to(rx_ep, buf, 2) == 2);
+
+		net::endpoint from;
+		unsigned char in[16] = { 0 };
+		CHECK(rx.receive_from(in, sizeof(in), from) == 3);
+		CHECK(in[2] == 3);
+		CHECK(from == tx.local_endpoint());
+		CHECK(rx.receive_from(in, sizeof(in), from) == 2);
+
+		// a batch without addresses goes to the connected peer
+		net::datagram_batch out(4, 16);
+		CHECK(out.push(buf, 1));
+		CHECK(out.push(buf, 2, rx_ep));
+		CHECK(tx.send_batch(out) == 2);
+
+		net::datagram_batch batch(4, 16);
+		unsigned received = 0;
+
+		while (received < 2)
+			received += rx.receive_batch(batch);
+
+		CHECK(batch.peer(0) == from);
+	}
+
+	SECTION("ip6")
+	{
+		std::unique_ptr<net::socket> rx;
+
+		try {
+			rx.reset(new net::socket(net::socket::type::dgram, AF_INET6));
+			rx->bind(net::endpoint::from_string("::1", 0));
+		} catch (const std::runtime_error&) {
+			WARN("IPv6 loopback not available");
+			return;
+		}
+
+		auto rx_ep = rx->local_endpoint();
+		CHECK(rx_ep.is_ip6());
+
+		net::socket tx(net::socket::type::dgram, AF_INET6);
+		unsigned char buf[4] = { 9 };
+		CHECK(tx.send_to(net::endpoint::parse(rx_ep.to_string()), buf, 1) == 1);
+
+		net::endpoint from;
+		CHECK(rx->receive_from(buf, sizeof(buf), from) == 1);
+		CHECK(from.is_ip6());
+		CHECK(from.address() == "::1");
+
+		// the coalescing and batch receive paths keep the whole IPv6 source address
+		CHECK(tx.send_to(rx_ep, buf, 2) == 2);
+
+		uint16_t segment_size = 0;
+		net::endpoint coalesced_from;
+		CHECK(rx->receive_coalesced(buf, sizeof(buf), segment_size, coalesced_from) == 2);
+		CHECK(coalesced_from == from);
+
+		CHECK(tx.send_to(rx_ep, buf, 3) == 3);
+
+		net::datagram_batch batch(4, 64);
+		CHECK(rx->receive_batch(batch) == 1);
+		CHECK(batch.peer(0) == from);
+		CHECK(batch.port(0) == from.port());
+		CHECK(batch.addr(0) == net::ip4_addr());
+	}
+
+	SECTION("kernel timestamps and drop counter")
+	{
+		auto wall_ns = []() {
+			return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+		};
+
+		net::socket rx(net::socket::type::dgram);
+		rx.bind(net::endpoint::from_string("127.0.0.1", 0));
+		auto rx_ep = rx.local_endpoint();
+
+		int rcvbuf = 4096;
+		::setsockopt(rx.fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		rx.enable_timestamps();
+		rx.enable_drop_counter();
+
+		net::socket tx(net::socket::type::dgram);
+		tx.connect(rx_ep);
+		unsigned char buf[1000] = { 0 };
+
+		uint64_t before = wall_ns();
+		tx.send(buf, 100);
+
+		net::endpoint from;
+		uint64_t timestamp = 0;
+		CHECK(rx.receive_from(buf, sizeof(buf), from, timestamp) == 100);
+		CHECK(timestamp >= before);
+		CHECK(timestamp <= wall_ns());
+		CHECK(rx.statistics().drops == 0);
+
+		// overflow the receive queue, drops are reported with the next datagram
+		for (unsigned i = 0; i < 64; i++)
+			tx.send(buf, sizeof(buf));
+
+		net::datagram_batch batch(64, sizeof(buf));
+		uint64_t last = 0;
+
+		while (rx.receive_batch(batch, MSG_DONTWAIT) > 0) {
+			for (unsigned i = 0; i < batch.size(); i++) {
+				CHECK(batch.timestamp(i) >= last);
+				last = batch.timestamp(i);
+			}
+		}
+
+		CHECK(last >= timestamp);
+
+		tx.send(buf, 10);
+		CHECK(rx.receive_batch(batch) == 1);
+		CHECK(batch.timestamp(0) >= last);
+		CHECK(rx.statistics().drops > 0);
+		CHECK(rx.statistics().datagrams + rx.statistics().drops == 66);
+
+		rx.enable_timestamps(false);
+		tx.send(buf, 10);
+		CHECK(rx.receive_batch(batch) == 1);
+		CHECK(batch.timestamp(0) == 0);
+	}
+}
+
+TEST_CASE("net::endpoint", "[net][socket]")
+{
+	auto ep = net::endpoint::from_string("10.1.2.3", 8080);
+	CHECK(ep.family() == AF_INET);
+	CHECK(ep.port() == 8080);
+	CHECK(ep.ip4() == net::ip4_addr::from_string("10.1.2.3"));
+	CHECK(ep.to_string() == "10.1.2.3:8080");
+	CHECK(ep == net::endpoint(net::ip4_addr::from_string("10.1.2.3"), 8080));
+	CHECK(ep == net::endpoint::parse("10.1.2.3:8080"));
+	CHECK(ep != net::endpoint::parse("10.1.2.3:8081"));
+
+	auto ep6 = net::endpoint::parse("[fe80::1]:53");
+	CHECK(ep6.is_ip6());
+	CHECK(ep6.port() == 53);
+	CHECK(ep6.to_string() == "[fe80::1]:53");
+	CHECK_THROWS(ep6.ip4());
+
+	CHECK(net::endpoint().family() == AF_UNSPEC);
+	CHECK_THROWS(net::endpoint::from_string("localhost", 1));
+	CHECK_THROWS(net::endpoint::parse("::1:80"));
+	CHECK(net::endpoint::resolve("localhost", 80, AF_INET).ip4()
+		== net::ip4_addr::from_string("127.0.0.1"));
 }
@@ -0,0 +1,118 @@
+
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+static bool wait_for(int fd_, short events_)
+{
+	struct pollfd pfd { fd_, events_, 0 };
+	return ::poll(&pfd, 1, 1000) == 1;
+}
+
+TEST_CASE("net::tcp", "[net][tcp]")
+{
+	const auto localhost = net::ip4_addr::from_string("127.0.0.1");
+
+	net::tcp_listener listener(localhost);
+	REQUIRE(listener.port() != 0);
+
+	SECTION("connect/accept_batch")
+	{
+		std::vector<net::tcp_stream> clients(3);
+
+		for (auto& c : clients) {
+			auto r = c.connect(localhost, listener.port());
+			CHECK((r.ok() || r.in_progress()));
+		}
+
+		std::vector<net::tcp_stream> accepted;
+
+		while (accepted.size() < clients.size() && wait_for(listener.fd(), POLLIN)) {
+			auto r = listener.accept_batch(accepted);
+			CHECK((r.ok() || r.would_block()));
+		}
+
+		CHECK(accepted.size() == 3);
+
+		for (auto& c : clients) {
+			REQUIRE(wait_for(c.fd(), POLLOUT));
+			CHECK(c.finish_connect().ok());
+		}
+
+		auto r = listener.accept_batch(accepted);
+		CHECK(r.value() == 0);
+		CHECK(r.would_block());
+	}
+
+	SECTION("read/write")
+	{
+		net::tcp_stream client, server;
+		client.connect(localhost, listener.port());
+
+		REQUIRE(wait_for(listener.fd(), POLLIN));
+		REQUIRE(listener.accept(server).ok());
+		REQUIRE(wait_for(client.fd(), POLLOUT));
+		REQUIRE(client.finish_connect().ok());
+		client.set_nodelay();
+
+		unsigned char buf[16] = { 0 };
+		CHECK(server.read(buf, sizeof(buf)).would_block());
+
+		SECTION("readv/writev")
+		{
+			unsigned char a[] = { 1, 2, 3 }, b[] = { 4, 5 };
+			struct iovec out[] = { { a, sizeof(a) }, { b, sizeof(b) } };
+			CHECK(client.writev(out, 2).value() == 5);
+
+			REQUIRE(wait_for(server.fd(), POLLIN));
+
+			unsigned char c[2], d[8];
+			struct iovec in[] = { { c, sizeof(c) }, { d, sizeof(d) } };
+			auto r = server.readv(in, 2);
+			CHECK(r.ok());
+			CHECK(r.value() == 5);
+			CHECK(c[0] == 1);
+			CHECK(c[1] == 2);
+			CHECK(d[0] == 3);
+			CHECK(d[2] == 5);
+		}
+
+		SECTION("eof")
+		{
+			CHECK(client.write(buf, 4).value() == 4);
+
+			// only reads report the end of the stream
+			auto empty = client.write(buf, 0);
+			CHECK(empty.ok());
+			CHECK(!empty.eof());
+
+			CHECK(client.shutdown_write().ok());
+
+			std::size_t total = 0;
+			sys::io_result r;
+
+			while (wait_for(server.fd(), POLLIN) && (r = server.read(buf, sizeof(buf))).value() > 0)
+				total += r.value();
+
+			CHECK(total == 4);
+			CHECK(r.eof());
+		}
+	}
+
+	SECTION("connection refused")
+	{
+		uint16_t port = listener.port();
+		listener.close();
+
+		net::tcp_stream client;
+		auto r = client.connect(localhost, port);
+
+		if (r.in_progress()) {
+			REQUIRE(wait_for(client.fd(), POLLOUT));
+			r = client.finish_connect();
+		}
+
+		CHECK(r.error() == ECONNREFUSED);
+	}
+}
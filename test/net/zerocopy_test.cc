@@ -0,0 +1,80 @@
+
+#include <catch.h>
+#include <om/om.h>
+
+using namespace om;
+
+#ifdef __linux__
+
+TEST_CASE("net::zerocopy_sender", "[net][zerocopy]")
+{
+	const unsigned short port = 47006;
+	const auto localhost = net::ip4_addr::from_string("127.0.0.1");
+
+	net::socket rx(net::socket::type::dgram);
+	rx.bind("0.0.0.0", port);
+	net::socket tx(net::socket::type::dgram);
+
+	net::zerocopy_sender sender(tx, 2, 32768, 4096);
+
+	SECTION("acquire/release")
+	{
+		unsigned char* a = sender.acquire();
+		unsigned char* b = sender.acquire();
+		CHECK(a != nullptr);
+		CHECK(b != nullptr);
+		CHECK(a != b);
+		CHECK(sender.acquire() == nullptr);
+
+		sender.release(a);
+		CHECK(sender.acquire() == a);
+
+		unsigned char other[16];
+		CHECK_THROWS(sender.release(other));
+	}
+
+	SECTION("send longer than the buffer")
+	{
+		unsigned char* buf = sender.acquire();
+		CHECK_THROWS_AS(sender.send_to(buf, sender.buffer_size() + 1, localhost, port),
+			std::invalid_argument);
+
+		// the buffer stays acquired and can still be sent
+		CHECK(sender.send_to(buf, 16, localhost, port) == 16);
+		CHECK(sender.wait_all(1000));
+	}
+
+	SECTION("send_to")
+	{
+		if (!sender.enabled())
+			WARN("SO_ZEROCOPY not supported, sends are copied");
+
+		unsigned char* large = sender.acquire();
+		std::memset(large, 0xab, 20000);
+		CHECK(sender.send_to(large, 20000, localhost, port) == 20000);
+
+		unsigned char* small = sender.acquire();
+		std::memset(small, 0xcd, 100);
+		CHECK(sender.send_to(small, 100, localhost, port) == 100);
+		CHECK_THROWS(sender.send_to(small, 100, localhost, port)); // already returned
+
+		CHECK(sender.wait_all(1000));
+		CHECK(sender.in_flight() == 0);
+
+		auto& st = sender.statistics();
+		CHECK(st.copied_sends == (sender.enabled() ? 1 : 2));
+		CHECK(st.zerocopy_sends == (sender.enabled() ? 1 : 0));
+		CHECK(st.completions == st.zerocopy_sends);
+
+		unsigned char buf[32768];
+		CHECK(rx.receive(buf, sizeof(buf)) == 20000);
+		CHECK(buf[19999] == 0xab);
+		CHECK(rx.receive(buf, sizeof(buf)) == 100);
+		CHECK(buf[0] == 0xcd);
+
+		CHECK(sender.acquire() != nullptr);
+		CHECK(sender.acquire() != nullptr);
+	}
+}
+
+#endif
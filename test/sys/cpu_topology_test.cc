@@ -0,0 +1,120 @@
+#include <catch.h>
+#include <numeric>
+#include <om/om.h>
+
+using namespace om;
+
+TEST_CASE("sys::cpu_set", "[sys::cpu_topology]")
+{
+	SECTION("parse and format cpu lists") {
+		sys::cpu_set set = sys::cpu_set::parse("0-3,8, 10-11\n");
+		CHECK(set.size() == 7);
+		CHECK(set.contains(2));
+		CHECK(!set.contains(9));
+		CHECK(set.to_string() == "0-3,8,10-11");
+		CHECK(sys::cpu_set::parse("").empty());
+		CHECK((sys::cpu_set { 5, 1, 3, 1 }).to_string() == "1,3,5");
+		CHECK((set & sys::cpu_set { 3, 4, 8 }) == (sys::cpu_set { 3, 8 }));
+
+		CHECK_THROWS_AS(sys::cpu_set::parse("3-1"), std::invalid_argument);
+		CHECK_THROWS_AS(sys::cpu_set::parse("x"), std::invalid_argument);
+		CHECK_THROWS_AS(sys::cpu_set::parse("1x"), std::invalid_argument);
+	}
+
+#ifdef __linux__
+	SECTION("pin the calling thread") {
+		sys::cpu_set allowed = sys::cpu_set::current();
+		REQUIRE(!allowed.empty());
+
+		std::thread t([&allowed]() {
+			CHECK(sys::cpu_set { allowed[0] }.pin());
+			CHECK(sys::cpu_set::current() == sys::cpu_set { allowed[0] });
+			CHECK(!sys::cpu_set().pin());
+		});
+		t.join();
+
+		CHECK(sys::current_node() >= 0);
+	}
+#endif
+}
+
+TEST_CASE("sys::cpu_topology", "[sys::cpu_topology]")
+{
+	// two nodes with one package each, two cores per package with two threads each
+	sys::cpu_topology topology("test/data/sysfs");
+	const sys::cpu_set all { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+	auto place = [&](unsigned threads_, sys::placement policy_, const sys::cpu_set& allowed_) {
+		std::vector<std::string> sets;
+
+		for (const auto& set : topology.place(threads_, policy_, allowed_))
+			sets.push_back(set.to_string());
+
+		return sets;
+	};
+
+	SECTION("reads cpus, cores and nodes") {
+		REQUIRE(topology.cpus().size() == 8);
+		CHECK(topology.nodes() == std::vector<int>({ 0, 1 }));
+		CHECK(topology.node_of(6) == 1);
+		CHECK(topology.node_of(42) == -1);
+		CHECK(topology.node_cpus(0).to_string() == "0-1,4-5");
+		CHECK(topology.siblings(5).to_string() == "1,5");
+		CHECK(topology.cpus()[3].package == 1);
+	}
+
+	SECTION("placement policies") {
+		CHECK(place(3, sys::placement::none, all) == std::vector<std::string>({ "", "", "" }));
+		CHECK(place(3, sys::placement::per_cpu, all) == std::vector<std::string>({ "0", "1", "2" }));
+		CHECK(place(8, sys::placement::per_core, all)
+			== std::vector<std::string>({ "0", "1", "2", "3", "4", "5", "6", "7" }));
+		CHECK(place(6, sys::placement::no_smt, all)
+			== std::vector<std::string>({ "0", "1", "2", "3", "0", "1" }));
+		CHECK(place(4, sys::placement::per_node, all)
+			== std::vector<std::string>({ "0-1,4-5", "0-1,4-5", "2-3,6-7", "2-3,6-7" }));
+	}
+
+	SECTION("placement respects the allowed cpus") {
+		CHECK(place(3, sys::placement::per_core, { 0, 2, 4 })
+			== std::vector<std::string>({ "0", "2", "4" }));
+		CHECK(place(2, sys::placement::no_smt, { 0, 4 }) == std::vector<std::string>({ "0", "0" }));
+		CHECK(place(2, sys::placement::per_node, { 1, 5 }) == std::vector<std::string>({ "1,5", "1,5" }));
+		CHECK(place(2, sys::placement::per_cpu, { 42 }) == std::vector<std::string>({ "", "" }));
+
+		auto sets = topology.place(3, sys::placement::per_cpu, std::vector<int>({ 7 }), all);
+		CHECK(sets[0].to_string() == "7");
+		CHECK(sets[1].to_string() == "1");
+	}
+
+	SECTION("missing sysfs falls back to one node") {
+		sys::cpu_topology fallback("test/data/no_such_dir");
+		CHECK(fallback.cpus().size() == std::max(1u, std::thread::hardware_concurrency()));
+		CHECK(fallback.nodes() == std::vector<int>({ 0 }));
+		CHECK(fallback.siblings(0).to_string() == "0");
+	}
+
+	SECTION("the local machine") {
+		const sys::cpu_topology& local = sys::cpu_topology::local();
+		REQUIRE(!local.cpus().empty());
+		REQUIRE(!local.nodes().empty());
+
+		for (const auto& set : local.place(4, sys::placement::per_core))
+			CHECK(set.size() == 1);
+	}
+}
+
+TEST_CASE("sys::numa_alloc", "[sys::cpu_topology]")
+{
+	int node = sys::cpu_topology::local().nodes().front();
+	const std::size_t size = 1 << 20;
+
+	char* p = static_cast<char*>(sys::numa_alloc(size, node));
+	REQUIRE(p != nullptr);
+	CHECK(p[size - 1] == 0);
+	std::memset(p, 1, size);
+	sys::numa_free(p, size);
+
+	std::vector<uint64_t, sys::numa_allocator<uint64_t>> table(1000, 7, sys::numa_allocator<uint64_t>(node));
+	CHECK(table.get_allocator().node() == node);
+	CHECK(std::accumulate(table.begin(), table.end(), uint64_t(0)) == 7000);
+}